@@ -0,0 +1,50 @@
+#include "amm.h"
+
+#include <cctype>
+
+// Case-insensitive compare of raw against an uppercase literal, no copies.
+static bool equalsUpper(const std::string& raw, const char* upper) {
+    size_t i = 0;
+    for (; upper[i] != '\0'; ++i) {
+        if (i >= raw.size() || std::toupper((unsigned char)raw[i]) != upper[i]) return false;
+    }
+    return i == raw.size();
+}
+
+Direction parseDirection(const std::string& raw) {
+    if (equalsUpper(raw, "A2B")) return Direction::A2B;
+    if (equalsUpper(raw, "B2A")) return Direction::B2A;
+    throw std::runtime_error("direction must be A2B or B2A");
+}
+
+const char* directionName(Direction dir) {
+    return dir == Direction::A2B ? "A2B" : "B2A";
+}
+
+double getAmountOut(double amountIn, double reserveIn, double reserveOut, double fee) {
+    require(amountIn > 0.0, "amountIn must be > 0");
+    require(reserveIn > 0.0 && reserveOut > 0.0, "reserves must be > 0");
+    require(fee >= 0.0 && fee < 1.0, "fee must be in [0, 1)");
+
+    // Apply fee to input amount (0.3% fee => keep 99.7% for pricing)
+    const double amountInWithFee = amountIn * (1.0 - fee);
+
+    // Constant-product swap output (same math as Uniswap v2 library)
+    return (amountInWithFee * reserveOut) / (reserveIn + amountInWithFee);
+}
+
+double getAmountIn(double amountOut, double reserveIn, double reserveOut, double fee) {
+    require(amountOut > 0.0, "amountOut must be > 0");
+    require(reserveIn > 0.0 && reserveOut > 0.0, "reserves must be > 0");
+    require(fee >= 0.0 && fee < 1.0, "fee must be in [0, 1)");
+    require(amountOut < reserveOut, "amountOut would drain the pool (invalid trade)");
+
+    // Solve amountOut = x*reserveOut / (reserveIn + x) for x = amountIn*(1-fee),
+    // then undo the fee.
+    return (reserveIn * amountOut) / ((reserveOut - amountOut) * (1.0 - fee));
+}
+
+SwapResult simulateSwap(double reserveA, double reserveB, double fee,
+                        const std::string& directionRaw, double amountIn) {
+    return simulateSwap(reserveA, reserveB, fee, parseDirection(directionRaw), amountIn);
+}
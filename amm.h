@@ -0,0 +1,127 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+// Holds swap outputs required by the task.
+struct SwapResult {
+    double amountOut{};        // how many tokens user receives
+    double newReserveA{};      // reserveA after swap
+    double newReserveB{};      // reserveB after swap
+    double effectivePrice{};   // amountOut / amountIn (units depend on direction)
+    double slippagePercent{};
+};
+
+// Which token the trader pays in.
+enum class Direction {
+    A2B,   // pay A, receive B
+    B2A,   // pay B, receive A
+};
+
+// Simple validation helper
+// msg error message if false
+inline void require(bool cond, const std::string& msg) {
+    if (!cond) throw std::runtime_error(msg);
+}
+
+// Same, but a literal message costs nothing unless the check fails.
+inline void require(bool cond, const char* msg) {
+    if (!cond) throw std::runtime_error(msg);
+}
+
+// "A2B" or "B2A", case-insensitive so "a2b" works too.
+// Meant for the CLI/ingest boundary; hot paths take a Direction.
+Direction parseDirection(const std::string& raw);
+
+const char* directionName(Direction dir);
+
+// Uniswap v2-style formula:
+// amountInWithFee = amountIn * (1 - fee)
+// amountOut = (amountInWithFee * reserveOut) / (reserveIn + amountInWithFee)
+double getAmountOut(double amountIn, double reserveIn, double reserveOut, double fee);
+
+// Closed-form inverse of getAmountOut (exact-output swaps):
+// amountIn = (reserveIn * amountOut) / ((reserveOut - amountOut) * (1 - fee))
+double getAmountIn(double amountOut, double reserveIn, double reserveOut, double fee);
+
+// spot price before trade:
+//  - A2B: P0 = reserveB / reserveA (B per A)
+//  - B2A: P0 = reserveA / reserveB (A per B)
+// effective price:
+//  - Peff = amountOut / amountIn
+// slippage% = (P0 - Peff) / P0 * 100
+//
+// The direction is a template parameter, so each instantiation is a
+// straight-line body with the in/out reserves fixed at compile time.
+template <Direction D>
+SwapResult simulateSwap(double reserveA, double reserveB, double fee, double amountIn) {
+    require(reserveA > 0.0 && reserveB > 0.0, "reserveA and reserveB must be > 0");
+
+    const bool aToB = (D == Direction::A2B);
+    const double reserveIn = aToB ? reserveA : reserveB;
+    const double reserveOut = aToB ? reserveB : reserveA;
+
+    // Spot price (before trade): how many out-tokens for 1 in-token
+    const double P0 = reserveOut / reserveIn;
+
+    const double out = getAmountOut(amountIn, reserveIn, reserveOut, fee);
+    require(out < reserveOut, "amountOut would drain the pool (invalid trade)");
+
+    SwapResult r{};
+    r.amountOut = out;
+
+    // Update pool reserves after swap
+    r.newReserveA = aToB ? reserveA + amountIn : reserveA - out;
+    r.newReserveB = aToB ? reserveB - out : reserveB + amountIn;
+
+    // Effective price for this trade (out per in)
+    r.effectivePrice = out / amountIn;
+
+    // Slippage relative to spot price
+    r.slippagePercent = (P0 - r.effectivePrice) / P0 * 100.0;
+    return r;
+}
+
+// Exact-output swap: the trader receives exactly amountOut and pays the
+// input computed by getAmountIn (written to *amountIn if given).
+// Same reserves/price/slippage semantics as simulateSwap.
+template <Direction D>
+SwapResult simulateSwapExactOut(double reserveA, double reserveB, double fee, double amountOut,
+                                double* amountIn = nullptr) {
+    require(reserveA > 0.0 && reserveB > 0.0, "reserveA and reserveB must be > 0");
+
+    const bool aToB = (D == Direction::A2B);
+    const double reserveIn = aToB ? reserveA : reserveB;
+    const double reserveOut = aToB ? reserveB : reserveA;
+
+    const double P0 = reserveOut / reserveIn;
+    const double in = getAmountIn(amountOut, reserveIn, reserveOut, fee);
+
+    SwapResult r{};
+    r.amountOut = amountOut;
+    r.newReserveA = aToB ? reserveA + in : reserveA - amountOut;
+    r.newReserveB = aToB ? reserveB - amountOut : reserveB + in;
+    r.effectivePrice = amountOut / in;
+    r.slippagePercent = (P0 - r.effectivePrice) / P0 * 100.0;
+    if (amountIn) *amountIn = in;
+    return r;
+}
+
+inline SwapResult simulateSwapExactOut(double reserveA, double reserveB, double fee, Direction dir,
+                                       double amountOut, double* amountIn = nullptr) {
+    return dir == Direction::A2B
+           ? simulateSwapExactOut<Direction::A2B>(reserveA, reserveB, fee, amountOut, amountIn)
+           : simulateSwapExactOut<Direction::B2A>(reserveA, reserveB, fee, amountOut, amountIn);
+}
+
+// Runtime direction: picks the matching instantiation.
+inline SwapResult simulateSwap(double reserveA, double reserveB, double fee,
+                               Direction dir, double amountIn) {
+    return dir == Direction::A2B
+           ? simulateSwap<Direction::A2B>(reserveA, reserveB, fee, amountIn)
+           : simulateSwap<Direction::B2A>(reserveA, reserveB, fee, amountIn);
+}
+
+// direction: "A2B" or "B2A" (thin adapter for the CLI)
+SwapResult simulateSwap(double reserveA, double reserveB, double fee,
+                        const std::string& directionRaw, double amountIn);
@@ -0,0 +1,129 @@
+#include "amount_out_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AMM_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+// Same operation order as getAmountOut. crypt_core is built with
+// -ffp-contract=off, so no path fuses mul+add and all of them round alike.
+static inline double amountOutScalar(double amountIn, double reserveIn, double reserveOut, double fee) {
+    const double amountInWithFee = amountIn * (1.0 - fee);
+    return (amountInWithFee * reserveOut) / (reserveIn + amountInWithFee);
+}
+
+static void amountOutLoopScalar(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                                const double* fee, double* amountOut, size_t begin, size_t n) {
+    for (size_t i = begin; i < n; ++i) {
+        amountOut[i] = amountOutScalar(amountIn[i], reserveIn[i], reserveOut[i], fee[i]);
+    }
+}
+
+#ifdef AMM_X86_DISPATCH
+
+__attribute__((target("avx2")))
+static void amountOutLoopAvx2(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                              const double* fee, double* amountOut, size_t n) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d in = _mm256_loadu_pd(amountIn + i);
+        const __m256d rIn = _mm256_loadu_pd(reserveIn + i);
+        const __m256d rOut = _mm256_loadu_pd(reserveOut + i);
+        const __m256d f = _mm256_loadu_pd(fee + i);
+
+        const __m256d inWithFee = _mm256_mul_pd(in, _mm256_sub_pd(one, f));
+        const __m256d num = _mm256_mul_pd(inWithFee, rOut);
+        const __m256d den = _mm256_add_pd(rIn, inWithFee);
+        _mm256_storeu_pd(amountOut + i, _mm256_div_pd(num, den));
+    }
+    amountOutLoopScalar(amountIn, reserveIn, reserveOut, fee, amountOut, i, n);
+}
+
+__attribute__((target("avx512f")))
+static void amountOutLoopAvx512(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                                const double* fee, double* amountOut, size_t n) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d in = _mm512_loadu_pd(amountIn + i);
+        const __m512d rIn = _mm512_loadu_pd(reserveIn + i);
+        const __m512d rOut = _mm512_loadu_pd(reserveOut + i);
+        const __m512d f = _mm512_loadu_pd(fee + i);
+
+        const __m512d inWithFee = _mm512_mul_pd(in, _mm512_sub_pd(one, f));
+        const __m512d num = _mm512_mul_pd(inWithFee, rOut);
+        const __m512d den = _mm512_add_pd(rIn, inWithFee);
+        _mm512_storeu_pd(amountOut + i, _mm512_div_pd(num, den));
+    }
+
+    // Tail: masked loads/stores instead of a scalar loop.
+    if (i < n) {
+        const __mmask8 m = (__mmask8)((1u << (n - i)) - 1u);
+        const __m512d in = _mm512_maskz_loadu_pd(m, amountIn + i);
+        const __m512d rIn = _mm512_maskz_loadu_pd(m, reserveIn + i);
+        const __m512d rOut = _mm512_maskz_loadu_pd(m, reserveOut + i);
+        const __m512d f = _mm512_maskz_loadu_pd(m, fee + i);
+
+        const __m512d inWithFee = _mm512_mul_pd(in, _mm512_sub_pd(one, f));
+        const __m512d num = _mm512_mul_pd(inWithFee, rOut);
+        const __m512d den = _mm512_add_pd(rIn, inWithFee);
+        _mm512_mask_storeu_pd(amountOut + i, m, _mm512_div_pd(num, den));
+    }
+}
+
+#endif // AMM_X86_DISPATCH
+
+SimdLevel detectSimdLevel() {
+#ifdef AMM_X86_DISPATCH
+    static const SimdLevel detected = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::Avx512;
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+        return SimdLevel::Scalar;
+    }();
+    return detected;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+static SimdLevel& currentLevel() {
+    static SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+SimdLevel activeSimdLevel() {
+    return currentLevel();
+}
+
+SimdLevel setSimdLevel(SimdLevel level) {
+    const SimdLevel best = detectSimdLevel();
+    currentLevel() = ((int)level > (int)best) ? best : level;
+    return currentLevel();
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx512: return "avx512";
+        case SimdLevel::Avx2:   return "avx2";
+        default:                return "scalar";
+    }
+}
+
+void getAmountOutBatch(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                       const double* fee, double* amountOut, size_t n) {
+    switch (currentLevel()) {
+#ifdef AMM_X86_DISPATCH
+        case SimdLevel::Avx512:
+            amountOutLoopAvx512(amountIn, reserveIn, reserveOut, fee, amountOut, n);
+            return;
+        case SimdLevel::Avx2:
+            amountOutLoopAvx2(amountIn, reserveIn, reserveOut, fee, amountOut, n);
+            return;
+#endif
+        default:
+            amountOutLoopScalar(amountIn, reserveIn, reserveOut, fee, amountOut, 0, n);
+            return;
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+// Instruction set used by getAmountOutBatch (and philoxBlocks).
+enum class SimdLevel {
+    Scalar,
+    Avx2,     // 4 doubles per vector
+    Avx512,   // 8 doubles per vector
+};
+
+// Best level supported by this CPU (checked once, at first call).
+SimdLevel detectSimdLevel();
+
+// Level currently used by getAmountOutBatch (defaults to detectSimdLevel()).
+SimdLevel activeSimdLevel();
+
+// Force a level, e.g. to compare kernels. Levels above what the CPU
+// supports are clamped down. Returns the level actually selected.
+SimdLevel setSimdLevel(SimdLevel level);
+
+const char* simdLevelName(SimdLevel level);
+
+// Vectorized getAmountOut over arrays:
+//   amountOut[i] = amountIn[i]*(1-fee[i])*reserveOut[i] / (reserveIn[i] + amountIn[i]*(1-fee[i]))
+// No validation (see validateSwapBatch). Every level performs the same IEEE
+// operations in the same order, so results are bit-identical to getAmountOut.
+void getAmountOutBatch(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                       const double* fee, double* amountOut, size_t n);
@@ -0,0 +1,347 @@
+#include "arbitrage.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const uint32_t kNoEdge = 0xffffffffu;
+
+// Log-weight slack: relaxations and cycle costs must beat this, so float
+// noise on break-even loops (e.g. zero-fee round trips) is not reported.
+static const double kEps = 1e-12;
+
+// Running composition out = a*x / (1 + c*x) of a chain of swaps (b is
+// kept normalized to 1 so long chains don't overflow).
+struct SwapChain {
+    double a = 1.0;
+    double c = 0.0;
+
+    void then(double gammaReserveOut, double reserveIn, double gamma) {
+        c = (reserveIn * c + gamma * a) / reserveIn;
+        a = a * gammaReserveOut / reserveIn;
+    }
+
+    bool finish(ArbCycle& cycle) const {
+        cycle.spotRate = a;
+        cycle.amountIn = 0.0;
+        cycle.profit = 0.0;
+        if (!(a > 1.0) || !(c > 0.0)) return false;
+        const double x = (std::sqrt(a) - 1.0) / c;
+        const double profit = a * x / (1.0 + c * x) - x;
+        if (!(profit > 0.0)) return false;
+        cycle.amountIn = x;
+        cycle.profit = profit;
+        return true;
+    }
+};
+
+bool optimizeCycle(const PoolRegistry& reg, ArbCycle& cycle) {
+    require(!cycle.pools.empty(), "empty cycle");
+    SwapChain chain;
+    TokenId t = cycle.startToken;
+    for (const PoolId id : cycle.pools) {
+        const Direction dir = reg.directionFor(id, t);
+        const Pool& p = reg.pool(id);
+        require(reg.kind(id) == PoolKind::ConstantProduct, "arbitrage sizing supports constant-product pools only");
+        const bool aToB = (dir == Direction::A2B);
+        const double gamma = 1.0 - p.fee;
+        chain.then(gamma * (aToB ? p.reserveB : p.reserveA), aToB ? p.reserveA : p.reserveB, gamma);
+        t = aToB ? p.tokenB : p.tokenA;
+    }
+    require(t == cycle.startToken, "pools do not form a cycle");
+    return chain.finish(cycle);
+}
+
+ArbitrageDetector::ArbitrageDetector(const PoolRegistry& reg, unsigned maxCycleLength)
+    : reg_(reg), maxCycleLength_(maxCycleLength) {
+    require(maxCycleLength >= 2, "maxCycleLength must be >= 2");
+    rebuild();
+}
+
+void ArbitrageDetector::refreshWeight(PoolId id) {
+    for (int side = 0; side < 2; ++side) {
+        const uint32_t k = graph_.poolEdge[2 * id + side];
+        weight_[k] = -std::log(PoolGraph::spotRate(graph_.edges[k]));
+    }
+}
+
+void ArbitrageDetector::rebuild() {
+    require(reg_.poolsOfKind(PoolKind::ConstantProduct).size() == reg_.size(),
+            "arbitrage detection supports constant-product pools only");
+    graph_.build(reg_);
+    const size_t tokens = graph_.tokenCount();
+    const size_t pools = reg_.size();
+
+    weight_.resize(graph_.edges.size());
+    for (size_t i = 0; i < pools; ++i) refreshWeight((PoolId)i);
+
+    cycles_.clear();
+    tracked_.clear();
+    known_.clear();
+    deps_.clear();
+
+    const size_t slots = maxCycleLength_ * tokens;   // hops 0 .. maxCycleLength-1
+    stamp_.assign(slots, 0);
+    cost_.resize(slots);
+    viaEdge_.resize(slots);
+    prevToken_.resize(slots);
+    nearTarget_.assign(tokens, 0);
+    epoch_ = 0;
+}
+
+bool ArbitrageDetector::evaluate(const std::vector<uint32_t>& edges, ArbCycle& cycle) const {
+    SwapChain chain;
+    cycle.pools.clear();
+    for (const uint32_t k : edges) {
+        const PoolGraph::Edge& e = graph_.edges[k];
+        chain.then(PoolGraph::gammaReserveOut(e), e.reserveIn, PoolGraph::gamma(e));
+        cycle.pools.push_back(e.pool);
+    }
+    cycle.startToken = graph_.source(edges.front());
+    return chain.finish(cycle);
+}
+
+void ArbitrageDetector::addCycle(std::vector<uint32_t> edges) {
+    // Canonical rotation: smallest pool id first.
+    size_t first = 0;
+    for (size_t i = 1; i < edges.size(); ++i) {
+        if (graph_.edges[edges[i]].pool < graph_.edges[edges[first]].pool) first = i;
+    }
+    std::rotate(edges.begin(), edges.begin() + (std::ptrdiff_t)first, edges.end());
+
+    std::vector<PoolId> key;
+    key.reserve(edges.size());
+    for (const uint32_t k : edges) key.push_back(graph_.edges[k].pool);
+    std::vector<PoolId> sorted = key;
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) return;   // reuses a pool
+    if (known_.count(key)) return;
+
+    ArbCycle cycle;
+    if (!evaluate(edges, cycle)) return;
+    const DependencyIndex::DepId dep = deps_.add(key);
+    if (dep >= slotOf_.size()) slotOf_.resize((size_t)dep + 1);
+    slotOf_[dep] = (uint32_t)cycles_.size();
+    known_.insert(key);
+    cycles_.push_back(cycle);
+    tracked_.push_back(Tracked{std::move(edges), dep});
+}
+
+void ArbitrageDetector::removeCycle(size_t i) {
+    known_.erase(cycles_[i].pools);
+    deps_.remove(tracked_[i].dep);
+    if (i + 1 != cycles_.size()) {
+        cycles_[i] = std::move(cycles_.back());
+        tracked_[i] = std::move(tracked_.back());
+        slotOf_[tracked_[i].dep] = (uint32_t)i;
+    }
+    cycles_.pop_back();
+    tracked_.pop_back();
+}
+
+bool ArbitrageDetector::bellmanFordPass(const std::vector<char>& banned,
+                                        std::vector<std::vector<uint32_t>>& found) {
+    const size_t tokens = graph_.tokenCount();
+    dist_.assign(tokens, 0.0);   // virtual source at distance 0 from every token
+    parent_.assign(tokens, kNoEdge);
+
+    for (size_t round = 0; round < tokens; ++round) {
+        bool changed = false;
+        for (TokenId u = 0; u < tokens; ++u) {
+            const double du = dist_[u];
+            for (uint32_t k = graph_.edgeBegin[u]; k < graph_.edgeBegin[u + 1]; ++k) {
+                const PoolGraph::Edge& e = graph_.edges[k];
+                if (banned[e.pool]) continue;
+                const double d = du + weight_[k];
+                if (d < dist_[e.tokenOut] - kEps) {
+                    dist_[e.tokenOut] = d;
+                    parent_[e.tokenOut] = k;
+                    changed = true;
+                }
+            }
+        }
+        if (!changed) return false;   // converged: no negative cycle left
+
+        // Any cycle of the predecessor graph is a negative one. Each token
+        // has at most one parent, so walking parents from every unvisited
+        // token finds them all in O(tokens).
+        seen_.assign(tokens, 0);
+        uint32_t walk = 0;
+        for (TokenId t = 0; t < tokens; ++t) {
+            if (seen_[t]) continue;
+            ++walk;
+            TokenId x = t;
+            while (x != kNoToken && seen_[x] == 0) {
+                seen_[x] = walk;
+                x = (parent_[x] == kNoEdge) ? kNoToken : graph_.source(parent_[x]);
+            }
+            if (x == kNoToken || seen_[x] != walk) continue;
+
+            std::vector<uint32_t> cycle;
+            TokenId y = x;
+            do {
+                cycle.push_back(parent_[y]);
+                y = graph_.source(parent_[y]);
+            } while (y != x);
+            std::reverse(cycle.begin(), cycle.end());
+            found.push_back(std::move(cycle));
+        }
+        if (!found.empty()) return true;
+    }
+    return !found.empty();
+}
+
+const std::vector<ArbCycle>& ArbitrageDetector::scan(unsigned passes) {
+    require(graph_.edgeBegin.size() == reg_.tokenCount() + 1 && graph_.edges.size() == 2 * reg_.size(),
+            "registry changed: rebuild the detector");
+    cycles_.clear();
+    tracked_.clear();
+    known_.clear();
+    deps_.clear();
+
+    std::vector<char> banned(reg_.size(), 0);
+    std::vector<std::vector<uint32_t>> found;
+    for (unsigned pass = 0; pass < passes; ++pass) {
+        found.clear();
+        if (!bellmanFordPass(banned, found)) break;
+        for (auto& cycle : found) {
+            for (const uint32_t k : cycle) banned[graph_.edges[k].pool] = 1;
+            addCycle(std::move(cycle));
+        }
+    }
+    return cycles_;
+}
+
+bool ArbitrageDetector::usesPool(unsigned hop, TokenId at, PoolId pool) const {
+    const size_t tokens = graph_.tokenCount();
+    for (unsigned h = hop; h > 0; --h) {
+        const size_t slot = h * tokens + at;
+        if (graph_.edges[viaEdge_[slot]].pool == pool) return true;
+        at = prevToken_[slot];
+    }
+    return false;
+}
+
+// Cheapest path (sum of -log rates) back from the head of `first` to its
+// tail in at most maxCycleLength-1 hops, not reusing any pool. Same
+// hop-layered search as Router::search, minimizing cost instead of
+// maximizing amount. True if it closes a negative cycle with `first`.
+bool ArbitrageDetector::cheapestReturn(uint32_t first, std::vector<uint32_t>& path) {
+    const size_t tokens = graph_.tokenCount();
+    const unsigned maxHops = maxCycleLength_ - 1;
+    const TokenId from = graph_.edges[first].tokenOut;
+    const TokenId to = graph_.source(first);
+    const PoolId firstPool = graph_.edges[first].pool;
+
+    if (++epoch_ == 0) {
+        std::fill(stamp_.begin(), stamp_.end(), 0);
+        std::fill(nearTarget_.begin(), nearTarget_.end(), 0);
+        epoch_ = 1;
+    }
+    stamp_[from] = epoch_;
+    cost_[from] = 0.0;
+    frontier_.assign(1, from);
+    for (uint32_t k = graph_.edgeBegin[to]; k < graph_.edgeBegin[to + 1]; ++k) {
+        nearTarget_[graph_.edges[k].tokenOut] = epoch_;
+    }
+
+    double best = -weight_[first] - kEps;   // a return path must cost less than this
+    unsigned bestHop = 0;
+    for (unsigned h = 1; h < maxHops && !frontier_.empty(); ++h) {
+        next_.clear();
+        const bool lastBeforeLimit = (h + 1 == maxHops);
+        const size_t prevBase = (h - 1) * tokens;
+        const size_t base = h * tokens;
+        for (const TokenId u : frontier_) {
+            const double cu = cost_[prevBase + u];
+            for (uint32_t k = graph_.edgeBegin[u]; k < graph_.edgeBegin[u + 1]; ++k) {
+                const PoolGraph::Edge& e = graph_.edges[k];
+                const TokenId v = e.tokenOut;
+                if (v == from || e.pool == firstPool) continue;
+                if (lastBeforeLimit && v != to && nearTarget_[v] != epoch_) continue;
+
+                const double c = cu + weight_[k];
+                const size_t slot = base + v;
+                const bool live = (stamp_[slot] == epoch_);
+                if (live && c >= cost_[slot]) continue;   // dominated
+                if (h > 1 && usesPool(h - 1, u, e.pool)) continue;
+
+                if (!live) {
+                    stamp_[slot] = epoch_;
+                    if (v != to) next_.push_back(v);
+                }
+                cost_[slot] = c;
+                viaEdge_[slot] = k;
+                prevToken_[slot] = u;
+            }
+        }
+        const size_t target = base + to;
+        if (stamp_[target] == epoch_ && cost_[target] < best) {
+            best = cost_[target];
+            bestHop = h;
+        }
+        frontier_.swap(next_);
+    }
+
+    // Last hop: only edges into `to`, found as reverses of to's own edges.
+    if (!frontier_.empty()) {
+        const unsigned h = maxHops;
+        const size_t prevBase = (h - 1) * tokens;
+        const size_t target = h * tokens + to;
+        for (uint32_t r = graph_.edgeBegin[to]; r < graph_.edgeBegin[to + 1]; ++r) {
+            const TokenId u = graph_.edges[r].tokenOut;
+            const PoolId pool = graph_.edges[r].pool;
+            if (stamp_[prevBase + u] != epoch_ || pool == firstPool) continue;
+            if (h > 1 && usesPool(h - 1, u, pool)) continue;
+
+            const uint32_t k = graph_.reverse(r);
+            const double c = cost_[prevBase + u] + weight_[k];
+            if (c < best) {
+                best = c;
+                bestHop = h;
+                stamp_[target] = epoch_;
+                cost_[target] = c;
+                viaEdge_[target] = k;
+                prevToken_[target] = u;
+            }
+        }
+    }
+    if (bestHop == 0) return false;
+
+    path.resize(bestHop);
+    TokenId t = to;
+    for (unsigned h = bestHop; h > 0; --h) {
+        const size_t slot = h * tokens + t;
+        path[h - 1] = viaEdge_[slot];
+        t = prevToken_[slot];
+    }
+    return true;
+}
+
+const std::vector<ArbCycle>& ArbitrageDetector::update(const std::vector<PoolId>& changed) {
+    for (const PoolId id : changed) {
+        graph_.update(reg_, id);
+        refreshWeight(id);
+        deps_.touch(id);
+    }
+
+    // Known cycles through a changed pool: re-price, drop if no longer profitable.
+    std::vector<DependencyIndex::DepId> unprofitable;
+    for (const DependencyIndex::DepId dep : deps_.takeDirty()) {
+        const size_t i = slotOf_[dep];
+        if (!evaluate(tracked_[i].edges, cycles_[i])) unprofitable.push_back(dep);
+    }
+    for (const DependencyIndex::DepId dep : unprofitable) removeCycle(slotOf_[dep]);
+
+    // New cycles must go through a changed pool, in either direction.
+    std::vector<uint32_t> path;
+    for (const PoolId id : changed) {
+        for (int side = 0; side < 2; ++side) {
+            const uint32_t first = graph_.poolEdge[2 * id + side];
+            if (!cheapestReturn(first, path)) continue;
+            std::vector<uint32_t> edges(1, first);
+            edges.insert(edges.end(), path.begin(), path.end());
+            addCycle(std::move(edges));
+        }
+    }
+    return cycles_;
+}
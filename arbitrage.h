@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "dependency_index.h"
+#include "pool_graph.h"
+#include "pool_registry.h"
+
+// A closed chain of swaps that starts and ends in startToken.
+struct ArbCycle {
+    std::vector<PoolId> pools;       // swap order, rotated so the smallest pool id comes first
+    TokenId startToken = kNoToken;   // token put in and taken out
+    double spotRate = 0.0;           // product of fee-adjusted spot rates (> 1 if profitable)
+    double amountIn = 0.0;           // profit-maximizing input, in startToken
+    double profit = 0.0;             // output - amountIn at that input
+};
+
+// Chained constant-product swaps compose to one map of the same shape,
+//   out = a*x / (b + c*x),
+// with (a, b, c) <- (a1*a2, b1*b2, b2*c1 + a1*c2) per extra hop. Profit
+// a*x/(b + c*x) - x peaks where a*b = (b + c*x)^2:
+//   x* = (sqrt(a*b) - b) / c,   profitable iff a > b.
+// Fills spotRate, amountIn and profit from the registry's current reserves;
+// returns false (amountIn = profit = 0) if the cycle is not profitable.
+bool optimizeCycle(const PoolRegistry& reg, ArbCycle& cycle);
+
+// Finds profitable cycles over a registry's pools.
+//
+// scan() runs Bellman-Ford on edge weights -log(spot rate) from a virtual
+// source at every token; after each round the predecessor graph is checked
+// for cycles, and every cycle there is a negative-weight one, i.e. a
+// profitable loop at small size. Each pass bans the pools of the cycles it
+// found and runs again, to surface cycles that were shadowed by them.
+//
+// update(changed) is the incremental path: after only some pools moved,
+// a cycle can only have turned profitable through one of them. Known
+// cycles are registered in a DependencyIndex, so only those touching a
+// changed pool are re-evaluated (ones that stopped paying are dropped);
+// then new cycles of up to maxCycleLength pools are searched through each
+// changed pool, instead of rescanning the graph.
+//
+// Cycle sizing is the x*y=k closed form, so the registry must hold
+// constant-product pools only.
+//
+// Uses internal scratch space: one detector per thread.
+class ArbitrageDetector {
+public:
+    explicit ArbitrageDetector(const PoolRegistry& reg, unsigned maxCycleLength = 4);
+
+    // Re-reads the graph after pools were added to the registry; drops all cycles.
+    void rebuild();
+
+    // Full rescan; replaces the known cycles.
+    const std::vector<ArbCycle>& scan(unsigned passes = 4);
+
+    // Incremental re-evaluation after the reserves of `changed` moved.
+    const std::vector<ArbCycle>& update(const std::vector<PoolId>& changed);
+
+    // Profitable cycles (unordered: removals move the last cycle into the gap).
+    const std::vector<ArbCycle>& cycles() const { return cycles_; }
+
+    // Known-cycle re-evaluations done vs avoided by update().
+    const DependencyIndex::Stats& dependencyStats() const { return deps_.stats(); }
+
+private:
+    struct Tracked {
+        std::vector<uint32_t> edges;   // graph edges in swap order
+        DependencyIndex::DepId dep;
+    };
+
+    void refreshWeight(PoolId id);
+    bool bellmanFordPass(const std::vector<char>& banned, std::vector<std::vector<uint32_t>>& found);
+    bool cheapestReturn(uint32_t first, std::vector<uint32_t>& path);
+    bool usesPool(unsigned hop, TokenId at, PoolId pool) const;
+    bool evaluate(const std::vector<uint32_t>& edges, ArbCycle& cycle) const;
+    void addCycle(std::vector<uint32_t> edges);
+    void removeCycle(size_t i);
+
+    const PoolRegistry& reg_;
+    unsigned maxCycleLength_;
+    PoolGraph graph_;
+    std::vector<double> weight_;   // per edge: -log(spot rate)
+
+    std::vector<ArbCycle> cycles_;
+    std::vector<Tracked> tracked_;                // parallel to cycles_
+    std::set<std::vector<PoolId>> known_;         // canonical pool sequences in cycles_
+    DependencyIndex deps_;                        // pool -> cycles reading it
+    std::vector<uint32_t> slotOf_;                // DepId -> index in cycles_
+
+    // Bellman-Ford state.
+    std::vector<double> dist_;
+    std::vector<uint32_t> parent_;
+    std::vector<uint32_t> seen_;
+
+    // Hop-layered labels for update(), slot = hop*tokenCount + token
+    // (live when stamp == epoch_).
+    std::vector<uint32_t> stamp_;
+    std::vector<double> cost_;
+    std::vector<uint32_t> viaEdge_;
+    std::vector<TokenId> prevToken_;
+    std::vector<uint32_t> nearTarget_;
+    uint32_t epoch_ = 0;
+    std::vector<TokenId> frontier_, next_;
+};
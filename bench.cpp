@@ -0,0 +1,1771 @@
+// crypt_bench: correctness checks and throughput of the swap engines and
+// the I/O paths around them (number/direction parsing, result formatting).
+// Every timing line reports ns/op, ops/s and TSC cycles/op. Needs no
+// network and no input files; exits 1 if any check fails.
+// Usage: crypt_bench [count]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "amm.h"
+#include "amount_out_simd.h"
+#include "arbitrage.h"
+#include "concentrated.h"
+#include "exact_amm.h"
+#include "fast_math.h"
+#include "latency_histogram.h"
+#include "line_reader.h"
+#include "lp_book.h"
+#include "montecarlo.h"
+#include "parallel_for.h"
+#include "parse_number.h"
+#include "pool_batch.h"
+#include "replay.h"
+#include "result_sink.h"
+#include "rng.h"
+#include "router.h"
+#include "stableswap.h"
+#include "stage_stats.h"
+#include "swap_batch.h"
+#include "trade_split.h"
+#include "tsc.h"
+#include "weighted.h"
+
+// Random pool/trade sizes in raw 18-decimal units: reserves 1e18..1e30,
+// trades up to 10% of the input reserve.
+struct ExactInputs {
+    std::vector<Uint256> amountIn, reserveIn, reserveOut;
+    std::vector<double> amountInD, reserveInD, reserveOutD;
+};
+
+static Uint256 randomAmount(std::mt19937_64& rng, int minExp, int maxExp) {
+    std::uniform_int_distribution<int> exp(minExp, maxExp);
+    std::uniform_int_distribution<uint64_t> mantissa(1000000000000000000ull, 9999999999999999999ull);
+    bool overflow = false;
+    Uint256 v(mantissa(rng));
+    for (int e = exp(rng) - 18; e > 0; --e) v = mulSmallChecked(v, 10, overflow);
+    return v;
+}
+
+static ExactInputs makeInputs(size_t n) {
+    std::mt19937_64 rng(12345);
+    ExactInputs in;
+    for (size_t i = 0; i < n; ++i) {
+        const Uint256 rIn = randomAmount(rng, 18, 30);
+        const Uint256 rOut = randomAmount(rng, 18, 30);
+        std::uniform_int_distribution<uint64_t> frac(1, 100000);
+        bool overflow = false;
+        Uint256 a = divFloor(mulSmallChecked(rIn, frac(rng), overflow), Uint256(1000000));
+        if (a.isZero()) a = Uint256(1);
+
+        in.amountIn.push_back(a);
+        in.reserveIn.push_back(rIn);
+        in.reserveOut.push_back(rOut);
+        in.amountInD.push_back(a.toDouble());
+        in.reserveInD.push_back(rIn.toDouble());
+        in.reserveOutD.push_back(rOut.toDouble());
+    }
+    return in;
+}
+
+// Double vs exact on every input. The double path may differ from the
+// floored integer by at most 1 unit plus its own rounding error.
+static bool differentialCheck(const ExactInputs& in) {
+    size_t bad = 0;
+    double maxRel = 0.0;
+    for (size_t i = 0; i < in.amountIn.size(); ++i) {
+        const double d = getAmountOut(in.amountInD[i], in.reserveInD[i], in.reserveOutD[i], 0.003);
+        const double e = getAmountOutExact(in.amountIn[i], in.reserveIn[i], in.reserveOut[i]).toDouble();
+        const double diff = std::fabs(d - e);
+        if (e > 0.0) maxRel = std::max(maxRel, diff / e);
+        if (diff > 1.0 + 1e-12 * e) ++bad;
+    }
+    std::printf("differential double vs exact: %zu inputs, max rel diff %.3e, %zu out of tolerance\n",
+                in.amountIn.size(), maxRel, bad);
+    return bad == 0;
+}
+
+// Exact-output inverse on the outputs of the same inputs. getAmountInExact
+// must be the smallest input that still yields y: getAmountOutExact of it
+// reaches y, and one unit less falls short, except when the division in
+// the formula is exact, where its "+ 1" makes it one unit above the
+// minimum. The double inverse must round-trip and agree with the exact
+// one like getAmountOut does, and both must reject y >= reserveOut.
+static bool inverseCheck(const ExactInputs& in) {
+    size_t bad = 0, checked = 0;
+    double maxRel = 0.0, maxRoundTrip = 0.0;
+    bool overflow = false;
+    for (size_t i = 0; i < in.amountIn.size(); ++i) {
+        const Uint256 y = getAmountOutExact(in.amountIn[i], in.reserveIn[i], in.reserveOut[i]);
+        if (y.isZero()) continue;
+        ++checked;
+        const Uint256 x = getAmountInExact(y, in.reserveIn[i], in.reserveOut[i]);
+        if (getAmountOutExact(x, in.reserveIn[i], in.reserveOut[i]) < y) ++bad;
+        const Uint256 num = mulSmallChecked(mulChecked(in.reserveIn[i], y, overflow), 1000, overflow);
+        const Uint256 den = mulSmallChecked(subChecked(in.reserveOut[i], y, overflow), 997, overflow);
+        const bool divides = mulChecked(divFloor(num, den), den, overflow) == num;
+        const Uint256 shortBy1 = subChecked(x, Uint256(divides ? 2 : 1), overflow);
+        if (!shortBy1.isZero() && getAmountOutExact(shortBy1, in.reserveIn[i], in.reserveOut[i]) >= y) ++bad;
+
+        const double yD = y.toDouble(), e = x.toDouble();
+        const double d = getAmountIn(yD, in.reserveInD[i], in.reserveOutD[i], 0.003);
+        const double diff = std::fabs(d - e);
+        maxRel = std::max(maxRel, diff / e);
+        if (diff > 1.0 + 1e-12 * e) ++bad;
+        const double back = getAmountOut(d, in.reserveInD[i], in.reserveOutD[i], 0.003);
+        maxRoundTrip = std::max(maxRoundTrip, std::fabs(back - yD) / yD);
+    }
+    if (overflow || maxRoundTrip > 1e-13) ++bad;
+
+    // amountOut >= reserveOut must be rejected by both engines.
+    const double outs[] = {1e6, 1e6 + 1.0, 2e6};   // reserveOut is 1e6 + 1
+    for (const double out : outs) {
+        bool threw = false;
+        try {
+            getAmountIn(out, 1e6, 1e6 + 1.0, 0.003);
+        } catch (const std::exception&) {
+            threw = true;
+        }
+        if (threw != (out >= 1e6 + 1.0)) ++bad;
+        threw = false;
+        try {
+            getAmountInExact(Uint256((uint64_t)out), Uint256(1000000), Uint256(1000001));
+        } catch (const std::exception&) {
+            threw = true;
+        }
+        if (threw != (out >= 1e6 + 1.0)) ++bad;
+    }
+
+    std::printf("inverse getAmountIn: %zu outputs, exact is minimal, double vs exact max rel diff %.3e, "
+                "round trip %.1e, %zu failures\n", checked, maxRel, maxRoundTrip, bad);
+    return bad == 0;
+}
+
+static void report(const char* name, size_t ops, double sec, uint64_t ticks, double sink) {
+    std::printf("%-36s %9.2f ns/op %12.0f ops/s %9.1f cycles/op   (checksum %.6e)\n",
+                name, sec * 1e9 / (double)ops, (double)ops / sec, (double)ticks / (double)ops, sink);
+}
+
+// One timed run of f, which returns a checksum so its work is not
+// optimized away. For work with side effects (swaps applied to a
+// registry, positions opened) that must run exactly once.
+template <class F>
+static void timeIt(const char* name, size_t ops, F&& f) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const uint64_t c0 = readTsc();
+    const double sink = f();
+    const uint64_t c1 = readTsc();
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    report(name, ops, sec, c1 - c0, sink);
+}
+
+// For repeatable work: one warm-up run, then the median of kTimedRuns, so
+// a single preempted or cold run does not move the reported number.
+template <class F>
+static void timeMedian(const char* name, size_t ops, F&& f) {
+    const int kTimedRuns = 5;
+    double sink = f();
+    double sec[kTimedRuns];
+    uint64_t ticks[kTimedRuns];
+    for (int r = 0; r < kTimedRuns; ++r) {
+        const auto t0 = std::chrono::steady_clock::now();
+        const uint64_t c0 = readTsc();
+        sink = f();
+        ticks[r] = readTsc() - c0;
+        sec[r] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+    int order[kTimedRuns];
+    for (int r = 0; r < kTimedRuns; ++r) order[r] = r;
+    std::sort(order, order + kTimedRuns, [&](int a, int b) { return sec[a] < sec[b]; });
+    const int mid = order[kTimedRuns / 2];
+    report(name, ops, sec[mid], ticks[mid], sink);
+}
+
+// getAmountOutBatch and simulateSwapBatch lane by lane against
+// getAmountOut / simulateSwap at every SIMD level, including lanes the
+// scalar path rejects: those must carry the matching error bit and zeros.
+static bool checkAmountOutBatch() {
+    std::mt19937_64 rng(2024);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const size_t lanes = 1003;   // odd: exercises every tail path
+    std::vector<double> rIn(lanes), rOut(lanes), fee(lanes), in(lanes), out(lanes);
+    std::vector<double> newIn(lanes), newOut(lanes), price(lanes), slip(lanes);
+    std::vector<uint8_t> err(lanes), want(lanes, 0);
+    for (size_t i = 0; i < lanes; ++i) {
+        rIn[i] = std::pow(10.0, 3.0 + 15.0 * unit(rng));
+        rOut[i] = rIn[i] * std::pow(10.0, -3.0 + 6.0 * unit(rng));
+        fee[i] = 0.01 * unit(rng);
+        in[i] = rIn[i] * std::pow(10.0, -9.0 + 10.0 * unit(rng));
+    }
+    struct BadLane { size_t lane; double amountIn, reserveIn, reserveOut, fee; uint8_t error; };
+    const BadLane badLanes[] = {
+        {3, 0.0, 1e6, 1e6, 0.003, SwapBadAmountIn},
+        {8, -5.0, 1e6, 1e6, 0.003, SwapBadAmountIn},
+        {17, 10.0, 0.0, 1e6, 0.003, SwapBadReserves},
+        {18, 10.0, 1e6, 0.0, 0.003, SwapBadReserves | SwapDrainsPool},   // 0 out of 0 reserve
+        {19, 10.0, -1e6, 1e6, 0.003, SwapBadReserves},
+        {42, 10.0, 1e6, 1e6, 1.0, SwapBadFee},
+        {43, 10.0, 1e6, 1e6, 1.5, SwapBadFee},
+        {44, 10.0, 1e6, 1e6, -0.01, SwapBadFee},
+        {64, 0.0, 0.0, 1e6, 1.0, SwapBadAmountIn | SwapBadReserves | SwapBadFee | SwapDrainsPool},   // 0/0
+        {1001, 1e300, 1.0, 1.0, 0.0, SwapDrainsPool},   // amountOut rounds to reserveOut
+    };
+    for (const BadLane& b : badLanes) {
+        in[b.lane] = b.amountIn;
+        rIn[b.lane] = b.reserveIn;
+        rOut[b.lane] = b.reserveOut;
+        fee[b.lane] = b.fee;
+        want[b.lane] = b.error;
+    }
+
+    size_t bad = 0;
+    const SimdLevel best = detectSimdLevel();
+    for (int level = 0; level <= (int)best; ++level) {
+        setSimdLevel((SimdLevel)level);
+        getAmountOutBatch(in.data(), rIn.data(), rOut.data(), fee.data(), out.data(), lanes);
+        for (size_t i = 0; i < lanes; ++i) {
+            if ((want[i] & ~SwapDrainsPool) == 0 && out[i] != getAmountOut(in[i], rIn[i], rOut[i], fee[i])) ++bad;
+        }
+
+        const SwapBatchInput bin{rIn.data(), rOut.data(), fee.data(), in.data(), lanes};
+        const SwapBatchOutput bout{out.data(), newIn.data(), newOut.data(), price.data(), slip.data(), err.data()};
+        const size_t rejected = simulateSwapBatch(bin, bout);
+        size_t wantRejected = 0;
+        for (size_t i = 0; i < lanes; ++i) {
+            if (err[i] != want[i]) ++bad;
+            if (want[i] != 0) {
+                ++wantRejected;
+                bool threw = false;
+                try {
+                    simulateSwap<Direction::A2B>(rIn[i], rOut[i], fee[i], in[i]);
+                } catch (const std::exception&) {
+                    threw = true;
+                }
+                if (!threw || out[i] != 0.0 || newIn[i] != 0.0 || newOut[i] != 0.0 || price[i] != 0.0 ||
+                    slip[i] != 0.0) {
+                    ++bad;
+                }
+                continue;
+            }
+            const SwapResult r = simulateSwap<Direction::A2B>(rIn[i], rOut[i], fee[i], in[i]);
+            if (out[i] != r.amountOut || newIn[i] != r.newReserveA || newOut[i] != r.newReserveB ||
+                price[i] != r.effectivePrice || slip[i] != r.slippagePercent) {
+                ++bad;
+            }
+        }
+        if (rejected != wantRejected) ++bad;
+    }
+    setSimdLevel(best);
+    std::printf("x*y=k: %zu lanes incl. %zu error lanes per SIMD level, batch == scalar: %zu failures\n", lanes,
+                sizeof(badLanes) / sizeof(badLanes[0]), bad);
+    return bad == 0;
+}
+
+// Scalar and batch x*y=k quoting on the same inputs: the double engine,
+// the compile-time and runtime direction forms of simulateSwap, the exact
+// uint256 engine, and the batch kernels at every SIMD level.
+static void benchQuoting(const ExactInputs& in) {
+    const size_t n = in.amountIn.size();
+    timeMedian("getAmountOut (double)", n, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < n; ++i) acc += getAmountOut(in.amountInD[i], in.reserveInD[i], in.reserveOutD[i], 0.003);
+        return acc;
+    });
+    timeMedian("simulateSwap<A2B>", n, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            acc += simulateSwap<Direction::A2B>(in.reserveInD[i], in.reserveOutD[i], 0.003, in.amountInD[i]).amountOut;
+        }
+        return acc;
+    });
+    timeMedian("simulateSwap (runtime direction)", n, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const Direction dir = (i & 1) ? Direction::B2A : Direction::A2B;
+            const double rA = (i & 1) ? in.reserveOutD[i] : in.reserveInD[i];
+            const double rB = (i & 1) ? in.reserveInD[i] : in.reserveOutD[i];
+            acc += simulateSwap(rA, rB, 0.003, dir, in.amountInD[i]).amountOut;
+        }
+        return acc;
+    });
+    timeMedian("getAmountOutExact (uint256)", n, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < n; ++i) acc += (double)getAmountOutExact(in.amountIn[i], in.reserveIn[i], in.reserveOut[i]).limb[0];
+        return acc;
+    });
+
+    std::vector<double> fee(n, 0.003), out(n), newIn(n), newOut(n), price(n), slip(n);
+    std::vector<uint8_t> err(n);
+    const SimdLevel best = detectSimdLevel();
+    for (int level = 0; level <= (int)best; ++level) {
+        setSimdLevel((SimdLevel)level);
+        const std::string name = std::string("getAmountOutBatch (") + simdLevelName((SimdLevel)level) + ")";
+        timeMedian(name.c_str(), n, [&] {
+            getAmountOutBatch(in.amountInD.data(), in.reserveInD.data(), in.reserveOutD.data(), fee.data(), out.data(), n);
+            return out[n - 1];
+        });
+    }
+    setSimdLevel(best);
+    const SwapBatchInput bin{in.reserveInD.data(), in.reserveOutD.data(), fee.data(), in.amountInD.data(), n};
+    const SwapBatchOutput bout{out.data(), newIn.data(), newOut.data(), price.data(), slip.data(), err.data()};
+    timeMedian("simulateSwapBatch", n, [&] {
+        simulateSwapBatch(bin, bout);
+        return slip[n - 1];
+    });
+}
+
+// Cost of the --stats hooks when on: a ScopedStage sample (two TSC reads
+// and the per-thread lookup) and a counter bump. (Off, the check is hoisted
+// out of loops like these entirely.) Also checks that nested time is
+// exclusive and that worker threads' counts are merged when they exit.
+static bool benchStageStats(size_t n) {
+    size_t bad = 0;
+    if (CRYPT_STATS) {
+        setStatsEnabled(true);
+        const StageStatsSnapshot before = stageStatsSnapshot();
+        timeMedian("ScopedStage (stats on)", n, [&] {
+            for (size_t i = 0; i < n; ++i) ScopedStage timer(Stage::Math, 1);
+            return 0.0;
+        });
+        timeMedian("addStat (stats on)", n, [&] {
+            for (size_t i = 0; i < n; ++i) addStat(StatCounter::LinesRead);
+            return 0.0;
+        });
+        const StageStatsSnapshot mid = stageStatsSnapshot();
+        if (mid.samples[(int)Stage::Math] - before.samples[(int)Stage::Math] != 6 * n) ++bad;
+        if (mid.counters[(int)StatCounter::LinesRead] - before.counters[(int)StatCounter::LinesRead] != 6 * n) ++bad;
+
+        // An outer stage around a busy inner one keeps only its own time.
+        {
+            ScopedStage outer(Stage::Parse);
+            ScopedStage inner(Stage::Output);
+            double acc = 0.0;
+            for (int i = 0; i < 1000000; ++i) acc += std::sqrt((double)i);
+            if (acc < 0.0) ++bad;
+        }
+        std::thread worker([] { addStat(StatCounter::BytesWritten, 12345); });
+        worker.join();
+        const StageStatsSnapshot after = stageStatsSnapshot();
+        const uint64_t outerTicks = after.ticks[(int)Stage::Parse] - mid.ticks[(int)Stage::Parse];
+        const uint64_t innerTicks = after.ticks[(int)Stage::Output] - mid.ticks[(int)Stage::Output];
+        if (outerTicks * 10 > innerTicks) ++bad;
+        if (after.counters[(int)StatCounter::BytesWritten] - mid.counters[(int)StatCounter::BytesWritten] != 12345) ++bad;
+        setStatsEnabled(false);
+    }
+    std::printf("stage stats: %s, nesting and thread merge: %zu failures\n",
+                CRYPT_STATS ? "compiled in" : "compiled out", bad);
+    return bad == 0;
+}
+
+// LatencyHistogram: every value lands in a bucket whose bounds hold it and
+// are within 1/64 of it, percentiles of a known distribution come back
+// within that error, and per-worker histograms filled by parallelFor merge
+// to exactly the single-threaded one. Then the cost of record().
+static bool benchLatencyHistogram(size_t n) {
+    size_t bad = 0;
+    std::mt19937_64 rng(2718);
+    for (int i = 0; i < 100000; ++i) {
+        const uint64_t v = i < 64 ? (i < 32 ? (uint64_t)i * 7 : ~0ull - (uint64_t)i) : rng() >> (rng() % 64);
+        const int b = LatencyHistogram::bucketIndex(v);
+        const uint64_t high = LatencyHistogram::bucketHigh(b);
+        const uint64_t low = b == 0 ? 0 : LatencyHistogram::bucketHigh(b - 1) + 1;
+        if (b < 0 || b >= LatencyHistogram::kBuckets || v < low || v > high) ++bad;
+        if ((double)(high - low) > (double)low / 64.0) ++bad;
+    }
+
+    std::unique_ptr<LatencyHistogram> single(new LatencyHistogram()), merged(new LatencyHistogram());
+    const uint64_t kValues = 1000000;
+    for (uint64_t v = 1; v <= kValues; ++v) single->record(v);
+    const double ps[3] = {50.0, 99.0, 99.9};
+    for (const double p : ps) {
+        const double want = p / 100.0 * (double)kValues;
+        if (std::fabs((double)single->percentile(p) - want) > want / 64.0) ++bad;
+    }
+    if (single->max() != kValues || single->percentile(100.0) != kValues || single->mean() != 500000.5) ++bad;
+
+    LatencyRecorder recorder(4);
+    parallelFor(kValues, 4, [&](size_t task, unsigned worker) { recorder.worker(worker).record(task + 1); });
+    recorder.merged(*merged);
+    if (merged->count() != single->count() || merged->max() != single->max()) ++bad;
+    for (double p = 0.0; p <= 100.0; p += 0.1) {
+        if (merged->percentile(p) != single->percentile(p)) ++bad;
+    }
+    std::printf("latency histogram: bucket bounds, percentiles within 1/64, 4-worker merge: %zu failures\n", bad);
+
+    std::vector<uint64_t> samples(n);
+    for (auto& s : samples) s = 100 + (rng() % 100000);
+    timeMedian("LatencyHistogram::record", n, [&] {
+        for (const uint64_t s : samples) single->record(s);
+        return (double)single->count();
+    });
+    return bad == 0;
+}
+
+// Direction fields as written by hand and by tools: mixed case, both ways.
+// parseDirection is the CLI form; LineCursor::parseDirection is the trade
+// log field parser, timed alone and as part of a whole trade line.
+static bool benchDirectionParsing(size_t n) {
+    const char* const spellings[4] = {"A2B", "B2A", "a2b", "b2a"};
+    std::vector<std::string> words(n), lines(n);
+    std::mt19937_64 rng(31337);
+    char buf[64];
+    for (size_t i = 0; i < n; ++i) {
+        words[i] = spellings[rng() % 4];
+        std::snprintf(buf, sizeof(buf), "%u,%s,%.6f", (unsigned)(rng() % 20000), words[i].c_str(),
+                      1e-2 * (double)(rng() % 100000000));
+        lines[i] = buf;
+    }
+
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+        Direction d = Direction::A2B;
+        LineCursor c{words[i].data(), words[i].data() + words[i].size()};
+        if (!c.parseDirection(d) || d != parseDirection(words[i])) ++bad;
+    }
+    std::printf("direction parsing: %zu fields, %zu mismatches\n", n, bad);
+
+    timeMedian("parseDirection (std::string)", n, [&] {
+        double acc = 0.0;
+        for (const auto& w : words) acc += parseDirection(w) == Direction::B2A ? 1.0 : 0.0;
+        return acc;
+    });
+    timeMedian("LineCursor::parseDirection", n, [&] {
+        double acc = 0.0;
+        for (const auto& w : words) {
+            Direction d = Direction::A2B;
+            LineCursor c{w.data(), w.data() + w.size()};
+            c.parseDirection(d);
+            acc += d == Direction::B2A ? 1.0 : 0.0;
+        }
+        return acc;
+    });
+    timeMedian("parseTradeLine", n, [&] {
+        double acc = 0.0;
+        uint64_t lineNo = 0;
+        for (const auto& l : lines) {
+            uint64_t poolId = 0, timestamp = 0;
+            Direction d = Direction::A2B;
+            double amountIn = 0.0;
+            LineCursor c{l.data(), l.data() + l.size()};
+            parseTradeLine(c, ++lineNo, poolId, d, amountIn, timestamp);
+            acc += amountIn;
+        }
+        return acc;
+    });
+    return bad == 0;
+}
+
+// Result rows in every output format, written to the null device so only
+// the formatting and buffering are timed.
+static void benchOutputFormatting(const ExactInputs& in) {
+#if defined(_WIN32)
+    const char* const nullDevice = "NUL";
+#else
+    const char* const nullDevice = "/dev/null";
+#endif
+    const size_t n = in.amountIn.size();
+    std::vector<SwapResult> results(n);
+    for (size_t i = 0; i < n; ++i) {
+        results[i] = simulateSwap<Direction::A2B>(in.reserveInD[i], in.reserveOutD[i], 0.003, in.amountInD[i]);
+    }
+
+    const OutputFormat formats[4] = {OutputFormat::Table, OutputFormat::Csv, OutputFormat::Jsonl, OutputFormat::Binary};
+    const char* const names[4] = {"table", "csv", "jsonl", "binary"};
+    for (int f = 0; f < 4; ++f) {
+        const std::string name = std::string("ResultSink::row (") + names[f] + ")";
+        timeMedian(name.c_str(), n, [&] {
+            ResultSink sink(nullDevice, formats[f]);
+            sink.header();
+            for (size_t i = 0; i < n; ++i) sink.row((uint64_t)i + 1, Direction::A2B, in.amountInD[i], results[i]);
+            sink.flush();
+            return results[n - 1].amountOut;
+        });
+    }
+    timeMedian("ResultSink::row (table, text label)", n, [&] {
+        ResultSink sink(nullDevice, OutputFormat::Table);
+        for (size_t i = 0; i < n; ++i) sink.row("swap", Direction::A2B, in.amountInD[i], results[i]);
+        sink.flush();
+        return results[n - 1].amountOut;
+    });
+}
+
+// Amount strings as they appear in trade logs: mostly short fixed-point
+// values, some in exponent form.
+static std::vector<std::string> makeNumberStrings(size_t n) {
+    std::mt19937_64 rng(777);
+    std::uniform_real_distribution<double> logAmount(-2.0, 9.0);
+    std::vector<std::string> out;
+    out.reserve(n);
+    char buf[64];
+    for (size_t i = 0; i < n; ++i) {
+        const double v = std::pow(10.0, logAmount(rng));
+        switch (rng() % 4) {
+            case 0:  std::snprintf(buf, sizeof(buf), "%.2f", v); break;
+            case 1:  std::snprintf(buf, sizeof(buf), "%.6f", v); break;
+            case 2:  std::snprintf(buf, sizeof(buf), "%.17g", v); break;
+            default: std::snprintf(buf, sizeof(buf), "%.0f", v); break;
+        }
+        out.push_back(buf);
+    }
+    return out;
+}
+
+static bool benchNumberParsing(size_t n) {
+    const std::vector<std::string> strs = makeNumberStrings(n);
+
+    size_t mismatches = 0;
+    for (const auto& s : strs) {
+        double v = 0.0;
+        parseDoubleFull(s.data(), s.data() + s.size(), v);
+        if (v != std::strtod(s.c_str(), nullptr)) ++mismatches;
+    }
+    std::printf("parseDouble vs strtod: %zu strings, %zu mismatches\n", strs.size(), mismatches);
+
+    // Slow-path edges: inputs longer than any fixed buffer, and subnormals
+    // parse like strtod; overflow and underflow to zero are rejected.
+    size_t bad = 0;
+    const std::string slowOk[] = {"1." + std::string(300, '1') + "e5", std::string(200, '0') + "1.5",
+                                  "1e-310", "4.9e-324", "-2.5e-320", "1.7976931348623157e308"};
+    for (const auto& s : slowOk) {
+        double v = 0.0;
+        if (!parseDoubleFull(s.data(), s.data() + s.size(), v) || v != std::strtod(s.c_str(), nullptr)) ++bad;
+    }
+    const std::string slowBad[] = {"1e400", "-1e400", "1e-400"};
+    for (const auto& s : slowBad) {
+        double v = 0.0;
+        if (parseDoubleFull(s.data(), s.data() + s.size(), v)) ++bad;
+    }
+    std::printf("parseDouble slow-path edge cases: %zu failures\n", bad);
+
+    // parseDoubleFull on a std::string is all the CLI's toDouble does past
+    // its empty-value check.
+    timeMedian("parseDoubleFull (toDouble)", n, [&] {
+        double acc = 0.0;
+        for (const auto& s : strs) {
+            double v = 0.0;
+            parseDoubleFull(s.data(), s.data() + s.size(), v);
+            acc += v;
+        }
+        return acc;
+    });
+    timeMedian("strtod", n, [&] {
+        double acc = 0.0;
+        for (const auto& s : strs) acc += std::strtod(s.c_str(), nullptr);
+        return acc;
+    });
+    timeMedian("std::stod", n, [&] {
+        double acc = 0.0;
+        for (const auto& s : strs) acc += std::stod(s);
+        return acc;
+    });
+    return bad == 0;
+}
+
+// Random graph: 20000 pools over 2000 tokens, a few hub tokens listed in
+// many pools (like WETH/USDC), reserves spread over 1e3..1e9.
+static bool benchRouting(size_t queries) {
+    std::mt19937_64 rng(4242);
+    PoolRegistry reg;
+    const size_t kTokens = 2000, kPools = 20000, kHubs = 8;
+    for (size_t t = 0; t < kTokens; ++t) reg.internToken("T" + std::to_string(t));
+    std::uniform_int_distribution<TokenId> anyToken(0, kTokens - 1), hub(0, kHubs - 1);
+    std::uniform_real_distribution<double> logReserve(3.0, 9.0);
+    for (size_t i = 0; i < kPools; ++i) {
+        const TokenId a = (i % 2) ? hub(rng) : anyToken(rng);
+        TokenId b = anyToken(rng);
+        if (b == a) b = (b + 1) % kTokens;
+        reg.addPool(a, b, std::pow(10.0, logReserve(rng)), std::pow(10.0, logReserve(rng)), 0.003);
+    }
+
+    Router router(reg);
+    std::unique_ptr<LatencyHistogram> routeLatency(new LatencyHistogram()), splitLatency(new LatencyHistogram());
+    std::vector<TokenId> from(queries), to(queries);
+    for (size_t i = 0; i < queries; ++i) {
+        from[i] = anyToken(rng);
+        do to[i] = anyToken(rng); while (to[i] == from[i]);
+    }
+
+    size_t found = 0;
+    router.setLatencyHistogram(routeLatency.get());
+    timeIt("bestRoute (3 hops, 20k pools)", queries, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < queries; ++i) {
+            const Route r = router.bestRoute(from[i], to[i], 1000.0, 3);
+            found += !r.hops.empty();
+            acc += r.amountOut;
+        }
+        return acc;
+    });
+    router.setLatencyHistogram(splitLatency.get());
+    timeIt("bestSplit (4 routes)", queries, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < queries; ++i) acc += router.bestSplit(from[i], to[i], 1000.0, 3, 4).amountOut;
+        return acc;
+    });
+    std::printf("routes found: %zu / %zu\n", found, queries);
+    std::printf("  bestRoute latency: %s\n  bestSplit latency: %s\n", latencySummary(*routeLatency).c_str(),
+                latencySummary(*splitLatency).c_str());
+
+    // Mixed kinds: the search must rank stable and weighted hops on their
+    // own curves. A deep stable pool beats a slightly larger x*y=k pool on
+    // a big trade, and on random mixed pairs the one-hop best route must be
+    // the best single pool by quoteSwap.
+    size_t bad = 0;
+    PoolRegistry mixed;
+    const TokenId usdc = mixed.internToken("USDC"), usdt = mixed.internToken("USDT");
+    mixed.addPool(usdc, usdt, 1010000.0, 1010000.0, 0.003);
+    mixed.addPool(usdc, usdt, 1000000.0, 1000000.0, 0.003, PoolKind::Stable, 100.0);
+    {
+        Router mixedRouter(mixed);
+        const Route r = mixedRouter.bestRoute(usdc, usdt, 100000.0, 1);
+        if (r.hops.size() != 1 || r.hops[0].pool != 1 ||
+            r.amountOut != mixed.quoteSwap(1, Direction::A2B, 100000.0).amountOut) {
+            ++bad;
+        }
+    }
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (size_t t = 2; t < 40; ++t) mixed.internToken("M" + std::to_string(t));
+    for (size_t i = 0; i < 400; ++i) {
+        const TokenId a = (TokenId)(rng() % 40);
+        const TokenId b = (TokenId)((a + 1 + rng() % 39) % 40);
+        const double reserveA = 1e6 * (1.0 + 9.0 * unit(rng)), reserveB = reserveA * (0.5 + unit(rng));
+        const double u = unit(rng);
+        if (u < 0.4) {
+            mixed.addPool(a, b, reserveA, reserveB, 0.003);
+        } else if (u < 0.7) {
+            mixed.addPool(a, b, reserveA, reserveB, 0.0004, PoolKind::Stable, 10.0 + 490.0 * unit(rng));
+        } else {
+            mixed.addPool(a, b, reserveA, reserveB, 0.002, PoolKind::Weighted, 0.2 + 0.6 * unit(rng));
+        }
+    }
+    Router mixedRouter(mixed);
+    size_t pairs = 0;
+    for (TokenId a = 0; a < 40; ++a) {
+        for (TokenId b = 0; b < 40; ++b) {
+            if (a == b || mixed.findPool(a, b) == kNoPool) continue;
+            const double amountIn = 1e5 * (0.01 + unit(rng));
+            double best = 0.0;
+            for (PoolId id = mixed.findPool(a, b); id != kNoPool; id = mixed.pool(id).nextSamePair) {
+                best = std::max(best, mixed.quoteSwap(id, mixed.directionFor(id, a), amountIn).amountOut);
+            }
+            if (mixedRouter.bestRoute(a, b, amountIn, 1).amountOut != best) ++bad;
+            ++pairs;
+        }
+    }
+    std::printf("routing over mixed pool kinds: %zu one-hop pairs, best pool by own curve: %zu failures\n", pairs,
+                bad);
+    return bad == 0;
+}
+
+// Optimality check of solveTradeSplit on random pool sets (the marginal
+// output of every pool with a share must be equal, and no idle pool may
+// have a higher marginal at 0), then its speed at N = 1000.
+static bool benchTradeSplit() {
+    std::mt19937_64 rng(99);
+    std::uniform_real_distribution<double> logReserve(3.0, 9.0), price(0.9, 1.1);
+    const double fees[] = {0.0001, 0.0005, 0.003, 0.01};
+
+    size_t bad = 0, checked = 0;
+    double maxRel = 0.0;
+    std::vector<double> rIn, rOut, fee, alloc;
+    for (int trial = 0; trial < 2000; ++trial) {
+        const size_t n = 1 + rng() % 64;
+        rIn.resize(n); rOut.resize(n); fee.resize(n); alloc.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            rIn[i] = std::pow(10.0, logReserve(rng));
+            rOut[i] = rIn[i] * price(rng);
+            fee[i] = fees[rng() % 4];
+        }
+        const double amountIn = std::pow(10.0, logReserve(rng)) * 0.1;
+        const SplitPoolsInput in{rIn.data(), rOut.data(), fee.data(), n};
+        solveTradeSplit(in, amountIn, alloc.data());
+
+        double lambda = -1.0, sum = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const double g = 1.0 - fee[i], d = rIn[i] + g * alloc[i];
+            const double marginal = g * rOut[i] * rIn[i] / (d * d);
+            sum += alloc[i];
+            if (alloc[i] > 0.0 && alloc[i] > 1e-9 * amountIn) {
+                if (lambda < 0.0) lambda = marginal;
+                maxRel = std::max(maxRel, std::fabs(marginal - lambda) / lambda);
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const double g = 1.0 - fee[i];
+            if (alloc[i] == 0.0 && g * rOut[i] / rIn[i] > lambda * (1.0 + 1e-9)) ++bad;
+        }
+        if (std::fabs(sum - amountIn) > 1e-12 * amountIn) ++bad;
+        ++checked;
+    }
+    if (maxRel > 1e-9) ++bad;
+    std::printf("trade split: %zu pool sets, max marginal mismatch %.3e, %zu failures\n", checked, maxRel, bad);
+
+    // Extremes: 1 wei against 1e18 reserves (below one ulp of every
+    // offset, so it must all land on the best-priced pool) and an input
+    // far larger than the reserves. Both must stay finite and sum to
+    // amountIn, and the output can never reach the reserves.
+    {
+        const double rInX[] = {1e18, 2e18, 1.5e18};
+        const double rOutX[] = {1e18, 2.1e18, 1.4e18};
+        const double feeX[] = {0.003, 0.003, 0.0005};
+        const SplitPoolsInput in{rInX, rOutX, feeX, 3};
+        const double amounts[] = {1.0, 1e-6, 1e24, 1e30};
+        size_t extremeBad = 0;
+        for (const double amountIn : amounts) {
+            double a[3];
+            const double out = solveTradeSplit(in, amountIn, a);
+            const double total = a[0] + a[1] + a[2];
+            if (!std::isfinite(out) || !(out >= 0.0) || !(out < rOutX[0] + rOutX[1] + rOutX[2])) ++extremeBad;
+            if (!(std::fabs(total - amountIn) <= 1e-12 * amountIn)) ++extremeBad;
+            for (const double x : a) {
+                if (!std::isfinite(x) || x < 0.0) ++extremeBad;
+            }
+            // Best marginal at zero input: pool 1 (2.1e18*0.997 / 2e18).
+            if (amountIn < 1.0 + 1e-9 && a[1] != amountIn) ++extremeBad;
+        }
+        std::printf("trade split extremes (1 wei .. 1e30 vs 1e18 reserves): %zu failures\n", extremeBad);
+        bad += extremeBad;
+    }
+
+    const size_t n = 1000, reps = 20000;
+    rIn.resize(n); rOut.resize(n); fee.resize(n); alloc.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        rIn[i] = std::pow(10.0, logReserve(rng));
+        rOut[i] = rIn[i] * price(rng);
+        fee[i] = fees[rng() % 4];
+    }
+    const SplitPoolsInput in{rIn.data(), rOut.data(), fee.data(), n};
+    timeIt("solveTradeSplit (N=1000)", reps, [&] {
+        double acc = 0.0;
+        for (size_t r = 0; r < reps; ++r) acc += solveTradeSplit(in, 1e6 + (double)r, alloc.data());
+        return acc;
+    });
+    return bad == 0;
+}
+
+// Chains simulateSwap around a cycle; returns output - amountIn.
+static double simulateCycle(const PoolRegistry& reg, const ArbCycle& c, double amountIn) {
+    double x = amountIn;
+    TokenId t = c.startToken;
+    for (const PoolId id : c.pools) {
+        const Pool& p = reg.pool(id);
+        const Direction dir = reg.directionFor(id, t);
+        x = simulateSwap(p.reserveA, p.reserveB, p.fee, dir, x).amountOut;
+        t = (dir == Direction::A2B) ? p.tokenB : p.tokenA;
+    }
+    return x - amountIn;
+}
+
+// Every reported cycle must pay what the closed form says, and less at a
+// slightly smaller or larger input.
+static size_t checkCycles(const PoolRegistry& reg, const std::vector<ArbCycle>& cycles) {
+    size_t bad = 0;
+    for (const ArbCycle& c : cycles) {
+        const double p = simulateCycle(reg, c, c.amountIn);
+        if (!(std::fabs(p - c.profit) <= 1e-6 * std::max(c.profit, c.amountIn * 1e-6))) ++bad;
+        if (simulateCycle(reg, c, c.amountIn * 0.99) > p || simulateCycle(reg, c, c.amountIn * 1.01) > p) ++bad;
+    }
+    return bad;
+}
+
+// 20000 pools over 2000 tokens whose reserves follow a hidden price per
+// token with +-2% noise, so some cycles beat the 0.3% fees.
+static bool benchArbitrage(size_t updates) {
+    std::mt19937_64 rng(31337);
+    PoolRegistry reg;
+    const size_t kTokens = 2000, kPools = 20000, kHubs = 8;
+    std::uniform_real_distribution<double> logPrice(-2.0, 4.0), logValue(4.0, 9.0), noise(0.98, 1.02);
+    std::vector<double> price(kTokens);
+    for (size_t t = 0; t < kTokens; ++t) {
+        reg.internToken("T" + std::to_string(t));
+        price[t] = std::pow(10.0, logPrice(rng));
+    }
+    std::uniform_int_distribution<TokenId> anyToken(0, kTokens - 1), hub(0, kHubs - 1);
+    for (size_t i = 0; i < kPools; ++i) {
+        const TokenId a = (i % 2) ? hub(rng) : anyToken(rng);
+        TokenId b = anyToken(rng);
+        if (b == a) b = (b + 1) % kTokens;
+        const double value = std::pow(10.0, logValue(rng));
+        reg.addPool(a, b, value / price[a], value / price[b] * noise(rng), 0.003);
+    }
+
+    ArbitrageDetector arb(reg, 4);
+    size_t found = 0;
+    timeIt("arbitrage scan (20k pools)", 1, [&] {
+        found = arb.scan().size();
+        return (double)found;
+    });
+    size_t bad = checkCycles(reg, arb.cycles());
+
+    std::uniform_int_distribution<PoolId> anyPool(0, kPools - 1);
+    std::vector<PoolId> changed(1);
+    timeIt("arbitrage update (1 pool)", updates, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < updates; ++i) {
+            changed[0] = anyPool(rng);
+            const Pool& p = reg.pool(changed[0]);
+            reg.applySwap(changed[0], (rng() & 1) ? Direction::A2B : Direction::B2A,
+                          0.01 * ((rng() & 1) ? p.reserveA : p.reserveB));
+            acc += (double)arb.update(changed).size();
+        }
+        return acc;
+    });
+    bad += checkCycles(reg, arb.cycles());
+    const DependencyIndex::Stats& ds = arb.dependencyStats();
+    std::printf("arbitrage: %zu cycles after scan, %zu after %zu updates, %zu failures\n"
+                "  cycle re-evaluations: %llu done, %llu avoided (%.1f avoided per swap)\n",
+                found, arb.cycles().size(), updates, bad,
+                (unsigned long long)ds.reevaluated, (unsigned long long)ds.avoided, ds.avoidedPerBatch());
+
+    // Watched routes: 5000 best routes between random pairs, re-quoted
+    // only when a swap touches one of their pools.
+    Router router(reg);
+    RouteBook book(reg);
+    std::vector<RouteBook::WatchId> ids;
+    for (size_t i = 0; i < 5000; ++i) {
+        const TokenId a = anyToken(rng);
+        TokenId b = anyToken(rng);
+        if (b == a) b = (b + 1) % kTokens;
+        const Route r = router.bestRoute(a, b, 100.0, 3);
+        if (r.hops.empty()) continue;
+        std::vector<PoolId> pools;
+        for (const RouteHop& h : r.hops) pools.push_back(h.pool);
+        ids.push_back(book.watch(pools, a, 100.0));
+    }
+    std::vector<PoolId> swapped(1);
+    timeIt("route book update (1 swap)", updates, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < updates; ++i) {
+            swapped[0] = anyPool(rng);
+            reg.applySwap(swapped[0], Direction::A2B, 0.01 * reg.pool(swapped[0]).reserveA);
+            acc += (double)book.poolsChanged(swapped);
+        }
+        return acc;
+    });
+    size_t stale = 0;
+    for (const RouteBook::WatchId id : ids) {
+        const Route& q = book.quote(id);
+        std::vector<PoolId> pools;
+        for (const RouteHop& h : q.hops) pools.push_back(h.pool);
+        if (quotePath(reg, pools, q.hops[0].tokenIn, q.amountIn).amountOut != q.amountOut) ++stale;
+    }
+    const DependencyIndex::Stats& rs = book.stats();
+    std::printf("route book: %zu routes, %llu re-quotes, %llu avoided (%.1f avoided per swap), %zu stale\n",
+                book.size(), (unsigned long long)rs.reevaluated, (unsigned long long)rs.avoided,
+                rs.avoidedPerBatch(), stale);
+    return bad == 0 && stale == 0;
+}
+
+static double relDiff(double a, double b) {
+    return std::fabs(a - b) / std::max(std::fabs(a), std::fabs(b));
+}
+
+// LP accounting checks (closed-form IL on a fee-free pool, fee income kept
+// across add/partial burn, reserves fully accounted for), then swap and
+// valuation cost with `positions` positions spread over 1000 pools.
+static bool benchLpBook(size_t positions) {
+    std::mt19937_64 rng(4242);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    size_t bad = 0;
+
+    {
+        PoolRegistry reg;
+        const PoolId id = reg.addPool(reg.internToken("A"), reg.internToken("B"), 1000.0, 3000.0, 0.0);
+        LpBook book(reg);
+        const PositionId pos = book.open(id, 500.0, 1e9);
+        const double entry = 3.0;
+        double worst = 0.0;
+        for (int i = 0; i < 1000; ++i) {
+            const Pool& p = reg.pool(id);
+            const bool aToB = unit(rng) < 0.5;
+            reg.applySwap(id, aToB ? Direction::A2B : Direction::B2A, 0.05 * unit(rng) * (aToB ? p.reserveA : p.reserveB));
+            const double k = (p.reserveB / p.reserveA) / entry;
+            const double il = (2.0 * std::sqrt(k) / (1.0 + k) - 1.0) * 100.0;
+            const LpValuation v = book.value(pos);
+            worst = std::max(worst, std::fabs(v.impermanentLossPercent - il));
+            if (v.feesValue != 0.0) ++bad;
+        }
+        if (worst > 1e-9) ++bad;
+    }
+
+    {
+        PoolRegistry reg;
+        const PoolId id = reg.addPool(reg.internToken("A"), reg.internToken("B"), 1000.0, 1000.0, 0.003);
+        LpBook book(reg);
+        std::vector<PositionId> ids;
+        for (int i = 0; i < 50; ++i) ids.push_back(book.open(id, 10.0 + 100.0 * unit(rng), 1e9));
+        for (int i = 0; i < 20000; ++i) {
+            const Pool& p = reg.pool(id);
+            const bool aToB = unit(rng) < 0.5;
+            reg.applySwap(id, aToB ? Direction::A2B : Direction::B2A, 0.01 * unit(rng) * (aToB ? p.reserveA : p.reserveB));
+            if (i % 400 == 0) {
+                // Adding liquidity keeps the fees earned so far; burning half pays out half.
+                const PositionId target = ids[(size_t)(rng() % ids.size())];
+                const LpValuation before = book.value(target);
+                double scale = 1.0;
+                if (rng() & 1) {
+                    book.add(target, 5.0, 1e9);
+                } else {
+                    book.burn(target, 0.5);
+                    scale = 0.5;
+                }
+                const LpValuation after = book.value(target);
+                if (relDiff(after.feesA, before.feesA * scale) > 1e-9 && before.feesA > 0.0) ++bad;
+                if (relDiff(after.feesB, before.feesB * scale) > 1e-9 && before.feesB > 0.0) ++bad;
+            }
+        }
+        // Positions plus the pool's initial liquidity own exactly the reserves:
+        // burning every position leaves the initial liquidity's share behind.
+        const Pool& p = reg.pool(id);
+        double sharesSum = 0.0;
+        for (const PositionId i : ids) sharesSum += book.position(i).shares;
+        const double leftA = (p.totalShares - sharesSum) / p.totalShares * p.reserveA;
+        for (const PositionId i : ids) {
+            const LpValuation v = book.value(i);
+            if (!(v.feesValue > 0.0) || !(v.pnlPercent > v.impermanentLossPercent)) ++bad;
+            const LpWithdrawal w = book.burn(i, 1.0);
+            if (relDiff(w.amountA, v.amountA) > 1e-12 || relDiff(w.feesB, v.feesB) > 1e-12) ++bad;
+        }
+        if (book.size() != 0 || relDiff(reg.pool(id).reserveA, leftA) > 1e-12) ++bad;
+    }
+    std::printf("lp book: closed-form IL, fee carry-over and burns: %zu failures\n", bad);
+
+    const size_t kPools = 1000;
+    PoolRegistry reg;
+    for (size_t t = 0; t < 2 * kPools; ++t) reg.internToken("T" + std::to_string(t));
+    for (size_t i = 0; i < kPools; ++i) {
+        reg.addPool((TokenId)(2 * i), (TokenId)(2 * i + 1), 1e6 * (1.0 + unit(rng)), 1e6 * (1.0 + unit(rng)), 0.003);
+    }
+    LpBook book(reg);
+    timeIt("LpBook::open", positions, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < positions; ++i) acc += (double)book.open((PoolId)(rng() % kPools), 1.0 + unit(rng), 1e12);
+        return acc;
+    });
+    const size_t swaps = positions;
+    std::vector<PoolId> ids(swaps);
+    std::vector<Direction> dirs(swaps);
+    std::vector<double> amounts(swaps);
+    for (size_t i = 0; i < swaps; ++i) {
+        ids[i] = (PoolId)(rng() % kPools);
+        dirs[i] = (rng() & 1) ? Direction::A2B : Direction::B2A;
+        amounts[i] = 1e3 * unit(rng);
+    }
+    timeIt("applySwaps (fee accrual)", swaps, [&] {
+        reg.applySwaps(ids.data(), dirs.data(), amounts.data(), swaps, nullptr);
+        return reg.pool(0).feeGrowthA;
+    });
+    timeIt("LpBook::value (all positions)", positions, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < positions; ++i) acc += book.value((PositionId)i).pnlPercent;
+        return acc;
+    });
+    return bad == 0;
+}
+
+// TickMath against known values and its own inverse, TickBitmap against a
+// sorted tick list, a full-range position against the v2 formula, then the
+// cost of swaps that cross many ticks.
+static bool benchConcentrated(size_t swaps) {
+    std::mt19937_64 rng(3003);
+    size_t bad = 0;
+
+    if (sqrtRatioAtTick(0) != shiftLeft(Uint256(1), 96) || sqrtRatioAtTick(kMinTick) != Uint256(4295128739ull) ||
+        sqrtRatioAtTick(kMaxTick) != Uint256::fromDecimal("1461446703485210103287273052203988822378723970342")) {
+        ++bad;
+    }
+    for (int i = 0; i < 20000; ++i) {
+        const int32_t t = kMinTick + 1 + (int32_t)(rng() % (uint64_t)(kMaxTick - kMinTick - 1));
+        const Uint256 r = sqrtRatioAtTick(t);
+        bool ignored = false;
+        if (tickAtSqrtRatio(r) != t || tickAtSqrtRatio(subChecked(r, Uint256(1), ignored)) != t - 1) ++bad;
+    }
+
+    {
+        const int32_t spacing = 60;
+        TickBitmap bitmap(spacing);
+        std::vector<int32_t> set;
+        for (int i = 0; i < 300; ++i) {
+            const int32_t t = ((int32_t)(rng() % 29000) - 14500) * spacing;
+            if (bitmap.isSet(t)) continue;
+            bitmap.flip(t);
+            set.push_back(t);
+        }
+        std::sort(set.begin(), set.end());
+        for (int i = 0; i < 20000; ++i) {
+            const int32_t tick = (int32_t)(rng() % 1770000) - 885000;
+            const bool lte = rng() & 1;
+            bool initialized = false;
+            const int32_t got = bitmap.nextInitializedTickWithinOneWord(tick, lte, initialized);
+            // The word boundary the search stops at, and the nearest set tick.
+            const int32_t compressed = (tick < 0 && tick % spacing != 0) ? tick / spacing - 1 : tick / spacing;
+            const int32_t c = lte ? compressed : compressed + 1;
+            const int32_t wordStart = (c >= 0 ? c / 256 : (c - 255) / 256) * 256;
+            int32_t want = lte ? wordStart * spacing : (wordStart + 255) * spacing;
+            bool wantInit = false;
+            if (lte) {
+                auto it = std::upper_bound(set.begin(), set.end(), compressed * spacing);
+                if (it != set.begin() && *(it - 1) >= want) want = *(it - 1), wantInit = true;
+            } else {
+                auto it = std::upper_bound(set.begin(), set.end(), compressed * spacing);
+                if (it != set.end() && *it <= want) want = *it, wantInit = true;
+            }
+            if (got != want || initialized != wantInit) ++bad;
+        }
+    }
+
+    {
+        // Full range: the virtual reserves L/sqrtP and L*sqrtP are the v2 reserves.
+        const int32_t edge = kMaxTick / 60 * 60;
+        ConcentratedPool pool(3000, 60, sqrtRatioAtTick(4055));
+        pool.addLiquidity(-edge, edge, Uint256::fromDecimal("1000000000000000000000000"));
+        double worst = 0.0;
+        for (int i = 0; i < 2000; ++i) {
+            const Direction dir = (rng() & 1) ? Direction::A2B : Direction::B2A;
+            const double sqrtP = pool.sqrtPriceX96().toDouble() / 79228162514264337593543950336.0;
+            const double x = pool.liquidity().toDouble() / sqrtP, y = pool.liquidity().toDouble() * sqrtP;
+            const double amountIn = std::floor(std::ldexp(1.0, 40 + (int)(rng() % 40)));
+            const double v2 = dir == Direction::A2B ? getAmountOut(amountIn, x, y, 0.003) : getAmountOut(amountIn, y, x, 0.003);
+            worst = std::max(worst, relDiff(pool.applySwap(dir, amountIn).amountOut, v2));
+        }
+        if (worst > 1e-9) ++bad;
+    }
+    std::printf("concentrated: TickMath, bitmap and full-range vs v2 checks: %zu failures\n", bad);
+
+    // 2000 overlapping positions of width 1-50 spacings around the price.
+    ConcentratedPool pool(3000, 10, sqrtRatioAtTick(0));
+    for (int i = 0; i < 2000; ++i) {
+        const int32_t lower = ((int32_t)(rng() % 2000) - 1000) * 10;
+        pool.addLiquidity(lower, lower + (int32_t)(1 + rng() % 50) * 10, Uint256(1000000000000000000ull + rng() % 1000000000000000000ull));
+    }
+    const Uint256 amount(100000000000000000ull);
+    uint64_t crossed = 0;
+    timeIt("ConcentratedPool::swap", swaps, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < swaps; ++i) {
+            const ConcentratedSwapResult r = pool.swap((i & 1) ? Direction::B2A : Direction::A2B, amount);
+            crossed += r.ticksCrossed;
+            acc += r.amountOut.toDouble();
+        }
+        return acc;
+    });
+    std::printf("  %.1f initialized ticks crossed per swap\n", (double)crossed / (double)swaps);
+    return bad == 0;
+}
+
+// StableSwap: D satisfies the invariant, a fee-free swap keeps it, the batch
+// kernels match the scalar functions at every SIMD level, then throughput
+// next to the constant-product batch.
+static bool benchStableSwap(size_t n) {
+    std::mt19937_64 rng(1701);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    size_t bad = 0;
+
+    double worstInvariant = 0.0, worstSwap = 0.0;
+    for (int t = 0; t < 2000; ++t) {
+        const size_t coins = 2 + (size_t)(rng() % 4);
+        double x[5];
+        for (size_t k = 0; k < coins; ++k) x[k] = std::pow(10.0, 3.0 + 9.0 * unit(rng));
+        const double amp = std::pow(10.0, 4.0 * unit(rng));
+        const double d = stableSwapInvariant(x, coins, amp);
+
+        long double ann = amp, sum = 0.0L, dp = d;
+        for (size_t k = 0; k < coins; ++k) {
+            ann *= (long double)coins;
+            sum += x[k];
+            dp = dp * d / ((long double)x[k] * coins);
+        }
+        const long double lhs = ann * sum + d, rhs = ann * d + dp;
+        worstInvariant = std::max(worstInvariant, (double)std::fabs((lhs - rhs) / lhs));
+
+        // Up to 10% of the smaller side: near-draining trades leave x[1] - out
+        // with few correct digits, which says nothing about the engine.
+        const double amountIn = std::min(x[0], x[1]) * std::pow(10.0, -6.0 + 5.0 * unit(rng));
+        const double out = getAmountOutStable(x, coins, amp, 0.0, 0, 1, amountIn);
+        if (coins == 2 && out != getAmountOutStable(amountIn, x[0], x[1], 0.0, amp)) ++bad;
+        x[0] += amountIn;
+        x[1] -= out;
+        worstSwap = std::max(worstSwap, relDiff(stableSwapInvariant(x, coins, amp), d));
+    }
+    if (worstInvariant > 1e-12 || worstSwap > 1e-12) ++bad;
+
+    const size_t lanes = 1003;   // odd: exercises every tail path
+    std::vector<double> rIn(lanes), rOut(lanes), fee(lanes), amp(lanes), in(lanes), out(lanes);
+    std::vector<double> newIn(lanes), newOut(lanes), price(lanes), slip(lanes), want(lanes);
+    std::vector<uint8_t> err(lanes);
+    for (size_t i = 0; i < lanes; ++i) {
+        rIn[i] = std::pow(10.0, 3.0 + 9.0 * unit(rng));
+        rOut[i] = rIn[i] * std::pow(10.0, -3.0 + 6.0 * unit(rng));
+        fee[i] = 0.0004 * unit(rng);
+        amp[i] = std::pow(10.0, 4.0 * unit(rng));
+        in[i] = rIn[i] * std::pow(10.0, -6.0 + 7.0 * unit(rng));
+        want[i] = getAmountOutStable(in[i], rIn[i], rOut[i], fee[i], amp[i]);
+    }
+    amp[5] = 0.5;   // invalid lane
+    const SimdLevel best = detectSimdLevel();
+    for (int level = 0; level <= (int)best; ++level) {
+        setSimdLevel((SimdLevel)level);
+        getAmountOutStableBatch(in.data(), rIn.data(), rOut.data(), fee.data(), amp.data(), out.data(), lanes);
+        for (size_t i = 0; i < lanes; ++i) {
+            if (i != 5 && out[i] != want[i]) ++bad;
+        }
+        const SwapBatchInput bin{rIn.data(), rOut.data(), fee.data(), in.data(), lanes};
+        const SwapBatchOutput bout{out.data(), newIn.data(), newOut.data(), price.data(), slip.data(), err.data()};
+        if (simulateStableSwapBatch(bin, amp.data(), bout) != 1 || err[5] != SwapBadAmp) ++bad;
+        for (size_t i = 0; i < lanes; ++i) {
+            if (i == 5) continue;
+            const SwapResult r = simulateStableSwap<Direction::A2B>(rIn[i], rOut[i], fee[i], amp[i], in[i]);
+            if (err[i] != 0 || out[i] != r.amountOut || newOut[i] != r.newReserveB || slip[i] != r.slippagePercent) ++bad;
+        }
+    }
+    setSimdLevel(best);
+
+    const SwapResult cp = simulateSwap<Direction::A2B>(1e6, 1e6, 0.0004, 1e4);
+    const SwapResult ss = simulateStableSwap<Direction::A2B>(1e6, 1e6, 0.0004, 100.0, 1e4);
+    std::printf("stableswap: invariant residual %.1e, swap drift %.1e, batch == scalar: %zu failures; "
+                "1%% trade slippage %.4f %% (x*y=k: %.4f %%)\n",
+                worstInvariant, worstSwap, bad, ss.slippagePercent, cp.slippagePercent);
+
+    std::vector<double> bIn(n), bRIn(n), bROut(n), bFee(n, 0.0004), bAmp(n), bOut(n);
+    for (size_t i = 0; i < n; ++i) {
+        bRIn[i] = 1e6 * (1.0 + unit(rng));
+        bROut[i] = 1e6 * (1.0 + unit(rng));
+        bAmp[i] = 10.0 + 1000.0 * unit(rng);
+        bIn[i] = 1e4 * unit(rng) + 1.0;
+    }
+    timeIt("getAmountOutBatch (x*y=k)", n, [&] {
+        getAmountOutBatch(bIn.data(), bRIn.data(), bROut.data(), bFee.data(), bOut.data(), n);
+        return bOut[n - 1];
+    });
+    timeIt("getAmountOutStable", n, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < n; ++i) acc += getAmountOutStable(bIn[i], bRIn[i], bROut[i], 0.0004, bAmp[i]);
+        return acc;
+    });
+    for (int level = 0; level <= (int)best; ++level) {
+        setSimdLevel((SimdLevel)level);
+        const std::string name = std::string("getAmountOutStableBatch (") + simdLevelName((SimdLevel)level) + ")";
+        timeIt(name.c_str(), n, [&] {
+            getAmountOutStableBatch(bIn.data(), bRIn.data(), bROut.data(), bFee.data(), bAmp.data(), bOut.data(), n);
+            return bOut[n - 1];
+        });
+    }
+    setSimdLevel(best);
+    return bad == 0;
+}
+
+// Error of `got` in units in the last place of the (long double) reference.
+static double ulpError(double got, long double ref) {
+    const double r = (double)ref;
+    const double ulp = std::nextafter(std::fabs(r), INFINITY) - std::fabs(r);
+    return (double)(std::fabs((long double)got - ref) / ulp);
+}
+
+// Error report of the fast_math kernels (and std::pow for comparison)
+// against long double libm, batch == scalar at every SIMD level, weighted
+// pool checks (equal weights == x*y=k, closed form in long double), then
+// throughput next to the constant-product and StableSwap batches.
+static bool benchWeighted(size_t n) {
+    std::mt19937_64 rng(2718);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    size_t bad = 0;
+
+    const size_t samples = 200000;
+    double errLog = 0.0, errLog1p = 0.0, errExp = 0.0, errExpm1 = 0.0, errPow = 0.0, errStdPow = 0.0;
+    double worstPowMargin = 0.0;   // error / (2 + 3 |y log x|), must stay <= 1
+    for (size_t t = 0; t < samples; ++t) {
+        const double x = std::pow(10.0, -300.0 + 600.0 * unit(rng));
+        errLog = std::max(errLog, ulpError(fastLog(x), std::log((long double)x)));
+
+        const double u = (t & 1) ? std::pow(10.0, -20.0 + 30.0 * unit(rng)) : -0.9 * unit(rng);
+        errLog1p = std::max(errLog1p, ulpError(fastLog1p(u), std::log1p((long double)u)));
+
+        const double e = (t & 1) ? -700.0 + 1400.0 * unit(rng) : -1.0 + 2.0 * unit(rng);
+        errExp = std::max(errExp, ulpError(fastExp(e), std::exp((long double)e)));
+
+        const double m = (t & 1) ? -40.0 + 80.0 * unit(rng) : (unit(rng) - 0.5) * std::pow(10.0, -20.0 + 19.0 * unit(rng));
+        errExpm1 = std::max(errExpm1, ulpError(fastExpm1(m), std::expm1((long double)m)));
+
+        // Pool-shaped pow: base balanceIn / (balanceIn + amountIn), exponent a weight ratio.
+        const double base = 1.0 / (1.0 + std::pow(10.0, -12.0 + 14.0 * unit(rng)));
+        const double y = std::pow(10.0, -2.0 + 4.0 * unit(rng));
+        const long double ref = std::pow((long double)base, (long double)y);
+        const double ep = ulpError(fastPow(base, y), ref);
+        errPow = std::max(errPow, ep);
+        errStdPow = std::max(errStdPow, ulpError(std::pow(base, y), ref));
+        worstPowMargin = std::max(worstPowMargin, ep / (2.0 + 3.0 * std::fabs(y * std::log(base))));
+    }
+    if (errLog > 2.0 || errLog1p > 2.0 || errExp > 2.0 || errExpm1 > 2.0 || worstPowMargin > 1.0) ++bad;
+
+    const size_t lanes = 1003;   // odd: exercises every tail path
+    std::vector<double> x(lanes), y(lanes), got(lanes);
+    for (size_t i = 0; i < lanes; ++i) {
+        x[i] = std::pow(10.0, -30.0 + 60.0 * unit(rng));
+        y[i] = -50.0 + 100.0 * unit(rng);
+    }
+    const SimdLevel best = detectSimdLevel();
+    for (int level = 0; level <= (int)best; ++level) {
+        setSimdLevel((SimdLevel)level);
+        fastLogBatch(x.data(), got.data(), lanes);
+        for (size_t i = 0; i < lanes; ++i) if (got[i] != fastLog(x[i])) ++bad;
+        fastLog1pBatch(x.data(), got.data(), lanes);
+        for (size_t i = 0; i < lanes; ++i) if (got[i] != fastLog1p(x[i])) ++bad;
+        fastExpBatch(y.data(), got.data(), lanes);
+        for (size_t i = 0; i < lanes; ++i) if (got[i] != fastExp(y[i])) ++bad;
+        fastExpm1Batch(y.data(), got.data(), lanes);
+        for (size_t i = 0; i < lanes; ++i) if (got[i] != fastExpm1(y[i])) ++bad;
+        fastPowBatch(x.data(), y.data(), got.data(), lanes);
+        for (size_t i = 0; i < lanes; ++i) if (got[i] != fastPow(x[i], y[i])) ++bad;
+    }
+    setSimdLevel(best);
+    std::printf("fast_math: max ulp error log %.2f, log1p %.2f, exp %.2f, expm1 %.2f, "
+                "pool pow %.2f (std::pow %.2f, %.2f of bound); batch == scalar: %zu failures\n",
+                errLog, errLog1p, errExp, errExpm1, errPow, errStdPow, worstPowMargin, bad);
+
+    double worstCp = 0.0, worstRef = 0.0;
+    for (int t = 0; t < 20000; ++t) {
+        const double rIn = std::pow(10.0, 3.0 + 9.0 * unit(rng));
+        const double rOut = std::pow(10.0, 3.0 + 9.0 * unit(rng));
+        const double amountIn = rIn * std::pow(10.0, -9.0 + 10.0 * unit(rng));
+        const double fee = 0.01 * unit(rng);
+        const double w = 0.5 + 1.5 * unit(rng);
+        worstCp = std::max(worstCp, relDiff(getAmountOutWeighted(amountIn, rIn, rOut, fee, w, w),
+                                            getAmountOut(amountIn, rIn, rOut, fee)));
+
+        const double wIn = 0.01 + 0.98 * unit(rng);
+        const long double growth = (long double)amountIn * (1.0L - fee) / rIn;
+        const long double ref = (long double)rOut * -std::expm1(-std::log1p(growth) * (long double)wIn / (1.0L - wIn));
+        worstRef = std::max(worstRef, relDiff(getAmountOutWeighted(amountIn, rIn, rOut, fee, wIn, 1.0 - wIn), (double)ref));
+    }
+    if (worstCp > 1e-13 || worstRef > 1e-12) ++bad;
+
+    std::vector<double> rIn(lanes), rOut(lanes), fee(lanes), wIn(lanes), wOut(lanes), in(lanes), out(lanes);
+    std::vector<double> newIn(lanes), newOut(lanes), price(lanes), slip(lanes), want(lanes);
+    std::vector<uint8_t> err(lanes);
+    for (size_t i = 0; i < lanes; ++i) {
+        rIn[i] = std::pow(10.0, 3.0 + 9.0 * unit(rng));
+        rOut[i] = std::pow(10.0, 3.0 + 9.0 * unit(rng));
+        fee[i] = 0.01 * unit(rng);
+        wIn[i] = 0.2 + 0.6 * unit(rng);   // output stays well below reserveOut
+        wOut[i] = 1.0 - wIn[i];
+        in[i] = rIn[i] * std::pow(10.0, -9.0 + 9.0 * unit(rng));
+        want[i] = getAmountOutWeighted(in[i], rIn[i], rOut[i], fee[i], wIn[i], wOut[i]);
+    }
+    wOut[5] = 0.0;   // invalid lane
+    for (int level = 0; level <= (int)best; ++level) {
+        setSimdLevel((SimdLevel)level);
+        getAmountOutWeightedBatch(in.data(), rIn.data(), rOut.data(), fee.data(), wIn.data(), wOut.data(), out.data(), lanes);
+        for (size_t i = 0; i < lanes; ++i) {
+            if (i != 5 && out[i] != want[i]) ++bad;
+        }
+        const SwapBatchInput bin{rIn.data(), rOut.data(), fee.data(), in.data(), lanes};
+        const SwapBatchOutput bout{out.data(), newIn.data(), newOut.data(), price.data(), slip.data(), err.data()};
+        if (simulateWeightedSwapBatch(bin, wIn.data(), wOut.data(), bout) != 1 || !(err[5] & SwapBadWeight)) ++bad;
+        for (size_t i = 0; i < lanes; ++i) {
+            if (i == 5) continue;
+            const SwapResult r = simulateWeightedSwap<Direction::A2B>(rIn[i], rOut[i], fee[i], wIn[i], wOut[i], in[i]);
+            if (err[i] != 0 || out[i] != r.amountOut || newOut[i] != r.newReserveB || slip[i] != r.slippagePercent) ++bad;
+        }
+    }
+    setSimdLevel(best);
+
+    const SwapResult w8020 = simulateWeightedSwap<Direction::A2B>(1e6, 1e6, 0.003, 0.8, 0.2, 1e4);
+    const SwapResult cp = simulateSwap<Direction::A2B>(1e6, 1e6, 0.003, 1e4);
+    std::printf("weighted: equal weights vs x*y=k %.1e, vs long double %.1e, batch == scalar: %zu failures; "
+                "80/20 1%% trade slippage %.4f %% (x*y=k: %.4f %%)\n",
+                worstCp, worstRef, bad, w8020.slippagePercent, cp.slippagePercent);
+
+    std::vector<double> bIn(n), bRIn(n), bROut(n), bFee(n, 0.003), bWIn(n), bWOut(n), bOut(n);
+    for (size_t i = 0; i < n; ++i) {
+        bRIn[i] = 1e6 * (1.0 + unit(rng));
+        bROut[i] = 1e6 * (1.0 + unit(rng));
+        bWIn[i] = 0.2 + 0.6 * unit(rng);
+        bWOut[i] = 1.0 - bWIn[i];
+        bIn[i] = 1e4 * unit(rng) + 1.0;
+    }
+    timeIt("getAmountOutBatch (x*y=k)", n, [&] {
+        getAmountOutBatch(bIn.data(), bRIn.data(), bROut.data(), bFee.data(), bOut.data(), n);
+        return bOut[n - 1];
+    });
+    timeIt("weighted out via std::pow", n, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const double ratio = bRIn[i] / (bRIn[i] + bIn[i] * (1.0 - 0.003));
+            acc += bROut[i] * (1.0 - std::pow(ratio, bWIn[i] / bWOut[i]));
+        }
+        return acc;
+    });
+    timeIt("getAmountOutWeighted", n, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < n; ++i) acc += getAmountOutWeighted(bIn[i], bRIn[i], bROut[i], 0.003, bWIn[i], bWOut[i]);
+        return acc;
+    });
+    for (int level = 0; level <= (int)best; ++level) {
+        setSimdLevel((SimdLevel)level);
+        const std::string name = std::string("getAmountOutWeightedBatch (") + simdLevelName((SimdLevel)level) + ")";
+        timeIt(name.c_str(), n, [&] {
+            getAmountOutWeightedBatch(bIn.data(), bRIn.data(), bROut.data(), bFee.data(), bWIn.data(), bWOut.data(),
+                                      bOut.data(), n);
+            return bOut[n - 1];
+        });
+    }
+    setSimdLevel(best);
+    return bad == 0;
+}
+
+// The design PoolBatchPricer replaces: one heap object per pool behind a
+// virtual swap(), so every trade is an indirect call on a scattered object.
+struct VirtualPool {
+    virtual ~VirtualPool() = default;
+    virtual SwapResult swap(Direction dir, double amountIn) = 0;
+    double reserveA = 0.0, reserveB = 0.0, fee = 0.0;
+};
+
+struct VirtualCpPool : VirtualPool {
+    SwapResult swap(Direction dir, double amountIn) override {
+        const SwapResult r = simulateSwap(reserveA, reserveB, fee, dir, amountIn);
+        reserveA = r.newReserveA;
+        reserveB = r.newReserveB;
+        return r;
+    }
+};
+
+struct VirtualStablePool : VirtualPool {
+    double amp = 0.0;
+    SwapResult swap(Direction dir, double amountIn) override {
+        const SwapResult r = simulateStableSwap(reserveA, reserveB, fee, amp, dir, amountIn);
+        reserveA = r.newReserveA;
+        reserveB = r.newReserveB;
+        return r;
+    }
+};
+
+struct VirtualWeightedPool : VirtualPool {
+    double weightA = 0.0;
+    SwapResult swap(Direction dir, double amountIn) override {
+        const SwapResult r = simulateWeightedSwap(reserveA, reserveB, fee, weightA, 1.0 - weightA, dir, amountIn);
+        reserveA = r.newReserveA;
+        reserveB = r.newReserveB;
+        return r;
+    }
+};
+
+// Mixed-kind replay (60% x*y=k, 20% StableSwap, 20% weighted pools, random
+// trades): virtual interface vs PoolRegistry::applySwaps (a switch per
+// swap) vs replaySwaps (type-sorted buckets, one batch kernel per kind).
+// All three must leave bit-identical reserves.
+static bool benchMixedPools(size_t swaps) {
+    std::mt19937_64 rng(5150);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const size_t poolCount = 4096;
+
+    PoolRegistry base;
+    std::vector<std::unique_ptr<VirtualPool>> virtualPools;
+    for (size_t i = 0; i < poolCount; ++i) {
+        const TokenId a = base.internToken("T" + std::to_string(2 * i));
+        const TokenId b = base.internToken("T" + std::to_string(2 * i + 1));
+        const double reserveA = 1e6 * (1.0 + 9.0 * unit(rng));
+        const double reserveB = reserveA * (0.5 + unit(rng));
+        const double u = unit(rng);
+        if (u < 0.6) {
+            base.addPool(a, b, reserveA, reserveB, 0.003);
+            virtualPools.emplace_back(new VirtualCpPool());
+        } else if (u < 0.8) {
+            const double amp = 10.0 + 490.0 * unit(rng);
+            base.addPool(a, b, reserveA, reserveB, 0.0004, PoolKind::Stable, amp);
+            VirtualStablePool* p = new VirtualStablePool();
+            p->amp = amp;
+            virtualPools.emplace_back(p);
+        } else {
+            const double weightA = 0.2 + 0.6 * unit(rng);
+            base.addPool(a, b, reserveA, reserveB, 0.002, PoolKind::Weighted, weightA);
+            VirtualWeightedPool* p = new VirtualWeightedPool();
+            p->weightA = weightA;
+            virtualPools.emplace_back(p);
+        }
+        const Pool& p = base.pool((PoolId)i);
+        virtualPools.back()->reserveA = p.reserveA;
+        virtualPools.back()->reserveB = p.reserveB;
+        virtualPools.back()->fee = p.fee;
+    }
+
+    std::vector<PoolId> ids(swaps);
+    std::vector<Direction> dirs(swaps);
+    std::vector<double> amounts(swaps);
+    for (size_t i = 0; i < swaps; ++i) {
+        ids[i] = (PoolId)(rng() % poolCount);
+        dirs[i] = (rng() & 1) ? Direction::A2B : Direction::B2A;
+        amounts[i] = 1e3 * (0.01 + unit(rng));
+    }
+
+    timeIt("mixed: virtual interface", swaps, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < swaps; ++i) acc += virtualPools[ids[i]]->swap(dirs[i], amounts[i]).amountOut;
+        return acc;
+    });
+    PoolRegistry scalar = base;
+    timeIt("mixed: applySwaps (switch)", swaps, [&] {
+        scalar.applySwaps(ids.data(), dirs.data(), amounts.data(), swaps, nullptr);
+        return scalar.pool(0).reserveA;
+    });
+    PoolRegistry batched = base;
+    timeIt("mixed: replaySwaps (buckets)", swaps, [&] {
+        replaySwaps(batched, ids.data(), dirs.data(), amounts.data(), swaps);
+        return batched.pool(0).reserveA;
+    });
+
+    size_t bad = 0;
+    for (size_t i = 0; i < poolCount; ++i) {
+        const Pool& s = scalar.pool((PoolId)i);
+        const Pool& b = batched.pool((PoolId)i);
+        const VirtualPool& v = *virtualPools[i];
+        if (s.reserveA != v.reserveA || s.reserveB != v.reserveB || b.reserveA != v.reserveA ||
+            b.reserveB != v.reserveB || b.feeGrowthA != s.feeGrowthA || b.feeGrowthB != s.feeGrowthB) {
+            ++bad;
+        }
+    }
+
+    // Quoting without state updates, in full 1024-lane batches: here the
+    // buckets are not cut short by replay's flush on a repeated pool.
+    PoolBatchPricer pricer(1024);
+    std::vector<double> out(1024), newIn(1024), newOut(1024), price(1024), slip(1024);
+    std::vector<uint8_t> err(1024);
+    const SwapBatchOutput bout{out.data(), newIn.data(), newOut.data(), price.data(), slip.data(), err.data()};
+    const size_t quoted = swaps / 1024 * 1024;
+    timeIt("mixed: quoteSwap (switch)", quoted, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < quoted; ++i) acc += base.quoteSwap(ids[i], dirs[i], amounts[i]).amountOut;
+        return acc;
+    });
+    timeIt("mixed: PoolBatchPricer (buckets)", quoted, [&] {
+        double acc = 0.0;
+        for (size_t i = 0; i < quoted; i += 1024) {
+            pricer.price(base, ids.data() + i, dirs.data() + i, amounts.data() + i, 1024, bout);
+            acc += out[1023];
+        }
+        return acc;
+    });
+
+    // One full batch checked lane by lane: buckets cover every lane.
+    if (pricer.price(base, ids.data(), dirs.data(), amounts.data(), 1024, bout) != 0) ++bad;
+    size_t lanes = 0;
+    for (size_t k = 0; k < kPoolKinds; ++k) lanes += pricer.lastCount((PoolKind)k);
+    if (lanes != 1024) ++bad;
+    for (size_t i = 0; i < 1024; ++i) {
+        if (out[i] != base.quoteSwap(ids[i], dirs[i], amounts[i]).amountOut) ++bad;
+    }
+
+    std::printf("mixed pools: %zu pools (%zu x*y=k, %zu stable, %zu weighted), %zu swaps, "
+                "virtual == switch == buckets: %zu failures\n",
+                poolCount, base.poolsOfKind(PoolKind::ConstantProduct).size(),
+                base.poolsOfKind(PoolKind::Stable).size(), base.poolsOfKind(PoolKind::Weighted).size(), swaps, bad);
+    return bad == 0;
+}
+
+// A bad record N in the middle of a replay (malformed line, unknown pool)
+// must leave records 1..N-1 applied and written, exactly as one-by-one
+// applySwap would, even though most of them are still staged in the
+// batcher when the error is found.
+static bool benchReplayErrors() {
+    const size_t poolCount = 2048, good = 1500;   // one full batch, then 476 staged
+    PoolRegistry base;
+    for (size_t i = 0; i < poolCount; ++i) {
+        base.addPool(base.internToken("T" + std::to_string(2 * i)), base.internToken("T" + std::to_string(2 * i + 1)),
+                     1e6 + (double)i, 2e6 - (double)i, 0.003);
+    }
+    PoolRegistry expected = base;
+    std::vector<PoolId> ids(good + 2);
+    std::vector<Direction> dirs(good + 2);
+    std::vector<double> amounts(good + 2);
+    for (size_t i = 0; i < good + 2; ++i) {
+        ids[i] = (PoolId)(i % poolCount);
+        dirs[i] = (i & 1) ? Direction::B2A : Direction::A2B;
+        amounts[i] = 100.0 + (double)i;
+        if (i < good) expected.applySwap(ids[i], dirs[i], amounts[i]);
+    }
+    ids[good] = (PoolId)poolCount;   // record good + 1: unknown pool
+
+    const std::string path = (std::filesystem::temp_directory_path() / "crypt_bench_replay.csv").string();
+    size_t bad = 0;
+    for (int mode = 0; mode < 3; ++mode) {
+        PoolRegistry reg = base;
+        bool threw = false;
+        {
+            ResultSink sink(path, OutputFormat::Csv);
+            try {
+                if (mode == 2) {
+                    replaySwaps(reg, ids.data(), dirs.data(), amounts.data(), ids.size(), &sink);
+                } else {
+                    std::FILE* f = std::tmpfile();
+                    FileCloser closer{f};
+                    for (size_t i = 0; i < good; ++i) {
+                        std::fprintf(f, "%u,%s,%.17g\n", (unsigned)ids[i], dirs[i] == Direction::A2B ? "A2B" : "B2A",
+                                     amounts[i]);
+                    }
+                    if (mode == 0) {
+                        std::fputs("1,SIDEWAYS,5\n", f);
+                    } else {
+                        std::fprintf(f, "%zu,A2B,5\n", poolCount);
+                    }
+                    std::fprintf(f, "0,A2B,5\n");
+                    std::rewind(f);
+                    replayTradeLog(reg, f, &sink);
+                }
+            } catch (const std::exception& e) {
+                threw = std::string(e.what()).find(std::to_string(good + 1)) != std::string::npos;
+            }
+            sink.flush();
+        }
+        if (!threw) ++bad;
+
+        size_t rows = 0;
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (f) {
+            for (int ch; (ch = std::fgetc(f)) != EOF;) rows += (ch == '\n');
+            std::fclose(f);
+        }
+        if (rows != good) ++bad;
+        for (size_t i = 0; i < poolCount; ++i) {
+            const Pool& a = reg.pool((PoolId)i);
+            const Pool& b = expected.pool((PoolId)i);
+            if (a.reserveA != b.reserveA || a.reserveB != b.reserveB) ++bad;
+        }
+    }
+    std::remove(path.c_str());
+    std::printf("replay errors: bad line / unknown pool after %zu staged swaps, all applied and written: %zu failures\n",
+                good, bad);
+    return bad == 0;
+}
+
+// Mean and variance of n samples, and how far the mean is from `mean` in
+// standard errors of a distribution with variance `variance`.
+struct Moments {
+    double mean = 0.0, variance = 0.0, zMean = 0.0;
+};
+
+template <class T>
+static Moments moments(const T* x, size_t n, double mean, double variance) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) sum += (double)x[i];
+    Moments m;
+    m.mean = sum / (double)n;
+    double sq = 0.0;
+    for (size_t i = 0; i < n; ++i) sq += ((double)x[i] - m.mean) * ((double)x[i] - m.mean);
+    m.variance = sq / (double)(n - 1);
+    m.zMean = (m.mean - mean) / std::sqrt(variance / (double)n);
+    return m;
+}
+
+// Philox known-answer vectors (Random123 kat_vectors), batch == scalar at
+// every SIMD level, statistical sanity of each sampler, then throughput.
+static bool benchRng(size_t n) {
+    size_t bad = 0;
+    const Philox4x32 zero = Philox4x32::block(0, 0, 0, 0, 0, 0);
+    const Philox4x32 ones = Philox4x32::block(~0u, ~0u, ~0u, ~0u, ~0u, ~0u);
+    const uint32_t zeroExpected[4] = {0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u};
+    const uint32_t onesExpected[4] = {0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu};
+    for (int i = 0; i < 4; ++i) {
+        if (zero.v[i] != zeroExpected[i]) ++bad;
+        if (ones.v[i] != onesExpected[i]) ++bad;
+    }
+
+    // Batch kernels and fill* against the scalar stream, from odd offsets
+    // and across the 2^32 block boundary (carry into the high counter word).
+    const SimdLevel best = detectSimdLevel();
+    std::vector<uint32_t> words(4 * 1000 + 7);
+    std::vector<double> d(1001);
+    for (int level = 0; level <= (int)best; ++level) {
+        setSimdLevel((SimdLevel)level);
+        for (const uint64_t first : {(uint64_t)0, (uint64_t)0xfffffffbu}) {
+            philoxBlocks(0x0123456789abcdefull, 42, first, words.data(), 1000);
+            for (size_t b = 0; b < 1000; ++b) {
+                const uint64_t c = first + b;
+                const Philox4x32 r = Philox4x32::block((uint32_t)c, (uint32_t)(c >> 32), 42, 0, 0x89abcdefu, 0x01234567u);
+                for (int i = 0; i < 4; ++i) {
+                    if (words[4 * b + (size_t)i] != r.v[i]) ++bad;
+                }
+            }
+        }
+        PhiloxStream a(7, 3), b(7, 3);
+        for (int skip = 0; skip < 3; ++skip) a.nextU32(), b.nextU32();
+        a.fillU32(words.data(), words.size());
+        for (const uint32_t w : words) if (w != b.nextU32()) ++bad;
+        a.fillUniform(d.data(), d.size());
+        for (const double x : d) if (x != b.nextDouble()) ++bad;
+        a.fillNormal(d.data(), d.size());   // odd count: leaves a spare
+        for (const double x : d) if (x != b.nextNormal()) ++bad;
+        a.fillNormal(d.data(), d.size());   // starts from the spare
+        for (const double x : d) if (x != b.nextNormal()) ++bad;
+        if (a.nextU32() != b.nextU32()) ++bad;
+    }
+    setSimdLevel(best);
+
+    // Moments within 5 standard errors; uniform chi-square over 256 bins
+    // (255 degrees of freedom: 99.99% quantile is about 326).
+    size_t statBad = 0;
+    const auto check = [&](const char* name, const Moments& m, double variance, double tolerance) {
+        const bool ok = std::fabs(m.zMean) < 5.0 && std::fabs(m.variance / variance - 1.0) < tolerance;
+        if (!ok) {
+            ++statBad;
+            std::printf("  %s: mean %.6f (z %.2f), variance %.6f (expected %.6f)\n", name, m.mean, m.zMean, m.variance, variance);
+        }
+    };
+    std::vector<double> x(n);
+    std::vector<uint8_t> flags(n);
+    std::vector<uint32_t> counts(n);
+    PhiloxStream rng(2024, 0);
+
+    rng.fillUniform(x.data(), n);
+    check("uniform", moments(x.data(), n, 0.5, 1.0 / 12.0), 1.0 / 12.0, 0.02);
+    std::vector<double> bins(256, 0.0);
+    for (const double u : x) bins[(size_t)(u * 256.0)] += 1.0;
+    double chi2 = 0.0;
+    for (const double c : bins) chi2 += (c - (double)n / 256.0) * (c - (double)n / 256.0) / ((double)n / 256.0);
+    if (chi2 > 326.0) ++statBad;
+
+    rng.fillNormal(x.data(), n);
+    check("normal", moments(x.data(), n, 0.0, 1.0), 1.0, 0.02);
+
+    rng.fillLogNormal(x.data(), n, std::log(10.0), 0.5);
+    for (double& v : x) v = std::log(v);
+    check("lognormal (log)", moments(x.data(), n, std::log(10.0), 0.25), 0.25, 0.02);
+
+    rng.fillBernoulli(flags.data(), n, 0.3);
+    check("bernoulli", moments(flags.data(), n, 0.3, 0.21), 0.21, 0.02);
+
+    rng.fillExponential(x.data(), n, 4.0);
+    check("exponential", moments(x.data(), n, 0.25, 1.0 / 16.0), 1.0 / 16.0, 0.05);
+
+    for (const double lambda : {0.5, 4.0, 9.99, 10.0, 30.0, 1000.0}) {
+        rng.fillPoisson(counts.data(), n, lambda);
+        check("poisson", moments(counts.data(), n, lambda, lambda), lambda, 0.03);
+    }
+
+    // Neighbouring path streams must look independent: |correlation| < 5/sqrt(n).
+    std::vector<double> y(n);
+    PhiloxStream(2024, 1).fillUniform(x.data(), n);
+    PhiloxStream(2024, 2).fillUniform(y.data(), n);
+    double cov = 0.0;
+    for (size_t i = 0; i < n; ++i) cov += (x[i] - 0.5) * (y[i] - 0.5);
+    const double corr = cov / (double)n * 12.0;
+    if (std::fabs(corr) > 5.0 / std::sqrt((double)n)) ++statBad;
+
+    std::printf("rng: known answers and batch == scalar: %zu failures; statistics: chi2 %.1f, stream corr %.2e, %zu failures\n",
+                bad, chi2, corr, statBad);
+
+    timeIt("PhiloxStream::nextU32", n, [&] {
+        PhiloxStream s(1, 0);
+        uint32_t acc = 0;
+        for (size_t i = 0; i < n; ++i) acc ^= s.nextU32();
+        return (double)acc;
+    });
+    for (int level = 0; level <= (int)best; ++level) {
+        setSimdLevel((SimdLevel)level);
+        const std::string name = std::string("fillU32 (") + simdLevelName((SimdLevel)level) + ")";
+        PhiloxStream s(1, 0);
+        timeIt(name.c_str(), n, [&] {
+            s.fillU32(counts.data(), n);
+            return (double)counts[n - 1];
+        });
+    }
+    setSimdLevel(best);
+    timeIt("fillUniform", n, [&] { rng.fillUniform(x.data(), n); return x[n - 1]; });
+    timeIt("fillNormal", n, [&] { rng.fillNormal(x.data(), n); return x[n - 1]; });
+    timeIt("fillLogNormal", n, [&] { rng.fillLogNormal(x.data(), n, 0.0, 1.0); return x[n - 1]; });
+    timeIt("fillBernoulli", n, [&] { rng.fillBernoulli(flags.data(), n, 0.5); return (double)flags[n - 1]; });
+    timeIt("fillPoisson (lambda 4)", n, [&] { rng.fillPoisson(counts.data(), n, 4.0); return (double)counts[n - 1]; });
+    timeIt("fillPoisson (lambda 100)", n, [&] { rng.fillPoisson(counts.data(), n, 100.0); return (double)counts[n - 1]; });
+    return bad == 0 && statBad == 0;
+}
+
+static bool samePercentiles(const Percentiles& a, const Percentiles& b) {
+    return a.mean == b.mean && a.min == b.min && a.p1 == b.p1 && a.p5 == b.p5 && a.p25 == b.p25 &&
+           a.p50 == b.p50 && a.p75 == b.p75 && a.p95 == b.p95 && a.p99 == b.p99 && a.max == b.max;
+}
+
+// The Monte Carlo run on 1 and 4 threads must agree bit for bit.
+static bool benchMonteCarlo(uint64_t paths) {
+    size_t bad = 0;
+    OrderFlowSpec spec;
+    spec.paths = paths;
+    spec.sizeDistribution = SizeDistribution::Pareto;
+    spec.sizeShape = 1.5;
+    spec.a2bProbability = 0.6;
+    const OrderFlowStats one = simulateOrderFlow(spec, 1);
+    const OrderFlowStats four = simulateOrderFlow(spec, 4);
+    if (one.trades != four.trades || one.failed != four.failed || one.arbitrageTrades != four.arbitrageTrades ||
+        !samePercentiles(one.lpPnlPercent, four.lpPnlPercent) ||
+        !samePercentiles(one.impermanentLossPercent, four.impermanentLossPercent) ||
+        !samePercentiles(one.slippagePercent, four.slippagePercent)) {
+        ++bad;
+    }
+
+    // Flat price, fixed-size A2B flow and no arbitrage: each trade's
+    // slippage must be simulateSwap's, bit for bit.
+    std::mt19937_64 rng(31337);
+    std::uniform_real_distribution<double> logSize(-1.0, 3.5);
+    const double fees[] = {0.0, 0.0005, 0.003, 0.01};
+    for (int trial = 0; trial < 200; ++trial) {
+        OrderFlowSpec flat;
+        flat.paths = 1;
+        flat.steps = 5;
+        flat.fee = fees[trial % 4];
+        flat.sizeShape = 0.0;
+        flat.sizeMedian = std::pow(10.0, logSize(rng));
+        flat.a2bProbability = 1.0;
+        flat.volatility = 0.0;
+        flat.arbitrage = false;
+        const OrderFlowStats fs = simulateOrderFlow(flat, 1);
+        double rA = flat.reserveA, rB = flat.reserveB, lo = 1e300, hi = -1e300;
+        for (uint32_t i = 0; i < flat.steps; ++i) {
+            const SwapResult r = simulateSwap<Direction::A2B>(rA, rB, flat.fee, flat.sizeMedian);
+            lo = std::min(lo, r.slippagePercent);
+            hi = std::max(hi, r.slippagePercent);
+            rA = r.newReserveA;
+            rB = r.newReserveB;
+        }
+        if (fs.trades != flat.steps || fs.slippagePercent.min != lo || fs.slippagePercent.max != hi) ++bad;
+    }
+    std::printf("order flow: %llu paths x %u trades: %.2f M trades/s, LP PnL p50 %.4f %%, 1 vs 4 threads %s, %zu failures\n",
+                (unsigned long long)paths, spec.steps, (double)one.trades / one.seconds / 1e6,
+                one.lpPnlPercent.p50, bad == 0 ? "identical" : "DIFFER", bad);
+    return bad == 0;
+}
+
+int main(int argc, char** argv) {
+    const size_t n = (argc > 1) ? (size_t)std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const ExactInputs in = makeInputs(n);
+
+    if (!differentialCheck(in)) return 1;
+    if (!inverseCheck(in)) return 1;
+    if (!checkAmountOutBatch()) return 1;
+    std::printf("timings: median of 5 runs where repeatable; cycles are TSC ticks at %.2f GHz\n", tscHz() / 1e9);
+
+    benchQuoting(in);
+    if (!benchNumberParsing(n)) return 1;
+    if (!benchDirectionParsing(n)) return 1;
+    benchOutputFormatting(in);
+    if (!benchStageStats(n)) return 1;
+    if (!benchLatencyHistogram(n)) return 1;
+    if (!benchTradeSplit()) return 1;
+    if (!benchRouting(std::max<size_t>(n / 1000, 100))) return 1;
+    if (!benchArbitrage(std::max<size_t>(n / 1000, 100))) return 1;
+    if (!benchLpBook(std::max<size_t>(n, 1000))) return 1;
+    if (!benchConcentrated(std::max<size_t>(n / 100, 1000))) return 1;
+    if (!benchStableSwap(std::max<size_t>(n, 1000))) return 1;
+    if (!benchWeighted(std::max<size_t>(n, 1000))) return 1;
+    if (!benchMixedPools(std::max<size_t>(n, 10000))) return 1;
+    if (!benchReplayErrors()) return 1;
+    if (!benchRng(std::max<size_t>(n, 100000))) return 1;
+    if (!benchMonteCarlo(std::max<uint64_t>(n / 100, 1000))) return 1;
+    return 0;
+}
@@ -0,0 +1,423 @@
+#include "concentrated.h"
+
+#include <cmath>
+#include <utility>
+
+namespace {
+
+const uint32_t kFeeDenominator = 1000000;   // pips
+
+// 2^96 (Q96) and the v3 sqrt price bounds: sqrtRatioAtTick(kMinTick / kMaxTick).
+const Uint256 kQ96 = shiftLeft(Uint256(1), 96);
+const Uint256 kMinSqrtRatio(4295128739ull);
+const Uint256 kMaxSqrtRatio = [] {
+    Uint256 r;
+    r.limb[0] = 0x5d951d5263988d26ull;
+    r.limb[1] = 0xefd1fc6a50648849ull;
+    r.limb[2] = 0xfffd8963ull;
+    return r;
+}();
+
+Uint256 u128(uint64_t hi, uint64_t lo) {
+    Uint256 r(lo);
+    r.limb[1] = hi;
+    return r;
+}
+
+bool fitsUint128(const Uint256& v) {
+    return (v.limb[2] | v.limb[3]) == 0;
+}
+
+// Two's complement arithmetic mod 2^256 (liquidityNet may be negative).
+Uint256 wrappingAdd(const Uint256& a, const Uint256& b) {
+    bool ignored = false;
+    return addChecked(a, b, ignored);
+}
+
+Uint256 wrappingSub(const Uint256& a, const Uint256& b) {
+    bool ignored = false;
+    return subChecked(a, b, ignored);
+}
+
+Uint256 mulDivChecked(const Uint256& a, const Uint256& b, const Uint256& d, bool roundUp) {
+    bool overflow = false;
+    const Uint256 r = mulDiv(a, b, d, roundUp, overflow);
+    require(!overflow, "256-bit overflow in concentrated-liquidity math");
+    return r;
+}
+
+Uint256 divRoundingUp(const Uint256& a, const Uint256& b) {
+    Uint256 rem;
+    Uint256 q = divFloor(a, b, &rem);
+    if (!rem.isZero()) q = wrappingAdd(q, Uint256(1));
+    return q;
+}
+
+int32_t floorDiv(int32_t a, int32_t b) {
+    const int32_t q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+int highestBit(uint64_t x) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(x);
+#else
+    int n = 63;
+    while (!(x >> n)) --n;
+    return n;
+#endif
+}
+
+int lowestBit(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!((x >> n) & 1)) ++n;
+    return n;
+#endif
+}
+
+// SqrtPriceMath.getAmount0Delta: L * (sqrtB - sqrtA) / (sqrtA * sqrtB), in token0.
+Uint256 amount0Delta(Uint256 sqrtA, Uint256 sqrtB, const Uint256& liquidity, bool roundUp) {
+    if (sqrtB < sqrtA) std::swap(sqrtA, sqrtB);
+    const Uint256 numerator1 = shiftLeft(liquidity, 96);
+    bool underflow = false;
+    const Uint256 numerator2 = subChecked(sqrtB, sqrtA, underflow);
+    return roundUp ? divRoundingUp(mulDivChecked(numerator1, numerator2, sqrtB, true), sqrtA)
+                   : divFloor(mulDivChecked(numerator1, numerator2, sqrtB, false), sqrtA);
+}
+
+// SqrtPriceMath.getAmount1Delta: L * (sqrtB - sqrtA), in token1.
+Uint256 amount1Delta(Uint256 sqrtA, Uint256 sqrtB, const Uint256& liquidity, bool roundUp) {
+    if (sqrtB < sqrtA) std::swap(sqrtA, sqrtB);
+    bool underflow = false;
+    return mulDivChecked(liquidity, subChecked(sqrtB, sqrtA, underflow), kQ96, roundUp);
+}
+
+// SqrtPriceMath.getNextSqrtPriceFromInput (token0 in moves the price down,
+// rounded up; token1 in moves it up, rounded down).
+Uint256 nextSqrtPriceFromInput(const Uint256& sqrtP, const Uint256& liquidity, const Uint256& amountIn,
+                               bool zeroForOne) {
+    if (zeroForOne) {
+        if (amountIn.isZero()) return sqrtP;
+        const Uint256 numerator1 = shiftLeft(liquidity, 96);
+        bool overflow = false;
+        const Uint256 product = mulChecked(amountIn, sqrtP, overflow);
+        if (!overflow) {
+            const Uint256 denominator = addChecked(numerator1, product, overflow);
+            if (!overflow) return mulDivChecked(numerator1, sqrtP, denominator, true);
+        }
+        overflow = false;
+        const Uint256 denominator = addChecked(divFloor(numerator1, sqrtP), amountIn, overflow);
+        require(!overflow, "256-bit overflow in concentrated-liquidity math");
+        return divRoundingUp(numerator1, denominator);
+    }
+
+    const Uint256 quotient = amountIn.bitLength() <= 160 ? divFloor(shiftLeft(amountIn, 96), liquidity)
+                                                         : mulDivChecked(amountIn, kQ96, liquidity, false);
+    bool overflow = false;
+    const Uint256 next = addChecked(sqrtP, quotient, overflow);
+    require(!overflow && next.bitLength() <= 160, "sqrt price overflow");
+    return next;
+}
+
+struct SwapStep {
+    Uint256 sqrtNext, amountIn, amountOut, feeAmount;
+};
+
+// SwapMath.computeSwapStep for an exact input: moves from sqrtCurrent
+// towards sqrtTarget until either the target or the end of the input.
+SwapStep computeSwapStep(const Uint256& sqrtCurrent, const Uint256& sqrtTarget, const Uint256& liquidity,
+                         const Uint256& amountRemaining, uint32_t feePips) {
+    const bool zeroForOne = sqrtCurrent >= sqrtTarget;
+    SwapStep st;
+
+    const Uint256 remainingLessFee =
+        mulDivChecked(amountRemaining, Uint256(kFeeDenominator - feePips), Uint256(kFeeDenominator), false);
+    st.amountIn = zeroForOne ? amount0Delta(sqrtTarget, sqrtCurrent, liquidity, true)
+                             : amount1Delta(sqrtCurrent, sqrtTarget, liquidity, true);
+    st.sqrtNext = remainingLessFee >= st.amountIn
+                      ? sqrtTarget
+                      : nextSqrtPriceFromInput(sqrtCurrent, liquidity, remainingLessFee, zeroForOne);
+
+    const bool reachedTarget = st.sqrtNext == sqrtTarget;
+    if (zeroForOne) {
+        if (!reachedTarget) st.amountIn = amount0Delta(st.sqrtNext, sqrtCurrent, liquidity, true);
+        st.amountOut = amount1Delta(st.sqrtNext, sqrtCurrent, liquidity, false);
+    } else {
+        if (!reachedTarget) st.amountIn = amount1Delta(sqrtCurrent, st.sqrtNext, liquidity, true);
+        st.amountOut = amount0Delta(sqrtCurrent, st.sqrtNext, liquidity, false);
+    }
+
+    // Stopping short of the target means the input ran out: the rest is fee.
+    st.feeAmount = !reachedTarget ? wrappingSub(amountRemaining, st.amountIn)
+                                  : mulDivChecked(st.amountIn, Uint256(feePips),
+                                                  Uint256(kFeeDenominator - feePips), true);
+    return st;
+}
+
+} // namespace
+
+Uint256 sqrtRatioAtTick(int32_t tick) {
+    require(tick >= kMinTick && tick <= kMaxTick, "tick out of range");
+    const uint32_t absTick = (uint32_t)(tick < 0 ? -(int64_t)tick : tick);
+
+    // ratio = 2^128 / sqrt(1.0001)^absTick, one Q128 factor per set bit.
+    static const Uint256 factors[19] = {
+        u128(0xfff97272373d4132ull, 0x59a46990580e213aull), u128(0xfff2e50f5f656932ull, 0xef12357cf3c7fdccull),
+        u128(0xffe5caca7e10e4e6ull, 0x1c3624eaa0941cd0ull), u128(0xffcb9843d60f6159ull, 0xc9db58835c926644ull),
+        u128(0xff973b41fa98c081ull, 0x472e6896dfb254c0ull), u128(0xff2ea16466c96a38ull, 0x43ec78b326b52861ull),
+        u128(0xfe5dee046a99a2a8ull, 0x11c461f1969c3053ull), u128(0xfcbe86c7900a88aeull, 0xdcffc83b479aa3a4ull),
+        u128(0xf987a7253ac41317ull, 0x6f2b074cf7815e54ull), u128(0xf3392b0822b70005ull, 0x940c7a398e4b70f3ull),
+        u128(0xe7159475a2c29b74ull, 0x43b29c7fa6e889d9ull), u128(0xd097f3bdfd2022b8ull, 0x845ad8f792aa5825ull),
+        u128(0xa9f746462d870fdfull, 0x8a65dc1f90e061e5ull), u128(0x70d869a156d2a1b8ull, 0x90bb3df62baf32f7ull),
+        u128(0x31be135f97d08fd9ull, 0x81231505542fcfa6ull), u128(0x09aa508b5b7a84e1ull, 0xc677de54f3e99bc9ull),
+        u128(0x005d6af8dedb8119ull, 0x6699c329225ee604ull), u128(0x00002216e584f5faull, 0x1ea926041bedfe98ull),
+        u128(0x00000000048a1703ull, 0x91f7dc42444e8fa2ull)};
+
+    Uint256 ratio = (absTick & 1) ? u128(0xfffcb933bd6fad37ull, 0xaa2d162d1a594001ull) : shiftLeft(Uint256(1), 128);
+    bool overflow = false;
+    for (int bit = 1; bit < 20; ++bit) {
+        if (absTick & (1u << bit)) ratio = shiftRight(mulChecked(ratio, factors[bit - 1], overflow), 128);
+    }
+    if (tick > 0) {
+        Uint256 max;
+        for (uint64_t& l : max.limb) l = ~0ull;
+        ratio = divFloor(max, ratio);
+    }
+
+    // Q128 -> Q96, rounded up so tickAtSqrtRatio(sqrtRatioAtTick(t)) == t.
+    Uint256 sqrtPrice = shiftRight(ratio, 32);
+    if ((ratio.limb[0] & 0xffffffffull) != 0) sqrtPrice = wrappingAdd(sqrtPrice, Uint256(1));
+    return sqrtPrice;
+}
+
+int32_t tickAtSqrtRatio(const Uint256& sqrtPriceX96) {
+    require(sqrtPriceX96 >= kMinSqrtRatio && sqrtPriceX96 < kMaxSqrtRatio, "sqrt price out of range");
+    // Start from the double estimate, then settle on the exact tick.
+    const double estimate = 2.0 * std::log(sqrtPriceX96.toDouble() / 79228162514264337593543950336.0) /
+                            std::log(1.0001);
+    int32_t tick = (int32_t)std::floor(estimate);
+    if (tick < kMinTick) tick = kMinTick;
+    if (tick > kMaxTick) tick = kMaxTick;
+    while (tick > kMinTick && sqrtRatioAtTick(tick) > sqrtPriceX96) --tick;
+    while (tick < kMaxTick && sqrtRatioAtTick(tick + 1) <= sqrtPriceX96) ++tick;
+    return tick;
+}
+
+TickBitmap::TickBitmap(int32_t tickSpacing) : spacing_(tickSpacing) {
+    require(tickSpacing > 0 && tickSpacing <= 16384, "tickSpacing must be in [1, 16384]");
+    // One spare word on each side: searches start from tick - 1 and compressed + 1.
+    minWord_ = floorDiv(floorDiv(kMinTick, spacing_), 256) - 1;
+    const int32_t maxWord = floorDiv(floorDiv(kMaxTick, spacing_), 256) + 1;
+    limbs_.assign(4 * (size_t)(maxWord - minWord_ + 1), 0);
+}
+
+const uint64_t* TickBitmap::word(int32_t compressed, int& bit) const {
+    const int32_t w = floorDiv(compressed, 256);
+    bit = compressed - w * 256;
+    return &limbs_[4 * (size_t)(w - minWord_)];
+}
+
+void TickBitmap::flip(int32_t tick) {
+    require(tick >= kMinTick && tick <= kMaxTick, "tick out of range");
+    require(tick % spacing_ == 0, "tick is not a multiple of tickSpacing");
+    int bit;
+    uint64_t* w = const_cast<uint64_t*>(word(tick / spacing_, bit));
+    w[bit / 64] ^= 1ull << (bit % 64);
+}
+
+bool TickBitmap::isSet(int32_t tick) const {
+    if (tick < kMinTick || tick > kMaxTick || tick % spacing_ != 0) return false;
+    int bit;
+    const uint64_t* w = word(tick / spacing_, bit);
+    return (w[bit / 64] >> (bit % 64)) & 1;
+}
+
+int32_t TickBitmap::nextInitializedTickWithinOneWord(int32_t tick, bool lte, bool& initialized) const {
+    const int32_t compressed = floorDiv(tick, spacing_);
+    int bit;
+    if (lte) {
+        // Highest set bit at or below `bit`, else the start of the word.
+        const uint64_t* w = word(compressed, bit);
+        int limb = bit / 64;
+        uint64_t masked = w[limb] & (bit % 64 == 63 ? ~0ull : (2ull << (bit % 64)) - 1);
+        while (masked == 0 && limb > 0) masked = w[--limb];
+        initialized = masked != 0;
+        const int found = initialized ? limb * 64 + highestBit(masked) : 0;
+        return (compressed - (bit - found)) * spacing_;
+    }
+
+    // Lowest set bit above `compressed`, else the end of the word.
+    const uint64_t* w = word(compressed + 1, bit);
+    int limb = bit / 64;
+    uint64_t masked = w[limb] & (~0ull << (bit % 64));
+    while (masked == 0 && limb < 3) masked = w[++limb];
+    initialized = masked != 0;
+    const int found = initialized ? limb * 64 + lowestBit(masked) : 255;
+    return (compressed + 1 + (found - bit)) * spacing_;
+}
+
+ConcentratedPool::ConcentratedPool(uint32_t feePips, int32_t tickSpacing, const Uint256& sqrtPriceX96)
+    : feePips_(feePips), tickSpacing_(tickSpacing), bitmap_(tickSpacing) {
+    require(feePips < kFeeDenominator, "fee must be below 1000000 pips");
+    state_.sqrtPriceX96 = sqrtPriceX96;
+    state_.tick = tickAtSqrtRatio(sqrtPriceX96);
+}
+
+double ConcentratedPool::price() const {
+    const double s = state_.sqrtPriceX96.toDouble() / 79228162514264337593543950336.0;
+    return s * s;
+}
+
+void ConcentratedPool::updateTick(int32_t tick, const Uint256& liquidity, bool upper) {
+    TickInfo& t = ticks_[tick];
+    if (t.liquidityGross.isZero()) bitmap_.flip(tick);
+    bool overflow = false;
+    t.liquidityGross = addChecked(t.liquidityGross, liquidity, overflow);
+    require(!overflow && fitsUint128(t.liquidityGross), "liquidity per tick overflows 128 bits");
+    t.liquidityNet = upper ? wrappingSub(t.liquidityNet, liquidity) : wrappingAdd(t.liquidityNet, liquidity);
+}
+
+void ConcentratedPool::addLiquidity(int32_t tickLower, int32_t tickUpper, const Uint256& liquidity,
+                                    Uint256* amount0, Uint256* amount1) {
+    require(tickLower < tickUpper, "tickLower must be below tickUpper");
+    require(tickLower >= kMinTick && tickUpper <= kMaxTick, "tick out of range");
+    require(tickLower % tickSpacing_ == 0 && tickUpper % tickSpacing_ == 0,
+            "ticks must be multiples of tickSpacing");
+    require(!liquidity.isZero() && fitsUint128(liquidity), "liquidity must be in (0, 2^128)");
+
+    const Uint256 sqrtLower = sqrtRatioAtTick(tickLower);
+    const Uint256 sqrtUpper = sqrtRatioAtTick(tickUpper);
+    Uint256 in0, in1;
+    if (state_.tick < tickLower) {
+        in0 = amount0Delta(sqrtLower, sqrtUpper, liquidity, true);
+    } else if (state_.tick < tickUpper) {
+        in0 = amount0Delta(state_.sqrtPriceX96, sqrtUpper, liquidity, true);
+        in1 = amount1Delta(sqrtLower, state_.sqrtPriceX96, liquidity, true);
+        bool overflow = false;
+        const Uint256 active = addChecked(state_.liquidity, liquidity, overflow);
+        require(!overflow && fitsUint128(active), "active liquidity overflows 128 bits");
+        state_.liquidity = active;
+    } else {
+        in1 = amount1Delta(sqrtLower, sqrtUpper, liquidity, true);
+    }
+
+    updateTick(tickLower, liquidity, false);
+    updateTick(tickUpper, liquidity, true);
+
+    bool overflow = false;
+    balance0_ = addChecked(balance0_, in0, overflow);
+    balance1_ = addChecked(balance1_, in1, overflow);
+    require(!overflow, "pool balance overflows 256 bits");
+    if (amount0) *amount0 = in0;
+    if (amount1) *amount1 = in1;
+}
+
+ConcentratedSwapResult ConcentratedPool::run(Direction dir, const Uint256& amountIn,
+                                             const Uint256& sqrtPriceLimitX96, State& s) const {
+    const bool zeroForOne = dir == Direction::A2B;
+    require(!amountIn.isZero(), "amountIn must be > 0");
+
+    Uint256 limit = sqrtPriceLimitX96;
+    if (limit.isZero()) {
+        limit = zeroForOne ? wrappingAdd(kMinSqrtRatio, Uint256(1)) : wrappingSub(kMaxSqrtRatio, Uint256(1));
+    }
+    require(zeroForOne ? (limit < s.sqrtPriceX96 && limit > kMinSqrtRatio)
+                       : (limit > s.sqrtPriceX96 && limit < kMaxSqrtRatio),
+            "price limit is on the wrong side of the current price");
+
+    ConcentratedSwapResult r;
+    Uint256 remaining = amountIn;
+    while (!remaining.isZero() && s.sqrtPriceX96 != limit) {
+        const Uint256 start = s.sqrtPriceX96;
+        bool initialized = false;
+        int32_t tickNext = bitmap_.nextInitializedTickWithinOneWord(s.tick, zeroForOne, initialized);
+        if (tickNext < kMinTick) tickNext = kMinTick;
+        if (tickNext > kMaxTick) tickNext = kMaxTick;
+
+        const Uint256 sqrtNext = sqrtRatioAtTick(tickNext);
+        const Uint256 target = zeroForOne ? (sqrtNext < limit ? limit : sqrtNext)
+                                          : (sqrtNext > limit ? limit : sqrtNext);
+        const SwapStep st = computeSwapStep(s.sqrtPriceX96, target, s.liquidity, remaining, feePips_);
+        s.sqrtPriceX96 = st.sqrtNext;
+        remaining = wrappingSub(remaining, wrappingAdd(st.amountIn, st.feeAmount));
+        r.amountOut = wrappingAdd(r.amountOut, st.amountOut);
+        r.feeAmount = wrappingAdd(r.feeAmount, st.feeAmount);
+
+        if (s.sqrtPriceX96 == sqrtNext) {
+            if (initialized) {
+                // Crossing down leaves ranges starting here; crossing up enters them.
+                const Uint256& net = ticks_.at(tickNext).liquidityNet;
+                s.liquidity = zeroForOne ? wrappingSub(s.liquidity, net) : wrappingAdd(s.liquidity, net);
+                require(fitsUint128(s.liquidity), "active liquidity out of range");
+                ++r.ticksCrossed;
+            }
+            s.tick = zeroForOne ? tickNext - 1 : tickNext;
+        } else if (s.sqrtPriceX96 != start) {
+            s.tick = tickAtSqrtRatio(s.sqrtPriceX96);
+        }
+    }
+
+    r.amountIn = wrappingSub(amountIn, remaining);
+    r.sqrtPriceX96 = s.sqrtPriceX96;
+    r.tick = s.tick;
+    return r;
+}
+
+ConcentratedSwapResult ConcentratedPool::quote(Direction dir, const Uint256& amountIn,
+                                               const Uint256& sqrtPriceLimitX96) const {
+    State s = state_;
+    return run(dir, amountIn, sqrtPriceLimitX96, s);
+}
+
+ConcentratedSwapResult ConcentratedPool::swap(Direction dir, const Uint256& amountIn,
+                                              const Uint256& sqrtPriceLimitX96) {
+    State s = state_;
+    const ConcentratedSwapResult r = run(dir, amountIn, sqrtPriceLimitX96, s);
+
+    Uint256& balanceIn = dir == Direction::A2B ? balance0_ : balance1_;
+    Uint256& balanceOut = dir == Direction::A2B ? balance1_ : balance0_;
+    bool overflow = false;
+    const Uint256 newIn = addChecked(balanceIn, r.amountIn, overflow);
+    const Uint256 newOut = subChecked(balanceOut, r.amountOut, overflow);
+    require(!overflow, "pool balance out of range");
+    balanceIn = newIn;
+    balanceOut = newOut;
+    state_ = s;
+    return r;
+}
+
+SwapResult ConcentratedPool::toSwapResult(Direction dir, const Uint256& amountIn,
+                                          const ConcentratedSwapResult& r) const {
+    require(r.amountIn == amountIn, "amountIn exceeds the liquidity in range (invalid trade)");
+    const bool aToB = dir == Direction::A2B;
+    const double in = amountIn.toDouble();
+    const double out = r.amountOut.toDouble();
+    const double p = price();
+
+    SwapResult s;
+    s.amountOut = out;
+    s.newReserveA = balance0_.toDouble() + (aToB ? in : -out);
+    s.newReserveB = balance1_.toDouble() + (aToB ? -out : in);
+    s.effectivePrice = out / in;
+    const double spot = aToB ? p : 1.0 / p;
+    s.slippagePercent = (spot - s.effectivePrice) / spot * 100.0;
+    return s;
+}
+
+SwapResult ConcentratedPool::simulateSwap(Direction dir, double amountIn) const {
+    require(amountIn >= 1.0, "amountIn must be at least one token unit");
+    const Uint256 in = Uint256::fromDouble(amountIn);
+    return toSwapResult(dir, in, quote(dir, in));
+}
+
+SwapResult ConcentratedPool::applySwap(Direction dir, double amountIn) {
+    require(amountIn >= 1.0, "amountIn must be at least one token unit");
+    const Uint256 in = Uint256::fromDouble(amountIn);
+    const ConcentratedSwapResult q = quote(dir, in);
+    const SwapResult s = toSwapResult(dir, in, q);   // throws before any state changes
+    swap(dir, in);
+    return s;
+}
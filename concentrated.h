@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "amm.h"
+#include "uint256.h"
+
+// Uniswap v3 TickMath range: price = 1.0001^tick.
+const int32_t kMinTick = -887272;
+const int32_t kMaxTick = 887272;
+
+// TickMath.getSqrtRatioAtTick: sqrt(1.0001^tick) in Q64.96, bit-exact.
+Uint256 sqrtRatioAtTick(int32_t tick);
+
+// TickMath.getTickAtSqrtRatio: the greatest tick whose sqrt ratio is
+// <= sqrtPriceX96 (which must be in [sqrtRatioAtTick(kMinTick), sqrtRatioAtTick(kMaxTick))).
+int32_t tickAtSqrtRatio(const Uint256& sqrtPriceX96);
+
+// Initialized ticks as bits in the Uniswap v3 TickBitmap layout: tick / tickSpacing
+// is one bit, 256 of them make a word. Words are stored densely over the
+// whole tick range (at most ~7k words of 32 bytes), so a lookup is an index
+// plus a scan of four 64-bit limbs with clz/ctz.
+class TickBitmap {
+public:
+    explicit TickBitmap(int32_t tickSpacing);
+
+    void flip(int32_t tick);   // tick must be a multiple of tickSpacing
+    bool isSet(int32_t tick) const;
+
+    // TickBitmap.nextInitializedTickWithinOneWord: the next initialized
+    // tick at or below `tick` (lte) or above it, but not beyond the edge
+    // of the word being searched; initialized = false when that edge is returned.
+    int32_t nextInitializedTickWithinOneWord(int32_t tick, bool lte, bool& initialized) const;
+
+private:
+    const uint64_t* word(int32_t compressed, int& bit) const;
+
+    int32_t spacing_;
+    int32_t minWord_;
+    std::vector<uint64_t> limbs_;   // 4 per word, least significant first
+};
+
+// Exact-input swap on a concentrated-liquidity pool, in raw token units.
+struct ConcentratedSwapResult {
+    Uint256 amountIn;        // taken from the trader, fee included; less than asked if the price limit was hit
+    Uint256 amountOut;
+    Uint256 feeAmount;
+    Uint256 sqrtPriceX96;    // after the swap
+    int32_t tick = 0;
+    uint32_t ticksCrossed = 0;
+};
+
+// A Uniswap v3-style pool with token0 = A and token1 = B, so the price
+// (B per A) is (sqrtPriceX96 / 2^96)^2. Liquidity sits in tick ranges and
+// only ranges containing the current price are active. A swap walks from
+// tick to tick, and crossing an initialized tick adds or removes that
+// range's liquidity.
+//
+// The math is a port of the v3 core libraries (TickMath, SqrtPriceMath,
+// SwapMath, FullMath, TickBitmap) with their rounding and their one-word
+// search steps, so exact-input swaps match the contract to the unit.
+// Not modelled: protocol fees, the price oracle and per-position fees.
+class ConcentratedPool {
+public:
+    // feePips is in hundredths of a bip (3000 = 0.3%).
+    ConcentratedPool(uint32_t feePips, int32_t tickSpacing, const Uint256& sqrtPriceX96);
+
+    // Pool.mint: adds liquidity on [tickLower, tickUpper) (multiples of
+    // tickSpacing). The tokens the depositor pays (rounded up) go to amount0/amount1.
+    void addLiquidity(int32_t tickLower, int32_t tickUpper, const Uint256& liquidity,
+                      Uint256* amount0 = nullptr, Uint256* amount1 = nullptr);
+
+    // Pool.swap with an exact input. sqrtPriceLimitX96 = 0 means no limit.
+    // quote() leaves the pool unchanged.
+    ConcentratedSwapResult quote(Direction dir, const Uint256& amountIn,
+                                 const Uint256& sqrtPriceLimitX96 = Uint256()) const;
+    ConcentratedSwapResult swap(Direction dir, const Uint256& amountIn,
+                                const Uint256& sqrtPriceLimitX96 = Uint256());
+
+    // Same shape and meaning as simulateSwap: amountIn is floored to whole
+    // token units and reserves are the token balances the pool holds.
+    // Throws if the liquidity in range cannot absorb all of amountIn.
+    SwapResult simulateSwap(Direction dir, double amountIn) const;
+    SwapResult applySwap(Direction dir, double amountIn);
+
+    const Uint256& sqrtPriceX96() const { return state_.sqrtPriceX96; }
+    int32_t tick() const { return state_.tick; }
+    const Uint256& liquidity() const { return state_.liquidity; }
+    uint32_t feePips() const { return feePips_; }
+    int32_t tickSpacing() const { return tickSpacing_; }
+    const Uint256& balance0() const { return balance0_; }
+    const Uint256& balance1() const { return balance1_; }
+
+    // Spot price of A in B (reporting only).
+    double price() const;
+
+private:
+    struct TickInfo {
+        Uint256 liquidityGross;
+        Uint256 liquidityNet;   // two's complement: removed when crossed upward
+    };
+
+    struct State {
+        Uint256 sqrtPriceX96;
+        int32_t tick = 0;
+        Uint256 liquidity;
+    };
+
+    ConcentratedSwapResult run(Direction dir, const Uint256& amountIn, const Uint256& sqrtPriceLimitX96,
+                               State& s) const;
+    SwapResult toSwapResult(Direction dir, const Uint256& amountIn, const ConcentratedSwapResult& r) const;
+    void updateTick(int32_t tick, const Uint256& liquidity, bool upper);
+
+    uint32_t feePips_;
+    int32_t tickSpacing_;
+    State state_;
+    Uint256 balance0_, balance1_;
+    TickBitmap bitmap_;
+    std::unordered_map<int32_t, TickInfo> ticks_;
+};
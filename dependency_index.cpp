@@ -0,0 +1,80 @@
+#include "dependency_index.h"
+
+#include <algorithm>
+
+DependencyIndex::DepId DependencyIndex::add(const std::vector<PoolId>& pools) {
+    DepId id;
+    if (!free_.empty()) {
+        id = free_.back();
+        free_.pop_back();
+    } else {
+        id = (DepId)pools_.size();
+        pools_.emplace_back();
+        dirtyMark_.push_back(0);
+    }
+
+    std::vector<PoolId>& own = pools_[id];
+    own = pools;
+    std::sort(own.begin(), own.end());
+    own.erase(std::unique(own.begin(), own.end()), own.end());
+    require(!own.empty(), "dependent must read at least one pool");
+
+    for (const PoolId p : own) {
+        if (p >= byPool_.size()) byPool_.resize((size_t)p + 1);
+        byPool_[p].push_back(id);
+    }
+    ++live_;
+    return id;
+}
+
+void DependencyIndex::remove(DepId id) {
+    require(id < pools_.size() && !pools_[id].empty(), "unknown dependent");
+    for (const PoolId p : pools_[id]) {
+        std::vector<DepId>& deps = byPool_[p];
+        const auto it = std::find(deps.begin(), deps.end(), id);
+        *it = deps.back();
+        deps.pop_back();
+    }
+    pools_[id].clear();
+    dirtyMark_[id] = 0;   // drop it from a pending dirty set (takeDirty skips it)
+    free_.push_back(id);
+    --live_;
+}
+
+void DependencyIndex::clear() {
+    byPool_.clear();
+    pools_.clear();
+    free_.clear();
+    live_ = 0;
+    dirtyMark_.clear();
+    dirty_.clear();
+}
+
+void DependencyIndex::touch(PoolId pool) {
+    ++stats_.poolsTouched;
+    if (pool >= byPool_.size()) return;
+    for (const DepId d : byPool_[pool]) {
+        if (dirtyMark_[d] == dirtyEpoch_) continue;
+        dirtyMark_[d] = dirtyEpoch_;
+        dirty_.push_back(d);
+    }
+}
+
+const std::vector<DependencyIndex::DepId>& DependencyIndex::takeDirty() {
+    taken_.clear();
+    for (const DepId d : dirty_) {
+        if (dirtyMark_[d] != dirtyEpoch_) continue;   // removed since it was marked
+        dirtyMark_[d] = 0;
+        taken_.push_back(d);
+    }
+    dirty_.clear();
+    if (++dirtyEpoch_ == 0) {
+        std::fill(dirtyMark_.begin(), dirtyMark_.end(), 0);
+        dirtyEpoch_ = 1;
+    }
+
+    ++stats_.batches;
+    stats_.reevaluated += taken_.size();
+    stats_.avoided += live_ - taken_.size();
+    return taken_;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pool_registry.h"
+
+// Maps each pool to the dependents (cached cycles, watched routes, ...)
+// whose quote reads it, so a swap marks only those dependents dirty.
+//
+//   DependencyIndex idx;
+//   DepId d = idx.add(route.pools);
+//   idx.touch(poolThatMoved);              // once per changed pool
+//   for (DepId d : idx.takeDirty()) ...    // re-quote just these
+class DependencyIndex {
+public:
+    using DepId = uint32_t;
+
+    // Re-evaluation bookkeeping. A "touch" batch is everything between two
+    // takeDirty() calls; avoided counts live dependents not re-evaluated.
+    struct Stats {
+        uint64_t batches = 0;       // takeDirty() calls
+        uint64_t poolsTouched = 0;  // touch() calls
+        uint64_t reevaluated = 0;   // dependents returned dirty
+        uint64_t avoided = 0;       // dependents left alone
+        double avoidedPerBatch() const { return batches ? (double)avoided / (double)batches : 0.0; }
+    };
+
+    // Registers a dependent on the given pools (duplicates are ignored).
+    DepId add(const std::vector<PoolId>& pools);
+
+    // Unregisters a dependent; its id may be handed out again by add().
+    void remove(DepId id);
+
+    // Drops every dependent (stats are kept).
+    void clear();
+
+    // Marks every dependent of pool dirty.
+    void touch(PoolId pool);
+
+    // Dirty dependents since the last call, each once, in no particular
+    // order; clears the dirty set.
+    const std::vector<DepId>& takeDirty();
+
+    size_t size() const { return live_; }
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_ = Stats(); }
+
+private:
+    std::vector<std::vector<DepId>> byPool_;   // pool -> dependents
+    std::vector<std::vector<PoolId>> pools_;   // dependent -> its pools (empty when free)
+    std::vector<DepId> free_;
+    size_t live_ = 0;
+
+    std::vector<uint32_t> dirtyMark_;   // per dependent, == dirtyEpoch_ if in dirty_
+    uint32_t dirtyEpoch_ = 1;
+    std::vector<DepId> dirty_, taken_;
+    Stats stats_;
+};
@@ -0,0 +1,97 @@
+#include "exact_amm.h"
+
+#include <cmath>
+
+ExactFee exactFeeFromDouble(double fee) {
+    require(fee >= 0.0 && fee < 1.0, "fee must be in [0, 1)");
+    ExactFee f;
+    f.denominator = 1000000;
+    f.numerator = (uint64_t)std::llround((1.0 - fee) * 1e6);
+    return f;
+}
+
+Uint256 getAmountOutExact(const Uint256& amountIn, const Uint256& reserveIn, const Uint256& reserveOut,
+                          ExactFee fee) {
+    require(!amountIn.isZero(), "amountIn must be > 0");
+    require(!reserveIn.isZero() && !reserveOut.isZero(), "reserves must be > 0");
+    require(fee.numerator > 0 && fee.numerator <= fee.denominator, "fee must be in [0, 1)");
+
+    bool overflow = false;
+    const Uint256 amountInWithFee = mulSmallChecked(amountIn, fee.numerator, overflow);
+    const Uint256 numerator = mulChecked(amountInWithFee, reserveOut, overflow);
+    const Uint256 denominator = addChecked(mulSmallChecked(reserveIn, fee.denominator, overflow),
+                                           amountInWithFee, overflow);
+    require(!overflow, "256-bit overflow in amountOut");
+
+    return divFloor(numerator, denominator);
+}
+
+Uint256 getAmountInExact(const Uint256& amountOut, const Uint256& reserveIn, const Uint256& reserveOut,
+                         ExactFee fee) {
+    require(!amountOut.isZero(), "amountOut must be > 0");
+    require(!reserveIn.isZero() && !reserveOut.isZero(), "reserves must be > 0");
+    require(fee.numerator > 0 && fee.numerator <= fee.denominator, "fee must be in [0, 1)");
+    require(amountOut < reserveOut, "amountOut would drain the pool (invalid trade)");
+
+    bool overflow = false;
+    const Uint256 numerator = mulSmallChecked(mulChecked(reserveIn, amountOut, overflow), fee.denominator, overflow);
+    const Uint256 denominator = mulSmallChecked(subChecked(reserveOut, amountOut, overflow), fee.numerator, overflow);
+    const Uint256 in = addChecked(divFloor(numerator, denominator), Uint256(1), overflow);
+    require(!overflow, "256-bit overflow in amountIn");
+    return in;
+}
+
+ExactSwapResult simulateSwapExact(const Uint256& reserveA, const Uint256& reserveB, ExactFee fee,
+                                  Direction dir, const Uint256& amountIn) {
+    require(!reserveA.isZero() && !reserveB.isZero(), "reserveA and reserveB must be > 0");
+
+    const bool aToB = (dir == Direction::A2B);
+    const Uint256& reserveIn = aToB ? reserveA : reserveB;
+    const Uint256& reserveOut = aToB ? reserveB : reserveA;
+
+    const Uint256 out = getAmountOutExact(amountIn, reserveIn, reserveOut, fee);
+    require(out < reserveOut, "amountOut would drain the pool (invalid trade)");
+
+    bool overflow = false;
+    const Uint256 newIn = addChecked(reserveIn, amountIn, overflow);
+    const Uint256 newOut = subChecked(reserveOut, out, overflow);
+    require(!overflow, "256-bit overflow in new reserves");
+
+    ExactSwapResult r;
+    r.amountOut = out;
+    r.newReserveA = aToB ? newIn : newOut;
+    r.newReserveB = aToB ? newOut : newIn;
+
+    // Prices are ratios, so doubles are fine for reporting.
+    const double P0 = reserveOut.toDouble() / reserveIn.toDouble();
+    r.effectivePrice = out.toDouble() / amountIn.toDouble();
+    r.slippagePercent = (P0 - r.effectivePrice) / P0 * 100.0;
+    return r;
+}
+
+ExactSwapResult simulateSwapExactOut(const Uint256& reserveA, const Uint256& reserveB, ExactFee fee,
+                                     Direction dir, const Uint256& amountOut, Uint256* amountIn) {
+    require(!reserveA.isZero() && !reserveB.isZero(), "reserveA and reserveB must be > 0");
+
+    const bool aToB = (dir == Direction::A2B);
+    const Uint256& reserveIn = aToB ? reserveA : reserveB;
+    const Uint256& reserveOut = aToB ? reserveB : reserveA;
+
+    const Uint256 in = getAmountInExact(amountOut, reserveIn, reserveOut, fee);
+
+    bool overflow = false;
+    const Uint256 newIn = addChecked(reserveIn, in, overflow);
+    const Uint256 newOut = subChecked(reserveOut, amountOut, overflow);
+    require(!overflow, "256-bit overflow in new reserves");
+
+    ExactSwapResult r;
+    r.amountOut = amountOut;
+    r.newReserveA = aToB ? newIn : newOut;
+    r.newReserveB = aToB ? newOut : newIn;
+
+    const double P0 = reserveOut.toDouble() / reserveIn.toDouble();
+    r.effectivePrice = amountOut.toDouble() / in.toDouble();
+    r.slippagePercent = (P0 - r.effectivePrice) / P0 * 100.0;
+    if (amountIn) *amountIn = in;
+    return r;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "amm.h"
+#include "uint256.h"
+
+// Fee as the fraction of amountIn kept for pricing.
+// Uniswap v2: 997/1000 (0.3% fee).
+struct ExactFee {
+    uint64_t numerator = 997;
+    uint64_t denominator = 1000;
+};
+
+// Converts a double fee (e.g. 0.003) to parts per million.
+// Scaling 997/1000 to 997000/1000000 does not change the floored result.
+ExactFee exactFeeFromDouble(double fee);
+
+// Integer swap outputs in raw token units (e.g. wei).
+struct ExactSwapResult {
+    Uint256 amountOut;
+    Uint256 newReserveA;
+    Uint256 newReserveB;
+    double effectivePrice{};    // reporting only, from the exact values
+    double slippagePercent{};
+};
+
+// Same as UniswapV2Library.getAmountOut, including floor rounding:
+//   amountInWithFee = amountIn * 997
+//   amountOut = amountInWithFee * reserveOut / (reserveIn * 1000 + amountInWithFee)
+// Intermediates are 256-bit; overflow throws like a Solidity revert.
+Uint256 getAmountOutExact(const Uint256& amountIn, const Uint256& reserveIn, const Uint256& reserveOut,
+                          ExactFee fee = ExactFee());
+
+// Same as UniswapV2Library.getAmountIn (rounds up so the swap yields >= amountOut):
+//   amountIn = reserveIn * amountOut * 1000 / ((reserveOut - amountOut) * 997) + 1
+Uint256 getAmountInExact(const Uint256& amountOut, const Uint256& reserveIn, const Uint256& reserveOut,
+                         ExactFee fee = ExactFee());
+
+// Exact counterpart of simulateSwap.
+ExactSwapResult simulateSwapExact(const Uint256& reserveA, const Uint256& reserveB, ExactFee fee,
+                                  Direction dir, const Uint256& amountIn);
+
+// Exact counterpart of simulateSwapExactOut; the required input goes to *amountIn.
+ExactSwapResult simulateSwapExactOut(const Uint256& reserveA, const Uint256& reserveB, ExactFee fee,
+                                     Direction dir, const Uint256& amountOut, Uint256* amountIn = nullptr);
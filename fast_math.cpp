@@ -0,0 +1,384 @@
+#include "fast_math.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "amount_out_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FAST_MATH_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// ln 2 split so that k * kLn2Hi is exact for |k| < 2^21 (fdlibm's split).
+const double kLn2Hi = 6.93147180369123816490e-01;
+const double kLn2Lo = 1.90821492927058770002e-10;
+const double kLog2e = 1.44269504088896338700e+00;
+const double kSqrt2 = 1.41421356237309514547e+00;
+
+// Adding 1.5 * 2^52 rounds to an integer (ties to even) and leaves that
+// integer in the low mantissa bits.
+const double kShifter = 6755399441055744.0;
+const double kTwo52 = 4503599627370496.0;
+const uint64_t kTwo52Bits = 0x4330000000000000ull;
+const uint64_t kMantissaMask = 0x000fffffffffffffull;
+const uint64_t kOneBits = 0x3ff0000000000000ull;
+
+const double kExpMin = -708.0;
+const double kExpMax = 709.0;
+
+// log(1 + f) = f - (f^2/2 - s (f^2/2 + R(s^2))), s = f / (2 + f), |s| <= 0.1716,
+// with R(z) = 2z/3 + 2z^2/5 + ... + 2z^10/21 (fdlibm's split, so the
+// leading f stays exact); truncation below 1e-18.
+const double kLogPoly[] = {2.0 / 3.0, 2.0 / 5.0, 2.0 / 7.0, 2.0 / 9.0, 2.0 / 11.0,
+                           2.0 / 13.0, 2.0 / 15.0, 2.0 / 17.0, 2.0 / 19.0, 2.0 / 21.0};
+
+// expm1(r) = r + r^2 Q(r), Q = 1/2! + r/3! + ... + r^11/13!, |r| <= ln2 / 2.
+const double kExpPoly[] = {1.0 / 2.0, 1.0 / 6.0, 1.0 / 24.0, 1.0 / 120.0,
+                           1.0 / 720.0, 1.0 / 5040.0, 1.0 / 40320.0, 1.0 / 362880.0,
+                           1.0 / 3628800.0, 1.0 / 39916800.0, 1.0 / 479001600.0, 1.0 / 6227020800.0};
+
+inline uint64_t bitsOf(double x) {
+    uint64_t b;
+    std::memcpy(&b, &x, sizeof b);
+    return b;
+}
+
+inline double fromBits(uint64_t b) {
+    double x;
+    std::memcpy(&x, &b, sizeof x);
+    return x;
+}
+
+// Scalar kernels. The vector kernels below mirror them operation for
+// operation (crypt_core is built with -ffp-contract=off, so nothing fuses).
+
+// The two polynomials by Estrin's scheme: terms are paired as
+// c[2i] + c[2i+1] x, then pairs of pairs with x^2, and so on. The
+// dependency chain is 4 multiply-adds long instead of Horner's 10-12.
+inline double logPoly(double z) {
+    const double* c = kLogPoly;
+    const double z2 = z * z, z4 = z2 * z2, z8 = z4 * z4;
+    const double b03 = (c[0] + z * c[1]) + z2 * (c[2] + z * c[3]);
+    const double b47 = (c[4] + z * c[5]) + z2 * (c[6] + z * c[7]);
+    return (b03 + z4 * b47) + z8 * (c[8] + z * c[9]);
+}
+
+inline double expPoly(double r) {
+    const double* c = kExpPoly;
+    const double r2 = r * r, r4 = r2 * r2, r8 = r4 * r4;
+    const double b03 = (c[0] + r * c[1]) + r2 * (c[2] + r * c[3]);
+    const double b47 = (c[4] + r * c[5]) + r2 * (c[6] + r * c[7]);
+    const double b811 = (c[8] + r * c[9]) + r2 * (c[10] + r * c[11]);
+    return (b03 + r4 * b47) + r8 * b811;
+}
+
+inline double logKernel(double x) {
+    const uint64_t bits = bitsOf(x);
+    const double biased = fromBits((bits >> 52) | kTwo52Bits) - kTwo52;
+    double m = fromBits((bits & kMantissaMask) | kOneBits);   // [1, 2)
+    const bool high = m > kSqrt2;
+    m = high ? m * 0.5 : m;                                   // [sqrt(1/2), sqrt(2))
+    const double e = biased - (high ? 1022.0 : 1023.0);
+
+    const double f = m - 1.0;
+    const double hfsq = 0.5 * f * f;
+    const double s = f / (2.0 + f);
+    const double z = s * s;
+    const double r = z * logPoly(z);
+    return e * kLn2Hi - ((hfsq - (s * (hfsq + r) + e * kLn2Lo)) - f);
+}
+
+// log(1 + x) = log(w) + (x - (w - 1)) / w with w = 1 + x rounded: the
+// second term puts back what the rounding of w lost.
+inline double log1pKernel(double x) {
+    const double w = 1.0 + x;
+    const double c = x - (w - 1.0);
+    return logKernel(w) + c / w;
+}
+
+// x = k ln2 + r; returns expm1(r) and sets scale = 2^k.
+inline double expReduce(double x, double& scale) {
+    x = x < kExpMin ? kExpMin : x;
+    x = x > kExpMax ? kExpMax : x;
+    const double shifted = x * kLog2e + kShifter;
+    const double k = shifted - kShifter;
+    const double r = (x - k * kLn2Hi) - k * kLn2Lo;
+    const double q = expPoly(r);
+    scale = fromBits((bitsOf(shifted) - bitsOf(kShifter) + 1023) << 52);
+    return r + (r * r) * q;
+}
+
+inline double expKernel(double x) {
+    double scale;
+    const double e = expReduce(x, scale);
+    return scale + scale * e;
+}
+
+// 2^k * (1 + e) - 1; for k = 0 this is e itself, with no cancellation.
+inline double expm1Kernel(double x) {
+    double scale;
+    const double e = expReduce(x, scale);
+    return scale * e + (scale - 1.0);
+}
+
+enum class Op { Log, Log1p, Exp, Expm1, Pow };
+
+template <Op op>
+inline double applyScalar(double x, double y) {
+    switch (op) {
+        case Op::Log:   return logKernel(x);
+        case Op::Log1p: return log1pKernel(x);
+        case Op::Exp:   return expKernel(x);
+        case Op::Expm1: return expm1Kernel(x);
+        default:        return expKernel(y * logKernel(x));
+    }
+}
+
+template <Op op>
+void loopScalar(const double* x, const double* y, double* out, size_t begin, size_t n) {
+    for (size_t i = begin; i < n; ++i) out[i] = applyScalar<op>(x[i], y ? y[i] : 0.0);
+}
+
+#ifdef FAST_MATH_X86_DISPATCH
+
+// c[0] + x c[1], the leaf of the Estrin trees below.
+__attribute__((target("avx2")))
+inline __m256d pairAvx2(const double* c, __m256d x) {
+    return _mm256_add_pd(_mm256_set1_pd(c[0]), _mm256_mul_pd(x, _mm256_set1_pd(c[1])));
+}
+
+__attribute__((target("avx2")))
+inline __m256d logPolyAvx2(__m256d z) {
+    const double* c = kLogPoly;
+    const __m256d z2 = _mm256_mul_pd(z, z), z4 = _mm256_mul_pd(z2, z2), z8 = _mm256_mul_pd(z4, z4);
+    const __m256d b03 = _mm256_add_pd(pairAvx2(c, z), _mm256_mul_pd(z2, pairAvx2(c + 2, z)));
+    const __m256d b47 = _mm256_add_pd(pairAvx2(c + 4, z), _mm256_mul_pd(z2, pairAvx2(c + 6, z)));
+    return _mm256_add_pd(_mm256_add_pd(b03, _mm256_mul_pd(z4, b47)), _mm256_mul_pd(z8, pairAvx2(c + 8, z)));
+}
+
+__attribute__((target("avx2")))
+inline __m256d expPolyAvx2(__m256d r) {
+    const double* c = kExpPoly;
+    const __m256d r2 = _mm256_mul_pd(r, r), r4 = _mm256_mul_pd(r2, r2), r8 = _mm256_mul_pd(r4, r4);
+    const __m256d b03 = _mm256_add_pd(pairAvx2(c, r), _mm256_mul_pd(r2, pairAvx2(c + 2, r)));
+    const __m256d b47 = _mm256_add_pd(pairAvx2(c + 4, r), _mm256_mul_pd(r2, pairAvx2(c + 6, r)));
+    const __m256d b811 = _mm256_add_pd(pairAvx2(c + 8, r), _mm256_mul_pd(r2, pairAvx2(c + 10, r)));
+    return _mm256_add_pd(_mm256_add_pd(b03, _mm256_mul_pd(r4, b47)), _mm256_mul_pd(r8, b811));
+}
+
+__attribute__((target("avx2")))
+inline __m256d logAvx2(__m256d x) {
+    const __m256i bits = _mm256_castpd_si256(x);
+    const __m256d biased = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x((long long)kTwo52Bits))),
+        _mm256_set1_pd(kTwo52));
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x((long long)kMantissaMask)),
+                                                    _mm256_set1_epi64x((long long)kOneBits)));
+    const __m256d high = _mm256_cmp_pd(m, _mm256_set1_pd(kSqrt2), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), high);
+    const __m256d e = _mm256_sub_pd(biased, _mm256_blendv_pd(_mm256_set1_pd(1023.0), _mm256_set1_pd(1022.0), high));
+
+    const __m256d f = _mm256_sub_pd(m, _mm256_set1_pd(1.0));
+    const __m256d hfsq = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), f), f);
+    const __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+    const __m256d z = _mm256_mul_pd(s, s);
+    const __m256d r = _mm256_mul_pd(z, logPolyAvx2(z));
+    const __m256d inner = _mm256_add_pd(_mm256_mul_pd(s, _mm256_add_pd(hfsq, r)), _mm256_mul_pd(e, _mm256_set1_pd(kLn2Lo)));
+    return _mm256_sub_pd(_mm256_mul_pd(e, _mm256_set1_pd(kLn2Hi)), _mm256_sub_pd(_mm256_sub_pd(hfsq, inner), f));
+}
+
+__attribute__((target("avx2")))
+inline __m256d log1pAvx2(__m256d x) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d w = _mm256_add_pd(one, x);
+    const __m256d c = _mm256_sub_pd(x, _mm256_sub_pd(w, one));
+    return _mm256_add_pd(logAvx2(w), _mm256_div_pd(c, w));
+}
+
+__attribute__((target("avx2")))
+inline __m256d expReduceAvx2(__m256d x, __m256d& scale) {
+    x = _mm256_max_pd(_mm256_set1_pd(kExpMin), x);   // operand order keeps NaN, as the scalar clamp does
+    x = _mm256_min_pd(_mm256_set1_pd(kExpMax), x);
+    const __m256d shifter = _mm256_set1_pd(kShifter);
+    const __m256d shifted = _mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(kLog2e)), shifter);
+    const __m256d k = _mm256_sub_pd(shifted, shifter);
+    const __m256d r = _mm256_sub_pd(_mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(kLn2Hi))),
+                                    _mm256_mul_pd(k, _mm256_set1_pd(kLn2Lo)));
+    const __m256d q = expPolyAvx2(r);
+    const __m256i kBits = _mm256_sub_epi64(_mm256_castpd_si256(shifted), _mm256_castpd_si256(shifter));
+    scale = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(kBits, _mm256_set1_epi64x(1023)), 52));
+    return _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(r, r), q));
+}
+
+template <Op op>
+__attribute__((target("avx2")))
+inline __m256d applyAvx2(__m256d x, __m256d y) {
+    __m256d scale;
+    switch (op) {
+        case Op::Log:   return logAvx2(x);
+        case Op::Log1p: return log1pAvx2(x);
+        case Op::Exp: {
+            const __m256d e = expReduceAvx2(x, scale);
+            return _mm256_add_pd(scale, _mm256_mul_pd(scale, e));
+        }
+        case Op::Expm1: {
+            const __m256d e = expReduceAvx2(x, scale);
+            return _mm256_add_pd(_mm256_mul_pd(scale, e), _mm256_sub_pd(scale, _mm256_set1_pd(1.0)));
+        }
+        default: {
+            const __m256d e = expReduceAvx2(_mm256_mul_pd(y, logAvx2(x)), scale);
+            return _mm256_add_pd(scale, _mm256_mul_pd(scale, e));
+        }
+    }
+}
+
+template <Op op>
+__attribute__((target("avx2")))
+void loopAvx2(const double* x, const double* y, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d yv = y ? _mm256_loadu_pd(y + i) : _mm256_setzero_pd();
+        _mm256_storeu_pd(out + i, applyAvx2<op>(_mm256_loadu_pd(x + i), yv));
+    }
+    loopScalar<op>(x, y, out, i, n);
+}
+
+// c[0] + x c[1], the leaf of the Estrin trees below.
+__attribute__((target("avx512f")))
+inline __m512d pairAvx512(const double* c, __m512d x) {
+    return _mm512_add_pd(_mm512_set1_pd(c[0]), _mm512_mul_pd(x, _mm512_set1_pd(c[1])));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d logPolyAvx512(__m512d z) {
+    const double* c = kLogPoly;
+    const __m512d z2 = _mm512_mul_pd(z, z), z4 = _mm512_mul_pd(z2, z2), z8 = _mm512_mul_pd(z4, z4);
+    const __m512d b03 = _mm512_add_pd(pairAvx512(c, z), _mm512_mul_pd(z2, pairAvx512(c + 2, z)));
+    const __m512d b47 = _mm512_add_pd(pairAvx512(c + 4, z), _mm512_mul_pd(z2, pairAvx512(c + 6, z)));
+    return _mm512_add_pd(_mm512_add_pd(b03, _mm512_mul_pd(z4, b47)), _mm512_mul_pd(z8, pairAvx512(c + 8, z)));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d expPolyAvx512(__m512d r) {
+    const double* c = kExpPoly;
+    const __m512d r2 = _mm512_mul_pd(r, r), r4 = _mm512_mul_pd(r2, r2), r8 = _mm512_mul_pd(r4, r4);
+    const __m512d b03 = _mm512_add_pd(pairAvx512(c, r), _mm512_mul_pd(r2, pairAvx512(c + 2, r)));
+    const __m512d b47 = _mm512_add_pd(pairAvx512(c + 4, r), _mm512_mul_pd(r2, pairAvx512(c + 6, r)));
+    const __m512d b811 = _mm512_add_pd(pairAvx512(c + 8, r), _mm512_mul_pd(r2, pairAvx512(c + 10, r)));
+    return _mm512_add_pd(_mm512_add_pd(b03, _mm512_mul_pd(r4, b47)), _mm512_mul_pd(r8, b811));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d logAvx512(__m512d x) {
+    const __m512i bits = _mm512_castpd_si512(x);
+    const __m512d biased = _mm512_sub_pd(
+        _mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(bits, 52), _mm512_set1_epi64((long long)kTwo52Bits))),
+        _mm512_set1_pd(kTwo52));
+    __m512d m = _mm512_castsi512_pd(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi64((long long)kMantissaMask)),
+                                                    _mm512_set1_epi64((long long)kOneBits)));
+    const __mmask8 high = _mm512_cmp_pd_mask(m, _mm512_set1_pd(kSqrt2), _CMP_GT_OQ);
+    m = _mm512_mask_mul_pd(m, high, m, _mm512_set1_pd(0.5));
+    const __m512d e = _mm512_sub_pd(biased, _mm512_mask_mov_pd(_mm512_set1_pd(1023.0), high, _mm512_set1_pd(1022.0)));
+
+    const __m512d f = _mm512_sub_pd(m, _mm512_set1_pd(1.0));
+    const __m512d hfsq = _mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(0.5), f), f);
+    const __m512d s = _mm512_div_pd(f, _mm512_add_pd(_mm512_set1_pd(2.0), f));
+    const __m512d z = _mm512_mul_pd(s, s);
+    const __m512d r = _mm512_mul_pd(z, logPolyAvx512(z));
+    const __m512d inner = _mm512_add_pd(_mm512_mul_pd(s, _mm512_add_pd(hfsq, r)), _mm512_mul_pd(e, _mm512_set1_pd(kLn2Lo)));
+    return _mm512_sub_pd(_mm512_mul_pd(e, _mm512_set1_pd(kLn2Hi)), _mm512_sub_pd(_mm512_sub_pd(hfsq, inner), f));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d log1pAvx512(__m512d x) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d w = _mm512_add_pd(one, x);
+    const __m512d c = _mm512_sub_pd(x, _mm512_sub_pd(w, one));
+    return _mm512_add_pd(logAvx512(w), _mm512_div_pd(c, w));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d expReduceAvx512(__m512d x, __m512d& scale) {
+    x = _mm512_max_pd(_mm512_set1_pd(kExpMin), x);   // operand order keeps NaN, as the scalar clamp does
+    x = _mm512_min_pd(_mm512_set1_pd(kExpMax), x);
+    const __m512d shifter = _mm512_set1_pd(kShifter);
+    const __m512d shifted = _mm512_add_pd(_mm512_mul_pd(x, _mm512_set1_pd(kLog2e)), shifter);
+    const __m512d k = _mm512_sub_pd(shifted, shifter);
+    const __m512d r = _mm512_sub_pd(_mm512_sub_pd(x, _mm512_mul_pd(k, _mm512_set1_pd(kLn2Hi))),
+                                    _mm512_mul_pd(k, _mm512_set1_pd(kLn2Lo)));
+    const __m512d q = expPolyAvx512(r);
+    const __m512i kBits = _mm512_sub_epi64(_mm512_castpd_si512(shifted), _mm512_castpd_si512(shifter));
+    scale = _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(kBits, _mm512_set1_epi64(1023)), 52));
+    return _mm512_add_pd(r, _mm512_mul_pd(_mm512_mul_pd(r, r), q));
+}
+
+template <Op op>
+__attribute__((target("avx512f")))
+inline __m512d applyAvx512(__m512d x, __m512d y) {
+    __m512d scale;
+    switch (op) {
+        case Op::Log:   return logAvx512(x);
+        case Op::Log1p: return log1pAvx512(x);
+        case Op::Exp: {
+            const __m512d e = expReduceAvx512(x, scale);
+            return _mm512_add_pd(scale, _mm512_mul_pd(scale, e));
+        }
+        case Op::Expm1: {
+            const __m512d e = expReduceAvx512(x, scale);
+            return _mm512_add_pd(_mm512_mul_pd(scale, e), _mm512_sub_pd(scale, _mm512_set1_pd(1.0)));
+        }
+        default: {
+            const __m512d e = expReduceAvx512(_mm512_mul_pd(y, logAvx512(x)), scale);
+            return _mm512_add_pd(scale, _mm512_mul_pd(scale, e));
+        }
+    }
+}
+
+template <Op op>
+__attribute__((target("avx512f")))
+void loopAvx512(const double* x, const double* y, double* out, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+        // Masked tail; dead lanes load 1.0, which is in every domain.
+        const __mmask8 m = (n - i >= 8) ? (__mmask8)0xff : (__mmask8)((1u << (n - i)) - 1u);
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d xv = _mm512_mask_loadu_pd(one, m, x + i);
+        const __m512d yv = y ? _mm512_mask_loadu_pd(one, m, y + i) : one;
+        _mm512_mask_storeu_pd(out + i, m, applyAvx512<op>(xv, yv));
+    }
+}
+
+#endif // FAST_MATH_X86_DISPATCH
+
+template <Op op>
+void dispatch(const double* x, const double* y, double* out, size_t n) {
+    switch (activeSimdLevel()) {
+#ifdef FAST_MATH_X86_DISPATCH
+        case SimdLevel::Avx512:
+            loopAvx512<op>(x, y, out, n);
+            return;
+        case SimdLevel::Avx2:
+            loopAvx2<op>(x, y, out, n);
+            return;
+#endif
+        default:
+            loopScalar<op>(x, y, out, 0, n);
+            return;
+    }
+}
+
+} // namespace
+
+double fastLog(double x) { return logKernel(x); }
+double fastLog1p(double x) { return log1pKernel(x); }
+double fastExp(double x) { return expKernel(x); }
+double fastExpm1(double x) { return expm1Kernel(x); }
+double fastPow(double x, double y) { return expKernel(y * logKernel(x)); }
+
+void fastLogBatch(const double* x, double* out, size_t n) { dispatch<Op::Log>(x, nullptr, out, n); }
+void fastLog1pBatch(const double* x, double* out, size_t n) { dispatch<Op::Log1p>(x, nullptr, out, n); }
+void fastExpBatch(const double* x, double* out, size_t n) { dispatch<Op::Exp>(x, nullptr, out, n); }
+void fastExpm1Batch(const double* x, double* out, size_t n) { dispatch<Op::Expm1>(x, nullptr, out, n); }
+void fastPowBatch(const double* x, const double* y, double* out, size_t n) { dispatch<Op::Pow>(x, y, out, n); }
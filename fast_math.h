@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+// exp/log family with fixed-length polynomial kernels, for batch pricing
+// where libm calls would dominate (weighted pools need a pow per swap).
+//
+// Each function is one range reduction plus one polynomial: no table
+// lookups and no data-dependent branches, so the batch versions run
+// 8 lanes per AVX-512 step (4 per AVX2), dispatched on activeSimdLevel().
+// Every level performs the same IEEE operations in the same order as the
+// scalar function, so results are bit-identical across levels.
+//
+// Accuracy (checked by crypt_bench against libm):
+//   fastLog, fastLog1p, fastExp, fastExpm1   within 2 ulp
+//   fastPow(x, y) = fastExp(y * fastLog(x))   within 2 + 3 |y * log(x)| ulp
+// (the last term is the rounding of y * log(x), amplified by exp; std::pow
+// works in extended precision to avoid it, at several times the cost).
+//
+// Domain: log and pow need x > 0 and normal; log1p needs x > -1.
+// exp/expm1 arguments are clamped to [-708, 709], so they never return
+// subnormals or infinity. NaN and infinity in, garbage out.
+double fastLog(double x);
+double fastLog1p(double x);
+double fastExp(double x);
+double fastExpm1(double x);
+double fastPow(double x, double y);
+
+// out[i] = f(x[i]) (and fastPow(x[i], y[i])); out may alias x.
+void fastLogBatch(const double* x, double* out, size_t n);
+void fastLog1pBatch(const double* x, double* out, size_t n);
+void fastExpBatch(const double* x, double* out, size_t n);
+void fastExpm1Batch(const double* x, double* out, size_t n);
+void fastPowBatch(const double* x, const double* y, double* out, size_t n);
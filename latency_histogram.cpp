@@ -0,0 +1,75 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+void LatencyHistogram::reset() {
+    for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < kBuckets; ++i) bump(counts_[i], other.counts_[i].load(std::memory_order_relaxed));
+    bump(count_, other.count_.load(std::memory_order_relaxed));
+    bump(sum_, other.sum_.load(std::memory_order_relaxed));
+    const uint64_t m = other.max_.load(std::memory_order_relaxed);
+    if (m > max_.load(std::memory_order_relaxed)) max_.store(m, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+    const uint64_t n = count();
+    return n == 0 ? 0.0 : (double)sum_.load(std::memory_order_relaxed) / (double)n;
+}
+
+uint64_t LatencyHistogram::bucketHigh(int i) {
+    if (i < 2 * kSubBuckets) return (uint64_t)i;
+    const int j = i - 2 * kSubBuckets;
+    const int e = 7 + j / kSubBuckets;
+    const uint64_t m = (uint64_t)(kSubBuckets + j % kSubBuckets);
+    return ((m + 1) << (e - 6)) - 1;   // wraps to UINT64_MAX for the last bucket
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    const uint64_t n = count();
+    if (n == 0) return 0;
+    uint64_t rank = (uint64_t)std::ceil(p / 100.0 * (double)n);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(bucketHigh(i), max());
+    }
+    return max();
+}
+
+LatencyRecorder::LatencyRecorder(unsigned workers) : workers_(workers), slots_(new LatencyHistogram[workers]) {}
+
+void LatencyRecorder::merged(LatencyHistogram& out) const {
+    out.reset();
+    for (unsigned w = 0; w < workers_; ++w) out.merge(slots_[w]);
+}
+
+// Ticks as wall time with a unit that keeps 3 significant digits readable.
+static std::string formatTicks(uint64_t ticks) {
+    const double ns = (double)ticks * 1e9 / tscHz();
+    char buf[32];
+    if (ns < 999.5) {
+        std::snprintf(buf, sizeof(buf), "%.0f ns", ns);
+    } else if (ns < 999.5e3) {
+        std::snprintf(buf, sizeof(buf), "%.3g us", ns / 1e3);
+    } else if (ns < 999.5e6) {
+        std::snprintf(buf, sizeof(buf), "%.3g ms", ns / 1e6);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.3g s", ns / 1e9);
+    }
+    return buf;
+}
+
+std::string latencySummary(const LatencyHistogram& h) {
+    return "p50 " + formatTicks(h.percentile(50.0)) + ", p99 " + formatTicks(h.percentile(99.0)) +
+           ", p99.9 " + formatTicks(h.percentile(99.9)) + ", max " + formatTicks(h.max()) +
+           " (n " + std::to_string(h.count()) + ")";
+}
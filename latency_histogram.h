@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "tsc.h"
+
+// HDR-style latency histogram over TSC ticks (see tsc.h).
+//
+// Buckets are log-linear: values below 128 get one bucket each, and every
+// power of two above that is split into 64 equal sub-buckets. A recorded
+// value is therefore reported within 1/64 (1.6%) of itself, over the full
+// uint64 range, in a fixed 3776-bucket table: record() never allocates and
+// costs a few adds, so it can sit in a hot loop.
+//
+// One thread records; any thread may read (percentiles, merge from it) at
+// the same time. The owner updates fields with relaxed load+store rather
+// than atomic adds, so recording stays as cheap as plain increments. For
+// several recording threads use LatencyRecorder.
+class alignas(64) LatencyHistogram {
+public:
+    static const int kSubBuckets = 64;
+    static const int kBuckets = 2 * kSubBuckets + (64 - 7) * kSubBuckets;
+
+    LatencyHistogram() { reset(); }
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    // Records `count` samples of the same value.
+    void record(uint64_t ticks, uint64_t count = 1) {
+        bump(counts_[bucketIndex(ticks)], count);
+        bump(count_, count);
+        bump(sum_, ticks * count);
+        if (ticks > max_.load(std::memory_order_relaxed)) max_.store(ticks, std::memory_order_relaxed);
+    }
+
+    // Adds other's samples; other may still be recording.
+    void merge(const LatencyHistogram& other);
+
+    void reset();
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    // Smallest bucket upper bound with at least p% of samples at or below
+    // it (capped at max()); 0 when empty. p in [0, 100].
+    uint64_t percentile(double p) const;
+
+    static int bucketIndex(uint64_t v) {
+        if (v < 2 * kSubBuckets) return (int)v;
+        const int e = log2Floor(v);   // 7..63
+        const int shift = e - 6;      // keeps 7 significant bits
+        return 2 * kSubBuckets + (e - 7) * kSubBuckets + (int)(v >> shift) - kSubBuckets;
+    }
+
+    // Largest value that falls in bucket i.
+    static uint64_t bucketHigh(int i);
+
+private:
+    static int log2Floor(uint64_t v) {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(v);
+#else
+        int e = 0;
+        while (v >>= 1) ++e;
+        return e;
+#endif
+    }
+
+    static void bump(std::atomic<uint64_t>& v, uint64_t n) {
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> counts_[kBuckets];
+    std::atomic<uint64_t> count_, sum_, max_;
+};
+
+// One histogram per worker (e.g. parallelFor's worker index), so threads
+// record without locks or shared cache lines; merged() folds them.
+class LatencyRecorder {
+public:
+    explicit LatencyRecorder(unsigned workers);
+
+    unsigned workers() const { return workers_; }
+    LatencyHistogram& worker(unsigned w) { return slots_[w]; }
+
+    // Sum of every worker's histogram into out (which is reset first).
+    void merged(LatencyHistogram& out) const;
+
+private:
+    unsigned workers_;
+    std::unique_ptr<LatencyHistogram[]> slots_;
+};
+
+// Records the ticks from construction to destruction into h (if set).
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram* h) : h_(h), start_(h ? readTsc() : 0) {}
+    ~ScopedLatency() {
+        if (h_) h_->record(readTsc() - start_);
+    }
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram* h_;
+    uint64_t start_;
+};
+
+// "p50 1.23 us, p99 4.56 us, p99.9 7.89 us, max 12.3 us (n 1000)", in
+// wall time via tscHz().
+std::string latencySummary(const LatencyHistogram& h);
@@ -0,0 +1,152 @@
+#pragma once
+
+// Text input helpers shared by the pools file, trade-log replay and the
+// CSV -> binary converter. Internal to the crypt_core sources (crypt_bench
+// times the field parsers directly).
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "amm.h"
+#include "parse_number.h"
+#include "stage_stats.h"
+
+// Cursor over one line [p, end). Field parsers advance p and return false on junk.
+struct LineCursor {
+    const char* p;
+    const char* end;
+
+    void skipSeparators() {
+        while (p < end && (*p == ',' || *p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    }
+
+    bool atEnd() {
+        skipSeparators();
+        return p == end || *p == '#';
+    }
+
+    // Token up to the next separator.
+    bool token(const char*& begin, size_t& len) {
+        skipSeparators();
+        begin = p;
+        while (p < end && *p != ',' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '#') ++p;
+        len = (size_t)(p - begin);
+        return len > 0;
+    }
+
+    bool parseUint(uint64_t& v) {
+        const char* b;
+        size_t len;
+        if (!token(b, len) || len > 19) return false;
+        uint64_t r = 0;
+        for (size_t i = 0; i < len; ++i) {
+            if (b[i] < '0' || b[i] > '9') return false;
+            r = r * 10 + (uint64_t)(b[i] - '0');
+        }
+        v = r;
+        return true;
+    }
+
+    bool parseDirection(Direction& d) {
+        const char* b;
+        size_t len;
+        if (!token(b, len) || len != 3 || (b[1] != '2')) return false;
+        const char first = (char)(b[0] & ~0x20);   // ASCII uppercase
+        const char last = (char)(b[2] & ~0x20);
+        if (first == 'A' && last == 'B') { d = Direction::A2B; return true; }
+        if (first == 'B' && last == 'A') { d = Direction::B2A; return true; }
+        return false;
+    }
+
+    bool parseDouble(double& v) {
+        const char* b;
+        size_t len;
+        return token(b, len) && parseDoubleFull(b, b + len, v);
+    }
+
+    bool parseName(std::string& s) {
+        const char* b;
+        size_t len;
+        if (!token(b, len)) return false;
+        s.assign(b, len);
+        return true;
+    }
+};
+
+[[noreturn]] inline void lineError(uint64_t lineNo, const std::string& msg) {
+    throw std::runtime_error("line " + std::to_string(lineNo) + ": " + msg);
+}
+
+// Calls onLine(cursor, lineNo) for every line of the stream, reading
+// kBlockSize bytes at a time and carrying a partial last line over.
+template <class F>
+uint64_t forEachLine(std::FILE* in, F&& onLine) {
+    // Read block size; a single line must fit in one block.
+    const size_t kBlockSize = 1 << 20;
+    std::vector<char> buf(kBlockSize);
+    size_t carried = 0;
+    uint64_t lineNo = 0;
+
+    for (;;) {
+        const size_t got = std::fread(buf.data() + carried, 1, buf.size() - carried, in);
+        const size_t filled = carried + got;
+        const bool eof = got == 0;
+        if (filled == 0) break;
+
+        const char* p = buf.data();
+        const char* end = buf.data() + filled;
+        for (;;) {
+            const char* nl = (const char*)std::memchr(p, '\n', (size_t)(end - p));
+            if (!nl) {
+                if (!eof) break;
+                nl = end;   // last line without a trailing newline
+            }
+            ++lineNo;
+            LineCursor c{p, nl};
+            onLine(c, lineNo);
+            p = nl + (nl < end ? 1 : 0);
+            if (p >= end) break;
+        }
+
+        if (eof) break;
+        carried = (size_t)(end - p);
+        if (carried == buf.size()) lineError(lineNo + 1, "line longer than read block");
+        std::memmove(buf.data(), p, carried);
+    }
+
+    if (std::ferror(in)) throw std::runtime_error("read error");
+    addStat(StatCounter::LinesRead, lineNo);
+    return lineNo;
+}
+
+struct FileCloser {
+    std::FILE* f;
+    ~FileCloser() { if (f && f != stdin) std::fclose(f); }
+};
+
+// Opens path for reading; "-" means stdin.
+inline std::FILE* openInput(const std::string& path) {
+    if (path == "-") return stdin;
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    require(f != nullptr, "cannot open " + path);
+    return f;
+}
+
+// One trade-log line: poolId,direction,amountIn[,timestamp].
+// Blank and comment lines return false; malformed lines throw.
+inline bool parseTradeLine(LineCursor& c, uint64_t lineNo, uint64_t& poolId, Direction& dir,
+                           double& amountIn, uint64_t& timestamp) {
+    if (c.atEnd()) return false;
+    if (!c.parseUint(poolId) || !c.parseDirection(dir) || !c.parseDouble(amountIn)) {
+        lineError(lineNo, "expected poolId,direction,amountIn[,timestamp]");
+    }
+    timestamp = 0;
+    if (!c.atEnd() && (!c.parseUint(timestamp) || !c.atEnd())) {
+        lineError(lineNo, "expected poolId,direction,amountIn[,timestamp]");
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+#include "lp_book.h"
+
+PositionId LpBook::open(PoolId pool, double amountA, double amountB) {
+    double usedA = 0.0, usedB = 0.0;
+    const double shares = reg_.mintShares(pool, amountA, amountB, usedA, usedB);
+
+    PositionId id;
+    if (!free_.empty()) {
+        id = free_.back();
+        free_.pop_back();
+    } else {
+        require(positions_.size() < 0xffffffffu, "too many positions");
+        id = (PositionId)positions_.size();
+        positions_.emplace_back();
+    }
+
+    const Pool& p = reg_.pool(pool);
+    LpPosition& pos = positions_[id];
+    pos.shares = shares;
+    pos.depositA = usedA;
+    pos.depositB = usedB;
+    pos.feeGrowthA = p.feeGrowthA;
+    pos.feeGrowthB = p.feeGrowthB;
+    pos.pool = pool;
+    ++live_;
+    return id;
+}
+
+void LpBook::add(PositionId id, double amountA, double amountB) {
+    live(id);
+    LpPosition& pos = positions_[id];
+    double usedA = 0.0, usedB = 0.0;
+    const double minted = reg_.mintShares(pos.pool, amountA, amountB, usedA, usedB);
+
+    // Move the entry growth so the larger share count still earns exactly
+    // the fees accrued so far: shares' * (g - entry') = shares * (g - entry).
+    const Pool& p = reg_.pool(pos.pool);
+    const double total = pos.shares + minted;
+    pos.feeGrowthA = p.feeGrowthA - pos.shares * (p.feeGrowthA - pos.feeGrowthA) / total;
+    pos.feeGrowthB = p.feeGrowthB - pos.shares * (p.feeGrowthB - pos.feeGrowthB) / total;
+    pos.shares = total;
+    pos.depositA += usedA;
+    pos.depositB += usedB;
+}
+
+LpWithdrawal LpBook::burn(PositionId id, double fraction) {
+    live(id);
+    require(fraction > 0.0 && fraction <= 1.0, "burn fraction must be in (0, 1]");
+    LpPosition& pos = positions_[id];
+    const Pool& p = reg_.pool(pos.pool);
+    const double shares = fraction == 1.0 ? pos.shares : pos.shares * fraction;
+
+    LpWithdrawal w;
+    w.feesA = shares * (p.feeGrowthA - pos.feeGrowthA);
+    w.feesB = shares * (p.feeGrowthB - pos.feeGrowthB);
+    reg_.burnShares(pos.pool, shares, w.amountA, w.amountB);
+
+    // Entry growth is per share, so the shares left keep their fee income as is.
+    if (fraction == 1.0) {
+        pos = LpPosition();
+        free_.push_back(id);
+        --live_;
+    } else {
+        pos.shares -= shares;
+        pos.depositA *= 1.0 - fraction;
+        pos.depositB *= 1.0 - fraction;
+    }
+    return w;
+}
+
+LpValuation LpBook::value(PositionId id) const {
+    const Pool& p = reg_.pool(live(id).pool);
+    return valueAt(id, p.reserveB / p.reserveA);
+}
+
+LpValuation LpBook::valueAt(PositionId id, double price) const {
+    const LpPosition& pos = live(id);
+    const Pool& p = reg_.pool(pos.pool);
+    const double fraction = pos.shares / p.totalShares;
+
+    LpValuation v;
+    v.amountA = fraction * p.reserveA;
+    v.amountB = fraction * p.reserveB;
+    v.feesA = pos.shares * (p.feeGrowthA - pos.feeGrowthA);
+    v.feesB = pos.shares * (p.feeGrowthB - pos.feeGrowthB);
+    v.value = v.amountA * price + v.amountB;
+    v.hodlValue = pos.depositA * price + pos.depositB;
+    v.feesValue = v.feesA * price + v.feesB;
+    v.pnlPercent = (v.value / v.hodlValue - 1.0) * 100.0;
+    v.impermanentLossPercent = ((v.value - v.feesValue) / v.hodlValue - 1.0) * 100.0;
+    return v;
+}
+
+const LpPosition& LpBook::position(PositionId id) const {
+    return live(id);
+}
+
+const LpPosition& LpBook::live(PositionId id) const {
+    require(id < positions_.size() && positions_[id].shares > 0.0, "unknown position");
+    return positions_[id];
+}
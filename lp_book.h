@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pool_registry.h"
+
+using PositionId = uint32_t;
+
+// One LP position: 48 bytes, kept in one flat array. Nothing in it changes
+// when swaps happen; swaps only move the pool's reserves and fee growth,
+// and a position is valued from those on demand in O(1).
+struct LpPosition {
+    double shares = 0.0;       // 0 = free slot
+    double depositA = 0.0;     // HODL basket: tokens put in, scaled down by partial burns
+    double depositB = 0.0;
+    double feeGrowthA = 0.0;   // pool fee growth per share at entry
+    double feeGrowthB = 0.0;
+    PoolId pool = kNoPool;
+    uint32_t reserved = 0;
+};
+
+static_assert(sizeof(LpPosition) == 48, "LpPosition layout");
+
+// A position marked to a price P of A in B; values are in B.
+struct LpValuation {
+    double amountA = 0.0, amountB = 0.0;   // redeemable now: shares / totalShares of the reserves
+    double feesA = 0.0, feesB = 0.0;       // fees earned since entry, in the token they were paid in
+    double value = 0.0;                    // amountA * P + amountB
+    double hodlValue = 0.0;                // depositA * P + depositB
+    double feesValue = 0.0;                // feesA * P + feesB
+    double pnlPercent = 0.0;               // value / hodlValue - 1, fees included
+    double impermanentLossPercent = 0.0;   // (value - feesValue) / hodlValue - 1
+};
+
+// What a burn paid out; fees is the part of amount that was fee income.
+struct LpWithdrawal {
+    double amountA = 0.0, amountB = 0.0;
+    double feesA = 0.0, feesB = 0.0;
+};
+
+// LP positions over the pools of a registry (Uniswap v2 semantics: fees
+// stay in the reserves and are realized on burn).
+//
+//   LpBook book(reg);
+//   PositionId id = book.open(pool, 1000.0, 2000.0);
+//   reg.applySwap(pool, Direction::A2B, 50.0);    // accrues the fee
+//   LpValuation v = book.value(id);               // pnl, fees, IL now
+//
+// Swaps (applySwap, applySwaps, replay) go through the registry as usual.
+class LpBook {
+public:
+    explicit LpBook(PoolRegistry& reg) : reg_(reg) {}
+
+    // Mints a new position from up to (amountA, amountB) at the pool ratio.
+    PositionId open(PoolId pool, double amountA, double amountB);
+
+    // Adds liquidity to a position; earlier fee income is kept.
+    void add(PositionId id, double amountA, double amountB);
+
+    // Burns fraction (0, 1] of a position's shares; 1 closes it and frees the id.
+    LpWithdrawal burn(PositionId id, double fraction);
+
+    // Marked to the pool's spot price, or to an external price of A in B.
+    LpValuation value(PositionId id) const;
+    LpValuation valueAt(PositionId id, double price) const;
+
+    const LpPosition& position(PositionId id) const;
+    size_t size() const { return live_; }
+
+private:
+    const LpPosition& live(PositionId id) const;
+
+    PoolRegistry& reg_;
+    std::vector<LpPosition> positions_;
+    std::vector<PositionId> free_;
+    size_t live_ = 0;
+};
@@ -1,145 +1,93 @@
 #include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <iomanip>
+#include <memory>
 #include <string>
 #include <vector>
 #include <stdexcept>
-//#include <cmath>
-
-// Holds swap outputs required by the task.
-struct SwapResult {
-    double amountOut{};        // how many tokens user receives
-    double newReserveA{};      // reserveA after swap
-    double newReserveB{};      // reserveB after swap
-    double effectivePrice{};   // amountOut / amountIn (units depend on direction)
-    double slippagePercent{};
-};
-
-// Simple validation helper
-// msg error message if false
-static void require(bool cond, const std::string& msg) {
-    if (!cond) throw std::runtime_error(msg);
-}
-
-// Uniswap v2-style formula:
-// amountInWithFee = amountIn * (1 - fee)
-// amountOut = (amountInWithFee * reserveOut) / (reserveIn + amountInWithFee)
-static double getAmountOut(double amountIn, double reserveIn, double reserveOut, double fee) {
-    require(amountIn > 0.0, "amountIn must be > 0");
-    require(reserveIn > 0.0 && reserveOut > 0.0, "reserves must be > 0");
-    require(fee >= 0.0 && fee < 1.0, "fee must be in [0, 1)");
-
-    // Apply fee to input amount (0.3% fee => keep 99.7% for pricing)
-    const double amountInWithFee = amountIn * (1.0 - fee);
-
-    // Constant-product swap output (same math as Uniswap v2 library)
-    return (amountInWithFee * reserveOut) / (reserveIn + amountInWithFee);
-}
-
-// direction: "A2B" or "B2A"
-// spot price before trade:
-//  - A2B: P0 = reserveB / reserveA (B per A)
-//  - B2A: P0 = reserveA / reserveB (A per B)
-// effective price:
-//  - Peff = amountOut / amountIn
-// slippage% = (P0 - Peff) / P0 * 100
-static SwapResult simulateSwap(double reserveA, double reserveB, double fee,
-                               const std::string& directionRaw, double amountIn) {
-    require(reserveA > 0.0 && reserveB > 0.0, "reserveA and reserveB must be > 0");
-
-    // Normalize direction to uppercase so "a2b" works too.
-    std::string direction = directionRaw;
-    for (auto& c : direction) c = (char)std::toupper((unsigned char)c);
-
-    require(direction == "A2B" || direction == "B2A", "direction must be A2B or B2A");
-
-    SwapResult r{};
-
-    if (direction == "A2B") {
-        // Spot price (before trade): how many B for 1 A
-        const double P0 = reserveB / reserveA;
-
-        const double out = getAmountOut(amountIn, reserveA, reserveB, fee);
-        require(out < reserveB, "amountOut would drain the pool (invalid trade)");
-
-        // Update pool reserves after swap
-        r.amountOut = out;
-        r.newReserveA = reserveA + amountIn;
-        r.newReserveB = reserveB - out;
 
-        // Effective price for this trade
-        r.effectivePrice = out / amountIn;      // B per A
-
-        // Slippage relative to spot price
-        r.slippagePercent = (P0 - r.effectivePrice) / P0 * 100.0;
-    } else { // B2A
-        const double P0 = reserveA / reserveB; // A per B
-
-        const double out = getAmountOut(amountIn, reserveB, reserveA, fee);
-        require(out < reserveA, "amountOut would drain the pool (invalid trade)");
-
-        r.amountOut = out;
-        r.newReserveA = reserveA - out;
-        r.newReserveB = reserveB + amountIn;
-
-        r.effectivePrice = out / amountIn;      // A per B
-        r.slippagePercent = (P0 - r.effectivePrice) / P0 * 100.0;
-    }
-
-    return r;
-}
+#include "amm.h"
+#include "arbitrage.h"
+#include "exact_amm.h"
+#include "latency_histogram.h"
+#include "montecarlo.h"
+#include "parse_number.h"
+#include "pool_registry.h"
+#include "replay.h"
+#include "result_sink.h"
+#include "router.h"
+#include "stableswap.h"
+#include "stage_stats.h"
+#include "sweep.h"
+#include "tradelog.h"
+#include "weighted.h"
 
 // Scenario for demo (name + direction + amountIn)
 struct Scenario {
     std::string name;
-    std::string direction;
+    Direction direction;
     double amountIn;
 };
 
-static void printHeader() {
-    std::cout
-            << std::left
-            << std::setw(10) << "Scenario"
-            << std::setw(6)  << "Dir"
-            << std::right
-            << std::setw(12) << "amountIn"
-            << std::setw(14) << "amountOut"
-            << std::setw(14) << "newResA"
-            << std::setw(14) << "newResB"
-            << std::setw(16) << "effPrice"
-            << std::setw(14) << "slip(%)"
-            << "\n";
-    std::cout << std::string(100, '-') << "\n";
-}
-
-static void printRow(const Scenario& s, const SwapResult& r) {
-    // setw(N) affects ONLY the next value printed.
-    // fixed + setprecision(K) prints K digits after decimal point.
-    std::cout
-            << std::left
-            << std::setw(10) << s.name
-            << std::setw(6)  << s.direction
-            << std::right
-            << std::setw(12) << std::fixed << std::setprecision(6) << s.amountIn
-            << std::setw(14) << std::fixed << std::setprecision(6) << r.amountOut
-            << std::setw(14) << std::fixed << std::setprecision(6) << r.newReserveA
-            << std::setw(14) << std::fixed << std::setprecision(6) << r.newReserveB
-            << std::setw(16) << std::fixed << std::setprecision(8) << r.effectivePrice
-            << std::setw(14) << std::fixed << std::setprecision(6) << r.slippagePercent
-            << "\n";
-}
-
 static void printUsage(const char* prog) {
     std::cout <<
               "Usage:\n"
-              "  " << prog << " --reserveA <num> --reserveB <num> --fee <num> --direction A2B|B2A --amountIn <num>\n"
-                              "  " << prog << " --demo\n\n"
+              "  " << prog << " --reserveA <num> --reserveB <num> --fee <num> --direction A2B|B2A --amountIn <num>|--amountOut <num>\n"
+                              "  " << prog << " --exact --reserveA <int> --reserveB <int> --fee <num> --direction A2B|B2A --amountIn <int>|--amountOut <int>\n"
+                              "  " << prog << " --replay <file|-> [--pools <file> | --reserveA <num> --reserveB <num> --fee <num>]\n"
+                              "          [--format table|csv|jsonl|binary] [--output <file>] [--latency]\n"
+                              "  " << prog << " --sweep --reserveA <range> --reserveB <range> --fee <range> --amountIn <range>\n"
+                              "          [--direction A2B|B2A] [--amp <A> | --weightA <w>] [--threads <n>] [--output <file>]\n"
+                              "  " << prog << " --route --pools <file> --tokenIn <sym> --tokenOut <sym> --amountIn <num>\n"
+                              "          [--maxHops <n>] [--split <routes>] [--repeat <n>] [--latency]\n"
+                              "  " << prog << " --arb --pools <file> [--passes <n>]\n"
+                              "  " << prog << " --montecarlo [--reserveA <num> --reserveB <num> --fee <num>] [--paths <n>] [--steps <n>]\n"
+                              "          [--size <median>] [--sizeDist lognormal|pareto] [--sizeShape <num>] [--a2b <p>]\n"
+                              "          [--drift <num>] [--vol <num>] [--noArb] [--seed <n>] [--threads <n>]\n"
+                              "  " << prog << " --convert <file.csv|-> --out <file.bin>\n"
+                              "  " << prog << " --demo [--format table|csv|jsonl|binary]\n\n"
                                               "Note:\n"
-                                              "  If you run without arguments, program runs demo mode by default.\n\n"
+                                              "  If you run without arguments, program runs demo mode by default.\n"
+                                              "  --exact uses Uniswap v2 integer math; amounts are raw token units (e.g. wei).\n"
+                                              "  --amountOut instead of --amountIn quotes an exact-output swap (prints the required amountIn).\n"
+                                              "  --amp <A> prices a swap or sweep on a StableSwap (Curve) curve instead of x*y=k.\n"
+                                              "  --weightA <w> prices it on a Balancer weighted pool with weights w : 1 - w.\n"
+                                              "  --replay reads lines \"poolId,direction,amountIn\" and applies them in order;\n"
+                                              "  --pools lines are \"tokenA,tokenB,reserveA,reserveB,fee[,stable|weighted,param]\" (param = amp or\n"
+                                              "  weight of tokenA; without --pools, pool 0 comes from the arguments).\n"
+                                              "  --format with --replay writes every swap result (to --output <file>, default stdout).\n"
+                                              "  --route finds the best path of up to --maxHops pools (default 3); --split spreads the trade.\n"
+                                              "  --latency reports p50/p99/p99.9/max latency per quote (--replay: batch pricing\n"
+                                              "  time per swap; --route: per query, --repeat <n> quotes n times).\n"
+                                              "  --arb lists profitable cycles with their optimal input size (in the cycle's first token).\n"
+                                              "  --montecarlo simulates random order flow against one pool (default 10000/10000/0.003)\n"
+                                              "  under a GBM external price and prints LP PnL, impermanent loss and slippage percentiles.\n"
+                                              "  --sweep ranges are <num> or from:to:count[:log]; the grid is written as float64 columns.\n"
+                                              "  --convert writes a text trade log as a binary log; --replay detects binary logs and memory-maps them.\n"
+                                              "  --stats (any mode) prints time per stage (parse, validate, math, state update, output)\n"
+                                              "  and throughput to stderr when the run ends.\n\n"
                                               "Examples:\n"
                                               "  " << prog << " --demo\n"
                                                               "  " << prog << " --reserveA 10000 --reserveB 10000 --fee 0.003 --direction A2B --amountIn 100\n";
 }
 
+// With --stats, turns the stage timers on and prints their breakdown to
+// stderr when main's scope ends (normally or by an exception).
+class StatsReport {
+public:
+    explicit StatsReport(bool on) : on_(on), start_(std::chrono::steady_clock::now()) { setStatsEnabled(on); }
+    ~StatsReport() {
+        if (!on_) return;
+        printStageStats(stderr, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+private:
+    bool on_;
+    std::chrono::steady_clock::time_point start_;
+};
+
 static bool hasFlag(const std::vector<std::string>& args, const std::string& flag) {
     for (const auto& a : args) if (a == flag) return true;
     return false;
@@ -155,22 +103,315 @@ static std::string getArg(const std::vector<std::string>& args, const std::strin
 static double toDouble(const std::string& s, const std::string& name) {
     require(!s.empty(), "Missing value for " + name);
 
-    size_t idx = 0;
-    double v = std::stod(s, &idx);
+    double v = 0.0;
 
     // Ensure the whole string is a number (no trailing junk)
-    require(idx == s.size(), "Invalid number for " + name + ": " + s);
+    require(parseDoubleFull(s.data(), s.data() + s.size(), v), "Invalid number for " + name + ": " + s);
     return v;
 }
 
+// Whole decimal number in [min, max]: no sign, fraction or exponent.
+static uint64_t toUint(const std::string& s, const std::string& name, uint64_t min, uint64_t max) {
+    require(!s.empty(), "Missing value for " + name);
+    uint64_t v = 0;
+    for (const char c : s) {
+        const uint64_t digit = (uint64_t)(c - '0');
+        require(c >= '0' && c <= '9' && v <= (UINT64_MAX - digit) / 10, "Invalid integer for " + name + ": " + s);
+        v = v * 10 + digit;
+    }
+    require(v >= min && v <= max,
+            name + " must be in [" + std::to_string(min) + ", " + std::to_string(max) + "]");
+    return v;
+}
+
+static Uint256 toUint256(const std::string& s, const std::string& name) {
+    require(!s.empty(), "Missing value for " + name);
+    try {
+        return Uint256::fromDecimal(s);
+    } catch (const std::exception&) {
+        throw std::runtime_error("Invalid integer for " + name + ": " + s);
+    }
+}
+
+// Single swap with exact integer math (same rounding as the on-chain contract).
+static int runExactSwap(const std::vector<std::string>& args) {
+    const Uint256 reserveA = toUint256(getArg(args, "--reserveA"), "--reserveA");
+    const Uint256 reserveB = toUint256(getArg(args, "--reserveB"), "--reserveB");
+    const ExactFee fee     = exactFeeFromDouble(toDouble(getArg(args, "--fee"), "--fee"));
+    const Direction dir    = parseDirection(getArg(args, "--direction"));
+
+    ExactSwapResult r;
+    if (hasFlag(args, "--amountOut")) {
+        const Uint256 amountOut = toUint256(getArg(args, "--amountOut"), "--amountOut");
+        Uint256 amountIn;
+        r = simulateSwapExactOut(reserveA, reserveB, fee, dir, amountOut, &amountIn);
+        std::cout << "amountIn        = " << amountIn.toDecimal() << "\n";
+    } else {
+        const Uint256 amountIn = toUint256(getArg(args, "--amountIn"), "--amountIn");
+        r = simulateSwapExact(reserveA, reserveB, fee, dir, amountIn);
+    }
+
+    std::cout << "amountOut       = " << r.amountOut.toDecimal() << "\n";
+    std::cout << "new reserveA    = " << r.newReserveA.toDecimal() << "\n";
+    std::cout << "new reserveB    = " << r.newReserveB.toDecimal() << "\n";
+    std::cout << std::fixed << std::setprecision(10);
+    std::cout << "effective price = " << r.effectivePrice << "\n";
+    std::cout << "slippage (%)    = " << std::setprecision(6) << r.slippagePercent << "\n";
+    return 0;
+}
+
+// Replays a trade log against a pool set and prints a summary.
+static int runReplay(const std::vector<std::string>& args) {
+    const std::string logPath = getArg(args, "--replay");
+    require(!logPath.empty(), "Missing value for --replay");
+
+    PoolRegistry reg;
+    const std::string poolsPath = getArg(args, "--pools");
+    if (!poolsPath.empty()) {
+        loadPools(reg, poolsPath);
+    } else {
+        const double reserveA = toDouble(getArg(args, "--reserveA"), "--reserveA");
+        const double reserveB = toDouble(getArg(args, "--reserveB"), "--reserveB");
+        const double fee      = toDouble(getArg(args, "--fee"),      "--fee");
+        reg.addPool(reg.internToken("A"), reg.internToken("B"), reserveA, reserveB, fee);
+    }
+    require(reg.size() > 0, "no pools to replay against");
+
+    // With --format every swap result is emitted; the summary then goes to
+    // stderr so it never mixes into result data on stdout.
+    const std::string format = getArg(args, "--format");
+    const std::string output = getArg(args, "--output");
+    std::unique_ptr<ResultSink> sink;
+    if (!format.empty()) {
+        sink.reset(new ResultSink(output, parseOutputFormat(format)));
+        sink->header();
+    }
+    std::ostream& out = (sink && (output.empty() || output == "-")) ? std::cerr : std::cout;
+
+    std::unique_ptr<LatencyHistogram> latency;
+    if (hasFlag(args, "--latency")) latency.reset(new LatencyHistogram());
+
+    const ReplayStats st = replayTradeLog(reg, logPath, sink.get(), latency.get());
+    if (sink) sink->flush();
+
+    out << "Replayed " << st.swaps << " swaps (" << st.lines << " lines) in "
+              << std::fixed << std::setprecision(3) << st.seconds << " s";
+    if (st.seconds > 0.0) {
+        out << " (" << std::setprecision(2) << (double)st.swaps / st.seconds / 1e6 << " M swaps/s)";
+    }
+    out << "\n";
+    if (latency) out << "Quote latency (pricing per swap): " << latencySummary(*latency) << "\n";
+    out << "\n";
+
+    // Final state; large pool sets are truncated to keep the output readable.
+    const size_t kMaxPoolsShown = 20;
+    out << std::left << std::setw(8) << "Pool" << std::setw(16) << "Pair"
+              << std::right << std::setw(22) << "reserveA" << std::setw(22) << "reserveB" << "\n";
+    for (size_t i = 0; i < reg.size() && i < kMaxPoolsShown; ++i) {
+        const Pool& p = reg.pool((PoolId)i);
+        out << std::left << std::setw(8) << i
+                  << std::setw(16) << (reg.tokenName(p.tokenA) + "/" + reg.tokenName(p.tokenB))
+                  << std::right << std::setprecision(6)
+                  << std::setw(22) << p.reserveA << std::setw(22) << p.reserveB << "\n";
+    }
+    if (reg.size() > kMaxPoolsShown) {
+        out << "... (" << reg.size() - kMaxPoolsShown << " more pools)\n";
+    }
+    return 0;
+}
+
+static void printRoute(const PoolRegistry& reg, const Route& route) {
+    for (const RouteHop& h : route.hops) {
+        std::cout << "  pool " << std::left << std::setw(8) << h.pool
+                  << std::setw(16) << (reg.tokenName(h.tokenIn) + "->" + reg.tokenName(h.tokenOut))
+                  << std::right << std::fixed << std::setprecision(6)
+                  << " in " << std::setw(18) << h.amountIn
+                  << "  out " << std::setw(18) << h.result.amountOut
+                  << "  slippage " << std::setw(10) << h.result.slippagePercent << " %\n";
+    }
+}
+
+// Quotes the best multi-hop route (or split) between two tokens of a pool set.
+static int runRoute(const std::vector<std::string>& args) {
+    const std::string poolsPath = getArg(args, "--pools");
+    require(!poolsPath.empty(), "Missing value for --pools");
+    PoolRegistry reg;
+    loadPools(reg, poolsPath);
+
+    const TokenId tokenIn = reg.findToken(getArg(args, "--tokenIn"));
+    const TokenId tokenOut = reg.findToken(getArg(args, "--tokenOut"));
+    require(tokenIn != kNoToken, "unknown --tokenIn");
+    require(tokenOut != kNoToken, "unknown --tokenOut");
+    const double amountIn = toDouble(getArg(args, "--amountIn"), "--amountIn");
+
+    const std::string hopsArg = getArg(args, "--maxHops");
+    const unsigned maxHops = hopsArg.empty() ? 3 : (unsigned)toUint(hopsArg, "--maxHops", 1, 16);
+    const std::string splitArg = getArg(args, "--split");
+    const unsigned maxRoutes = splitArg.empty() ? 1 : (unsigned)toUint(splitArg, "--split", 1, 64);
+    const std::string repeatArg = getArg(args, "--repeat");
+    const uint64_t repeat = repeatArg.empty() ? 1 : toUint(repeatArg, "--repeat", 1, 1000000000);
+
+    Router router(reg);
+    std::unique_ptr<LatencyHistogram> latency;
+    if (hasFlag(args, "--latency")) {
+        latency.reset(new LatencyHistogram());
+        router.setLatencyHistogram(latency.get());
+    }
+    // Repeats only add latency samples; the last quote is printed.
+    for (uint64_t i = 1; i < repeat; ++i) {
+        if (maxRoutes > 1) {
+            router.bestSplit(tokenIn, tokenOut, amountIn, maxHops, maxRoutes);
+        } else {
+            router.bestRoute(tokenIn, tokenOut, amountIn, maxHops);
+        }
+    }
+    if (maxRoutes > 1) {
+        const SplitRoute split = router.bestSplit(tokenIn, tokenOut, amountIn, maxHops, maxRoutes);
+        require(!split.routes.empty(), "no route between these tokens");
+        for (size_t i = 0; i < split.routes.size(); ++i) {
+            std::cout << "Route " << i + 1 << ": " << std::fixed << std::setprecision(6)
+                      << split.routes[i].amountIn << " -> " << split.routes[i].amountOut << "\n";
+            printRoute(reg, split.routes[i]);
+        }
+        std::cout << "amountOut       = " << std::setprecision(10) << split.amountOut << "\n";
+    } else {
+        const Route route = router.bestRoute(tokenIn, tokenOut, amountIn, maxHops);
+        require(!route.hops.empty(), "no route between these tokens");
+        printRoute(reg, route);
+        std::cout << "amountOut       = " << std::fixed << std::setprecision(10) << route.amountOut << "\n";
+    }
+    if (latency) std::cout << "Quote latency   = " << latencySummary(*latency) << "\n";
+    return 0;
+}
+
+// Scans a pool set for profitable cycles.
+static int runArbitrage(const std::vector<std::string>& args) {
+    const std::string poolsPath = getArg(args, "--pools");
+    require(!poolsPath.empty(), "Missing value for --pools");
+    PoolRegistry reg;
+    loadPools(reg, poolsPath);
+
+    const std::string passesArg = getArg(args, "--passes");
+    const unsigned passes = passesArg.empty() ? 4 : (unsigned)toUint(passesArg, "--passes", 1, 1024);
+
+    ArbitrageDetector arb(reg);
+    const std::vector<ArbCycle>& cycles = arb.scan(passes);
+    std::cout << cycles.size() << " profitable cycle(s)\n";
+    for (const ArbCycle& c : cycles) {
+        std::string path = reg.tokenName(c.startToken);
+        TokenId t = c.startToken;
+        for (const PoolId id : c.pools) {
+            const Pool& p = reg.pool(id);
+            t = (t == p.tokenA) ? p.tokenB : p.tokenA;
+            path += " -[" + std::to_string(id) + "]-> " + reg.tokenName(t);
+        }
+        std::cout << "  " << path << "\n"
+                  << std::fixed << std::setprecision(6)
+                  << "    rate " << c.spotRate << "  amountIn " << c.amountIn << "  profit " << c.profit << "\n";
+    }
+    return 0;
+}
+
+// Evaluates the reserveA x reserveB x fee x amountIn grid on all cores.
+static int runSweepMode(const std::vector<std::string>& args) {
+    SweepSpec spec;
+    spec.reserveA = parseSweepAxis(getArg(args, "--reserveA"), "--reserveA");
+    spec.reserveB = parseSweepAxis(getArg(args, "--reserveB"), "--reserveB");
+    spec.fee      = parseSweepAxis(getArg(args, "--fee"),      "--fee");
+    spec.amountIn = parseSweepAxis(getArg(args, "--amountIn"), "--amountIn");
+    const std::string dir = getArg(args, "--direction");
+    if (!dir.empty()) spec.direction = parseDirection(dir);
+    spec.hasAmp = hasFlag(args, "--amp");
+    if (spec.hasAmp) spec.amp = toDouble(getArg(args, "--amp"), "--amp");
+    spec.hasWeightA = hasFlag(args, "--weightA");
+    if (spec.hasWeightA) spec.weightA = toDouble(getArg(args, "--weightA"), "--weightA");
+
+    const std::string threadsArg = getArg(args, "--threads");
+    const unsigned threads = threadsArg.empty() ? 0 : (unsigned)toUint(threadsArg, "--threads", 0, 4095);
+
+    const std::string output = getArg(args, "--output");
+    const SweepStats st = runSweep(spec, threads, output);
+
+    std::cout << "Swept " << st.points << " points on " << st.threads << " threads in "
+              << std::fixed << std::setprecision(3) << st.seconds << " s";
+    if (st.seconds > 0.0) {
+        std::cout << " (" << std::setprecision(2) << (double)st.points / st.seconds / 1e6 << " M points/s)";
+    }
+    std::cout << "\n";
+    std::cout << "slippage (%): min " << std::setprecision(6) << st.minSlippage
+              << ", mean " << st.meanSlippage << ", max " << st.maxSlippage << "\n";
+    if (st.failed > 0) std::cout << "invalid points (NaN in output): " << st.failed << "\n";
+    if (!output.empty()) std::cout << "surface written to " << output << "\n";
+    return 0;
+}
+
+static void printPercentiles(const char* name, const Percentiles& p) {
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(4)
+              << std::setw(11) << p.mean << std::setw(11) << p.min << std::setw(11) << p.p1
+              << std::setw(11) << p.p5 << std::setw(11) << p.p25 << std::setw(11) << p.p50
+              << std::setw(11) << p.p75 << std::setw(11) << p.p95 << std::setw(11) << p.p99
+              << std::setw(11) << p.max << "\n";
+}
+
+// Monte Carlo order flow against one pool; all parameters have defaults.
+static int runMonteCarlo(const std::vector<std::string>& args) {
+    const auto opt = [&](const char* key, double fallback) {
+        const std::string v = getArg(args, key);
+        return v.empty() ? fallback : toDouble(v, key);
+    };
+    const auto count = [&](const char* key, uint64_t fallback, uint64_t min, uint64_t max) {
+        const std::string v = getArg(args, key);
+        return v.empty() ? fallback : toUint(v, key, min, max);
+    };
+
+    OrderFlowSpec spec;
+    spec.reserveA = opt("--reserveA", spec.reserveA);
+    spec.reserveB = opt("--reserveB", spec.reserveB);
+    spec.fee = opt("--fee", spec.fee);
+    spec.paths = count("--paths", spec.paths, 1, 999999999999ull);
+    spec.steps = (uint32_t)count("--steps", spec.steps, 1, UINT32_MAX);
+    const std::string dist = getArg(args, "--sizeDist");
+    if (!dist.empty()) spec.sizeDistribution = parseSizeDistribution(dist);
+    spec.sizeMedian = opt("--size", spec.sizeMedian);
+    spec.sizeShape = opt("--sizeShape", spec.sizeDistribution == SizeDistribution::Pareto ? 1.5 : spec.sizeShape);
+    spec.a2bProbability = opt("--a2b", spec.a2bProbability);
+    spec.drift = opt("--drift", spec.drift);
+    spec.volatility = opt("--vol", spec.volatility);
+    spec.arbitrage = !hasFlag(args, "--noArb");
+    spec.seed = count("--seed", spec.seed, 0, UINT64_MAX);
+
+    const unsigned threads = (unsigned)count("--threads", 0, 0, 4095);
+
+    const OrderFlowStats st = simulateOrderFlow(spec, threads);
+
+    std::cout << "Simulated " << st.paths << " paths x " << spec.steps << " trades on " << st.threads
+              << " threads in " << std::fixed << std::setprecision(3) << st.seconds << " s";
+    if (st.seconds > 0.0) {
+        std::cout << " (" << std::setprecision(2) << (double)st.trades / st.seconds / 1e6 << " M trades/s)";
+    }
+    std::cout << "\n";
+    if (spec.arbitrage) std::cout << "arbitrage trades: " << st.arbitrageTrades << "\n";
+    if (st.failed > 0) std::cout << "skipped (pool-draining) trades: " << st.failed << "\n";
+    std::cout << "\n" << std::left << std::setw(22) << "(%)" << std::right;
+    for (const char* h : {"mean", "min", "p1", "p5", "p25", "p50", "p75", "p95", "p99", "max"}) {
+        std::cout << std::setw(11) << h;
+    }
+    std::cout << "\n";
+    printPercentiles("LP PnL vs HODL", st.lpPnlPercent);
+    printPercentiles("impermanent loss", st.impermanentLossPercent);
+    printPercentiles("slippage per trade", st.slippagePercent);
+    return 0;
+}
+
 // Runs the required 3 scenarios and prints a table + conclusions.
 // (Used for --demo and also default run with no args.)
-static int runDemo() {
+// Other formats print just the result rows, for scripts.
+static int runDemo(OutputFormat format) {
     // Default pool (can represent any pair, BNB/USDT and so on)
     const double reserveA = 10000.0;
     const double reserveB = 10000.0;
     const double fee = 0.003;          // 0.3%
-    const std::string direction = "A2B";
+    const Direction direction = Direction::A2B;
 
     std::vector<Scenario> scenarios = {
             {"small",  direction, reserveA * 0.01},  // 1% of reserveA
@@ -178,14 +419,23 @@ static int runDemo() {
             {"large",  direction, reserveA * 0.40},  // 40%
     };
 
-    std::cout << "Demo: reserveA=" << reserveA << ", reserveB=" << reserveB
-              << ", fee=" << fee << ", direction=" << direction << "\n\n";
+    const bool table = (format == OutputFormat::Table);
+    if (table) {
+        std::cout << "Demo: reserveA=" << reserveA << ", reserveB=" << reserveB
+                  << ", fee=" << fee << ", direction=" << directionName(direction) << "\n\n";
+        std::cout.flush();   // the sink writes to the same fd directly
+    }
 
-    printHeader();
-    for (const auto& s : scenarios) {
-        auto r = simulateSwap(reserveA, reserveB, fee, s.direction, s.amountIn);
-        printRow(s, r);
+    {
+        ResultSink sink("-", format);
+        sink.header();
+        for (const auto& s : scenarios) {
+            auto r = simulateSwap(reserveA, reserveB, fee, s.direction, s.amountIn);
+            sink.row(s.name, s.direction, s.amountIn, r);
+        }
+        sink.flush();
     }
+    if (!table) return 0;
 
     std::cout << "\nConclusions:\n"
               << "- Slippage grows non-linearly with trade size (big trades move reserves a lot).\n"
@@ -200,10 +450,11 @@ int main(int argc, char** argv) {
         std::vector<std::string> args;
         args.reserve((size_t)argc);
         for (int i = 1; i < argc; ++i) args.emplace_back(argv[i]);
+        const StatsReport statsReport(hasFlag(args, "--stats"));
 
         // If user presses Run without arguments -> run demo automatically.
         if (args.empty()) {
-            return runDemo();
+            return runDemo(OutputFormat::Table);
         }
 
         if (hasFlag(args, "--help") || hasFlag(args, "-h")) {
@@ -212,24 +463,90 @@ int main(int argc, char** argv) {
         }
 
         if (hasFlag(args, "--demo")) {
-            return runDemo();
+            const std::string format = getArg(args, "--format");
+            return runDemo(format.empty() ? OutputFormat::Table : parseOutputFormat(format));
+        }
+
+        if (hasFlag(args, "--convert")) {
+            const std::string in = getArg(args, "--convert");
+            const std::string out = getArg(args, "--out");
+            require(!in.empty(), "Missing value for --convert");
+            require(!out.empty(), "Missing value for --out");
+            const uint64_t n = convertTradeLog(in, out);
+            std::cout << "Wrote " << n << " records to " << out << "\n";
+            return 0;
+        }
+
+        if (hasFlag(args, "--sweep")) {
+            return runSweepMode(args);
         }
 
-        // Single-run mode (custom swap from arguments)
+        if (hasFlag(args, "--montecarlo")) {
+            return runMonteCarlo(args);
+        }
+
+        if (hasFlag(args, "--arb")) {
+            return runArbitrage(args);
+        }
+
+        if (hasFlag(args, "--route")) {
+            return runRoute(args);
+        }
+
+        if (hasFlag(args, "--replay")) {
+            return runReplay(args);
+        }
+
+        if (hasFlag(args, "--exact")) {
+            return runExactSwap(args);
+        }
+
+        // Single-run mode (custom swap from arguments). Time not spent in
+        // the nested math/output stages is argument parsing.
+        ScopedStage parseTimer(Stage::Parse, 1);
         const double reserveA = toDouble(getArg(args, "--reserveA"), "--reserveA");
         const double reserveB = toDouble(getArg(args, "--reserveB"), "--reserveB");
         const double fee      = toDouble(getArg(args, "--fee"),      "--fee");
-        const std::string dir = getArg(args, "--direction");
-        const double amountIn = toDouble(getArg(args, "--amountIn"), "--amountIn");
-
-        auto r = simulateSwap(reserveA, reserveB, fee, dir, amountIn);
+        const Direction dir   = parseDirection(getArg(args, "--direction"));
+        const bool stable     = hasFlag(args, "--amp");
+        const bool weighted   = hasFlag(args, "--weightA");
+        const bool exactOut   = hasFlag(args, "--amountOut");
+        require(!(stable && weighted), "--amp and --weightA are mutually exclusive");
+        require(!(stable && exactOut), "--amp supports --amountIn only");
+        require(!(weighted && exactOut), "--weightA supports --amountIn only");
+        const double amp      = stable ? toDouble(getArg(args, "--amp"), "--amp") : 0.0;
+        const double weightA  = weighted ? toDouble(getArg(args, "--weightA"), "--weightA") : 0.0;
+        require(!weighted || (weightA > 0.0 && weightA < 1.0), "--weightA must be in (0, 1)");
+        const double amount   = exactOut ? toDouble(getArg(args, "--amountOut"), "--amountOut")
+                                         : toDouble(getArg(args, "--amountIn"), "--amountIn");
+
+        SwapResult r;
+        double amountIn = amount;   // for --amountOut, the required input
+        {
+            ScopedStage mathTimer(Stage::Math, 1);
+            addStat(StatCounter::SwapsQuoted);
+            if (stable) {
+                r = simulateStableSwap(reserveA, reserveB, fee, amp, dir, amount);
+            } else if (weighted) {
+                r = simulateWeightedSwap(reserveA, reserveB, fee, weightA, 1.0 - weightA, dir, amount);
+            } else if (exactOut) {
+                r = simulateSwapExactOut(reserveA, reserveB, fee, dir, amount, &amountIn);
+            } else {
+                r = simulateSwap(reserveA, reserveB, fee, dir, amount);
+            }
+        }
 
-        std::cout << std::fixed << std::setprecision(10);
-        std::cout << "amountOut       = " << r.amountOut << "\n";
-        std::cout << "new reserveA    = " << r.newReserveA << "\n";
-        std::cout << "new reserveB    = " << r.newReserveB << "\n";
-        std::cout << "effective price = " << r.effectivePrice << "\n";
-        std::cout << "slippage (%)    = " << std::setprecision(6) << r.slippagePercent << "\n";
+        {
+            ScopedStage outputTimer(Stage::Output, 1);
+            std::cout << std::fixed << std::setprecision(10);
+            if (exactOut) std::cout << "amountIn        = " << amountIn << "\n";
+            std::cout << "amountOut       = " << r.amountOut << "\n";
+            std::cout << "new reserveA    = " << r.newReserveA << "\n";
+            std::cout << "new reserveB    = " << r.newReserveB << "\n";
+            std::cout << "effective price = " << r.effectivePrice << "\n";
+            std::cout << "slippage (%)    = " << std::setprecision(6) << r.slippagePercent << "\n";
+            std::cout.flush();
+        }
 
         return 0;
     } catch (const std::exception& e) {
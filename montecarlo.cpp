@@ -0,0 +1,244 @@
+#include "montecarlo.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "amm.h"
+#include "parallel_for.h"
+#include "rng.h"
+
+namespace {
+
+// Paths per task: a few hundred keeps every core busy on small runs while
+// a task still lasts long enough to amortize scheduling.
+const size_t kChunkPaths = 256;
+
+// Slippage histogram: log10(slippage %) from -6 to 2, 256 bins per decade.
+const int kBinsPerDecade = 256;
+const double kMinSlippageLog10 = -6.0;
+const int kSlippageBins = 8 * kBinsPerDecade;
+
+struct ChunkStats {
+    uint64_t trades = 0;
+    uint64_t failed = 0;
+    uint64_t arbitrageTrades = 0;
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+};
+
+int slippageBin(double s) {
+    if (!(s > 0.0)) return 0;
+    const double b = std::floor((std::log10(s) - kMinSlippageLog10) * kBinsPerDecade);
+    return (int)std::min(std::max(b, 0.0), (double)(kSlippageBins - 1));
+}
+
+// Trades the pool until its marginal price (after fee) meets the external
+// price P (B per A). Selling x of A pays at the margin
+//   gamma*rA*rB / (rA + gamma*x)^2,
+// which equals P at x = (sqrt(gamma*rA*rB / P) - rA) / gamma; B is the
+// mirror image with 1/P. Returns false if P is inside the fee band.
+bool arbitrageToPrice(double& rA, double& rB, double gamma, double price) {
+    const double k = gamma * rA * rB;
+    if (gamma * rB > price * rA) {
+        const double x = (std::sqrt(k / price) - rA) / gamma;
+        const double out = gamma * x * rB / (rA + gamma * x);
+        rA += x;
+        rB -= out;
+        return true;
+    }
+    if (gamma * rA * price > rB) {
+        const double y = (std::sqrt(k * price) - rB) / gamma;
+        const double out = gamma * y * rA / (rB + gamma * y);
+        rB += y;
+        rA -= out;
+        return true;
+    }
+    return false;
+}
+
+// Linear interpolation between order statistics; sorts v.
+Percentiles exactPercentiles(std::vector<double>& v, double sum) {
+    Percentiles p;
+    if (v.empty()) return p;
+    std::sort(v.begin(), v.end());
+    const auto at = [&](double q) {
+        const double pos = q * (double)(v.size() - 1);
+        const size_t i = (size_t)pos;
+        if (i + 1 >= v.size()) return v.back();
+        return v[i] + (v[i + 1] - v[i]) * (pos - (double)i);
+    };
+    p.mean = sum / (double)v.size();
+    p.min = v.front();
+    p.p1 = at(0.01);
+    p.p5 = at(0.05);
+    p.p25 = at(0.25);
+    p.p50 = at(0.50);
+    p.p75 = at(0.75);
+    p.p95 = at(0.95);
+    p.p99 = at(0.99);
+    p.max = v.back();
+    return p;
+}
+
+// Bin centers (geometric), clamped to the exact range.
+Percentiles histogramPercentiles(const std::vector<uint64_t>& bins, const ChunkStats& total) {
+    Percentiles p;
+    const uint64_t n = total.trades - total.failed;
+    if (n == 0) return p;
+    const auto at = [&](double q) {
+        const uint64_t rank = (uint64_t)(q * (double)(n - 1));
+        uint64_t seen = 0;
+        int b = 0;
+        for (; b < kSlippageBins - 1; ++b) {
+            seen += bins[(size_t)b];
+            if (seen > rank) break;
+        }
+        const double center = std::pow(10.0, kMinSlippageLog10 + ((double)b + 0.5) / kBinsPerDecade);
+        return std::min(std::max(center, total.min), total.max);
+    };
+    p.mean = total.sum / (double)n;
+    p.min = total.min;
+    p.p1 = at(0.01);
+    p.p5 = at(0.05);
+    p.p25 = at(0.25);
+    p.p50 = at(0.50);
+    p.p75 = at(0.75);
+    p.p95 = at(0.95);
+    p.p99 = at(0.99);
+    p.max = total.max;
+    return p;
+}
+
+} // namespace
+
+SizeDistribution parseSizeDistribution(const std::string& raw) {
+    std::string s;
+    for (const char c : raw) s += (char)std::tolower((unsigned char)c);
+    if (s == "lognormal") return SizeDistribution::LogNormal;
+    if (s == "pareto") return SizeDistribution::Pareto;
+    throw std::runtime_error("size distribution must be lognormal or pareto");
+}
+
+OrderFlowStats simulateOrderFlow(const OrderFlowSpec& spec, unsigned threads) {
+    require(spec.reserveA > 0.0 && spec.reserveB > 0.0, "reserveA and reserveB must be > 0");
+    require(spec.fee >= 0.0 && spec.fee < 1.0, "fee must be in [0, 1)");
+    require(spec.paths > 0 && spec.steps > 0, "paths and steps must be > 0");
+    require(spec.sizeMedian > 0.0, "trade size median must be > 0");
+    require(spec.sizeDistribution == SizeDistribution::LogNormal ? spec.sizeShape >= 0.0 : spec.sizeShape > 0.0,
+            "size shape must be >= 0 (lognormal sigma) or > 0 (pareto alpha)");
+    require(spec.a2bProbability >= 0.0 && spec.a2bProbability <= 1.0, "A2B probability must be in [0, 1]");
+    require(spec.volatility >= 0.0 && std::isfinite(spec.volatility) && std::isfinite(spec.drift),
+            "volatility must be >= 0 and drift finite");
+
+    const uint64_t chunks = (spec.paths + kChunkPaths - 1) / kChunkPaths;
+    require(chunks <= 0xffffffffu, "too many paths");
+    // Same clamping as parallelFor, so bins and stats match the threads that run.
+    if (threads == 0) threads = defaultThreadCount();
+    threads = (unsigned)std::min<uint64_t>(threads, chunks);
+
+    const double gamma = 1.0 - spec.fee;
+    const double price0 = spec.reserveB / spec.reserveA;
+    const double hodlA = spec.reserveA, hodlB = spec.reserveB;
+    const double logDrift = spec.drift - 0.5 * spec.volatility * spec.volatility;
+    const bool lognormal = spec.sizeDistribution == SizeDistribution::LogNormal;
+    const double logMedian = std::log(spec.sizeMedian);
+    // Pareto with median m: scale = m / 2^(1/alpha).
+    const double paretoScale = lognormal ? 0.0 : spec.sizeMedian / std::pow(2.0, 1.0 / spec.sizeShape);
+    const double paretoExponent = lognormal ? 0.0 : -1.0 / spec.sizeShape;
+
+    std::vector<double> pnl((size_t)spec.paths), il((size_t)spec.paths);
+    std::vector<ChunkStats> chunkStats((size_t)chunks);
+    // Integer counts add up the same in any order, so one histogram per worker.
+    std::vector<std::vector<uint64_t>> bins(threads, std::vector<uint64_t>((size_t)kSlippageBins, 0));
+
+    const auto t0 = std::chrono::steady_clock::now();
+    parallelFor((size_t)chunks, threads, [&](size_t chunk, unsigned worker) {
+        std::vector<uint64_t>& hist = bins[worker];
+        const uint64_t first = (uint64_t)chunk * kChunkPaths;
+        const uint64_t last = std::min<uint64_t>(first + kChunkPaths, spec.paths);
+
+        ChunkStats cs;
+        for (uint64_t path = first; path < last; ++path) {
+            PhiloxStream rng(spec.seed, path);
+            double rA = spec.reserveA, rB = spec.reserveB, price = price0;
+
+            for (uint32_t step = 0; step < spec.steps; ++step) {
+                price *= std::exp(logDrift + spec.volatility * rng.nextNormal());
+                if (spec.arbitrage && arbitrageToPrice(rA, rB, gamma, price)) ++cs.arbitrageTrades;
+
+                const bool aToB = rng.nextBernoulli(spec.a2bProbability);
+                double size = spec.sizeMedian;
+                if (!lognormal) {
+                    size = paretoScale * std::pow(1.0 - rng.nextDouble(), paretoExponent);
+                } else if (spec.sizeShape > 0.0) {
+                    size = rng.nextLogNormal(logMedian, spec.sizeShape);
+                }
+
+                double& rIn = aToB ? rA : rB;
+                double& rOut = aToB ? rB : rA;
+                const double amountIn = aToB ? size : size * price;
+                // getAmountOut's expression, so trades match simulateSwap bit for bit.
+                const double amountInWithFee = amountIn * gamma;
+                const double out = (amountInWithFee * rOut) / (rIn + amountInWithFee);
+                ++cs.trades;
+                if (!(out < rOut) || !std::isfinite(amountIn)) {
+                    ++cs.failed;
+                    continue;
+                }
+
+                const double spot = rOut / rIn;
+                const double slip = (spot - out / amountIn) / spot * 100.0;
+                cs.sum += slip;
+                cs.min = std::min(cs.min, slip);
+                cs.max = std::max(cs.max, slip);
+                ++hist[(size_t)slippageBin(slip)];
+
+                rIn += amountIn;
+                rOut -= out;
+            }
+
+            const double k = price / price0;
+            pnl[(size_t)path] = ((rA * price + rB) / (hodlA * price + hodlB) - 1.0) * 100.0;
+            il[(size_t)path] = (2.0 * std::sqrt(k) / (1.0 + k) - 1.0) * 100.0;
+        }
+        chunkStats[chunk] = cs;
+    });
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // Combine in chunk / path order so the floating-point sums do not depend on scheduling.
+    ChunkStats total;
+    for (const ChunkStats& cs : chunkStats) {
+        total.trades += cs.trades;
+        total.failed += cs.failed;
+        total.arbitrageTrades += cs.arbitrageTrades;
+        total.sum += cs.sum;
+        total.min = std::min(total.min, cs.min);
+        total.max = std::max(total.max, cs.max);
+    }
+    std::vector<uint64_t> hist((size_t)kSlippageBins, 0);
+    for (const auto& h : bins) {
+        for (size_t b = 0; b < hist.size(); ++b) hist[b] += h[b];
+    }
+    double pnlSum = 0.0, ilSum = 0.0;
+    for (size_t i = 0; i < pnl.size(); ++i) {
+        pnlSum += pnl[i];
+        ilSum += il[i];
+    }
+
+    OrderFlowStats st;
+    st.paths = spec.paths;
+    st.trades = total.trades;
+    st.failed = total.failed;
+    st.arbitrageTrades = total.arbitrageTrades;
+    st.lpPnlPercent = exactPercentiles(pnl, pnlSum);
+    st.impermanentLossPercent = exactPercentiles(il, ilSum);
+    st.slippagePercent = histogramPercentiles(hist, total);
+    st.seconds = seconds;
+    st.threads = threads;
+    return st;
+}
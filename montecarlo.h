@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Trade size law of the simulated order flow. Both are parameterized by
+// their median; `shape` is sigma of log(size) for LogNormal (0 = every
+// trade is the median) and the tail index alpha for Pareto.
+enum class SizeDistribution {
+    LogNormal,
+    Pareto,
+};
+
+// "lognormal" or "pareto" (CLI adapter).
+SizeDistribution parseSizeDistribution(const std::string& raw);
+
+// One pool, many random histories. Every step of a path:
+//   1. the external price P (B per A) takes a GBM step,
+//        P *= exp(drift - volatility^2 / 2 + volatility * N(0, 1));
+//   2. if arbitrage is on, an arbitrageur trades the pool to the external
+//      price (up to the fee band), which is what realizes the LP's
+//      impermanent loss;
+//   3. one flow trade: A2B with probability a2bProbability, else B2A, of a
+//      random size measured in A (B2A trades pay the same value in B at P).
+struct OrderFlowSpec {
+    double reserveA = 10000.0;
+    double reserveB = 10000.0;
+    double fee = 0.003;
+
+    uint64_t paths = 100000;
+    uint32_t steps = 100;               // flow trades per path
+
+    SizeDistribution sizeDistribution = SizeDistribution::LogNormal;
+    double sizeMedian = 10.0;           // in token A
+    double sizeShape = 1.0;
+
+    double a2bProbability = 0.5;        // direction bias
+    double drift = 0.0;                 // per step: E[P'] = P * exp(drift)
+    double volatility = 0.01;           // per step, stddev of log(P'/P)
+    bool arbitrage = true;
+
+    uint64_t seed = 1;
+};
+
+struct Percentiles {
+    double mean = 0.0;
+    double min = 0.0;
+    double p1 = 0.0, p5 = 0.0, p25 = 0.0, p50 = 0.0, p75 = 0.0, p95 = 0.0, p99 = 0.0;
+    double max = 0.0;
+};
+
+struct OrderFlowStats {
+    uint64_t paths = 0;
+    uint64_t trades = 0;           // flow trades simulated
+    uint64_t failed = 0;           // flow trades that would drain the pool (skipped)
+    uint64_t arbitrageTrades = 0;
+
+    // Per path, at the final external price:
+    //   lpPnl = value(pool reserves) / value(initial reserves held) - 1, fees included
+    //   impermanentLoss = 2*sqrt(k) / (1 + k) - 1, k = final P / initial P
+    // in percent, exact order statistics.
+    Percentiles lpPnlPercent;
+    Percentiles impermanentLossPercent;
+
+    // Per flow trade, as simulateSwap reports it. Percentiles come from a
+    // log-spaced histogram (256 bins per decade, so within 0.5% of the
+    // exact value); mean, min and max are exact.
+    Percentiles slippagePercent;
+
+    double seconds = 0.0;
+    unsigned threads = 0;
+};
+
+// Simulates spec.paths independent paths, in fixed-size chunks scheduled
+// with parallelFor (threads = 0 means all cores). Path i draws only from
+// PhiloxStream (seed, i), per-path results are stored by path index and
+// chunk sums are combined in chunk order, so the statistics are identical
+// for any thread count. Keeps 16 bytes per path for the exact percentiles.
+OrderFlowStats simulateOrderFlow(const OrderFlowSpec& spec, unsigned threads);
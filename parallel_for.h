@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use when the caller asks for 0 (= all cores).
+inline unsigned defaultThreadCount() {
+    const unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// Runs fn(task, worker) for every task in [0, taskCount) on `threads` threads
+// (0 = all cores) with work stealing:
+//   - tasks are split into one contiguous range per worker;
+//   - a worker takes tasks from the front of its own range;
+//   - an idle worker steals the back half of another worker's range.
+// Each range is one atomic word (begin << 32 | end) changed only by CAS, so
+// there are no locks. Which thread runs a task is not deterministic; callers
+// that need deterministic output must make each task's result depend only
+// on the task index. The first exception thrown by fn is rethrown here.
+template <class F>
+void parallelFor(size_t taskCount, unsigned threads, F&& fn) {
+    if (taskCount == 0) return;
+    if (taskCount > 0xffffffffu) throw std::runtime_error("parallelFor: too many tasks");
+    if (threads == 0) threads = defaultThreadCount();
+    threads = (unsigned)std::min<size_t>(threads, taskCount);
+
+    struct alignas(64) Range {
+        std::atomic<uint64_t> v{0};
+    };
+    const auto pack = [](uint64_t begin, uint64_t end) { return (begin << 32) | end; };
+
+    std::unique_ptr<Range[]> ranges(new Range[threads]);
+    for (unsigned w = 0; w < threads; ++w) {
+        const uint64_t begin = taskCount * w / threads;
+        const uint64_t end = taskCount * (w + 1) / threads;
+        ranges[w].v.store(pack(begin, end), std::memory_order_relaxed);
+    }
+
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::atomic_flag errorLock = ATOMIC_FLAG_INIT;
+
+    const auto worker = [&](unsigned self) {
+        try {
+            for (;;) {
+                // Own range first.
+                uint64_t v = ranges[self].v.load(std::memory_order_acquire);
+                for (;;) {
+                    const uint64_t begin = v >> 32, end = v & 0xffffffffu;
+                    if (begin >= end || failed.load(std::memory_order_relaxed)) break;
+                    if (ranges[self].v.compare_exchange_weak(v, pack(begin + 1, end), std::memory_order_acq_rel)) {
+                        fn((size_t)begin, self);
+                        v = ranges[self].v.load(std::memory_order_acquire);
+                    }
+                }
+                if (failed.load(std::memory_order_relaxed)) return;
+
+                // Steal the back half of the first non-empty victim.
+                bool stole = false;
+                for (unsigned k = 1; k < threads && !stole; ++k) {
+                    Range& victim = ranges[(self + k) % threads];
+                    uint64_t vv = victim.v.load(std::memory_order_acquire);
+                    for (;;) {
+                        const uint64_t begin = vv >> 32, end = vv & 0xffffffffu;
+                        if (begin >= end) break;
+                        const uint64_t mid = begin + (end - begin) / 2;   // thief gets [mid, end)
+                        if (victim.v.compare_exchange_weak(vv, pack(begin, mid), std::memory_order_acq_rel)) {
+                            ranges[self].v.store(pack(mid, end), std::memory_order_release);
+                            stole = true;
+                            break;
+                        }
+                    }
+                }
+                // Nothing left anywhere (tasks are only moved, never added).
+                if (!stole) return;
+            }
+        } catch (...) {
+            while (errorLock.test_and_set(std::memory_order_acquire)) {}
+            if (!error) error = std::current_exception();
+            errorLock.clear(std::memory_order_release);
+            failed.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned w = 1; w < threads; ++w) pool.emplace_back(worker, w);
+    worker(0);
+    for (auto& t : pool) t.join();
+
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,127 @@
+#include "parse_number.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+namespace {
+
+// Exactly representable powers of ten (10^22 is the largest below 2^53 * 2^22).
+const double kPow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+inline bool isDigit(char c) { return (unsigned)(c - '0') < 10u; }
+
+// Correctly rounded fallback for inputs outside the fast path
+// (more than 19 significant digits, or a large exponent).
+// False if the value overflows a double or underflows to zero; subnormal
+// results are accepted.
+bool parseSlow(const char* first, const char* last, bool negative, double& value) {
+#if defined(__cpp_lib_to_chars)
+    double v = 0.0;
+    const std::from_chars_result r = std::from_chars(first, last, v);
+    if (r.ec != std::errc()) return false;
+#else
+    // No floating-point from_chars in this standard library: strtod on a
+    // copy. Only reached for rare long/huge inputs, and the syntax is
+    // already checked, so the decimal point is the only locale concern.
+    // strtod also sets ERANGE for subnormal results, so only a zero or
+    // infinite result counts as out of range.
+    const std::string buf(first, last);
+    errno = 0;
+    const double v = std::strtod(buf.c_str(), nullptr);
+    if (errno == ERANGE && (v == 0.0 || !std::isfinite(v))) return false;
+#endif
+    value = negative ? -v : v;
+    return true;
+}
+
+} // namespace
+
+const char* parseDouble(const char* first, const char* last, double& value) {
+    const char* p = first;
+    bool negative = false;
+    if (p < last && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+    const char* digitsBegin = p;
+
+    // Up to 19 significant digits fit in uint64_t; more digits only shift the exponent.
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exp10 = 0;
+    bool truncated = false;
+    bool sawDigit = false;
+
+    for (; p < last && isDigit(*p); ++p) {
+        sawDigit = true;
+        if (mantissa == 0 && *p == '0') continue;   // leading zeros
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            ++digits;
+        } else {
+            ++exp10;
+            truncated |= (*p != '0');
+        }
+    }
+    if (p < last && *p == '.') {
+        ++p;
+        for (; p < last && isDigit(*p); ++p) {
+            sawDigit = true;
+            if (mantissa == 0 && *p == '0') { --exp10; continue; }
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                ++digits;
+                --exp10;
+            } else {
+                truncated |= (*p != '0');
+            }
+        }
+    }
+    if (!sawDigit) return nullptr;
+
+    if (p < last && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        bool expNegative = false;
+        if (e < last && (*e == '-' || *e == '+')) {
+            expNegative = (*e == '-');
+            ++e;
+        }
+        if (e < last && isDigit(*e)) {
+            int expValue = 0;
+            for (; e < last && isDigit(*e); ++e) {
+                if (expValue < 100000) expValue = expValue * 10 + (*e - '0');
+            }
+            exp10 += expNegative ? -expValue : expValue;
+            p = e;
+        }
+        // "1e" / "1e+" : the exponent is not part of the number (from_chars does the same).
+    }
+
+    if (mantissa == 0) {
+        value = negative ? -0.0 : 0.0;
+        return p;
+    }
+
+    // Clinger's fast path: mantissa and 10^|exp10| are both exact doubles,
+    // so one IEEE multiply/divide gives the correctly rounded result.
+    if (!truncated && mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+        double v = (double)mantissa;
+        v = exp10 < 0 ? v / kPow10[-exp10] : v * kPow10[exp10];
+        value = negative ? -v : v;
+        return p;
+    }
+
+    return parseSlow(digitsBegin, p, negative, value) ? p : nullptr;
+}
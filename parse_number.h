@@ -0,0 +1,16 @@
+#pragma once
+
+// Locale-independent, non-throwing, allocation-free number parsing for the
+// CLI and bulk input paths (replaces std::stod).
+
+// Parses a decimal number at the start of [first, last):
+//   [+-] digits [. digits] [(e|E) [+-] digits]
+// No leading whitespace, no hex, no inf/nan. Rounds correctly (nearest even).
+// Returns the pointer past the number, or nullptr if there is no number or
+// it is out of double range (value is left untouched then), like std::from_chars.
+const char* parseDouble(const char* first, const char* last, double& value);
+
+// True only if the whole range is one number.
+inline bool parseDoubleFull(const char* first, const char* last, double& value) {
+    return first != last && parseDouble(first, last, value) == last;
+}
@@ -0,0 +1,79 @@
+#include "pool_batch.h"
+
+#include "stage_stats.h"
+
+PoolBatchPricer::PoolBatchPricer(size_t capacity)
+        : lane_(capacity), reserveIn_(capacity), reserveOut_(capacity), fee_(capacity), amountIn_(capacity),
+          paramIn_(capacity), paramOut_(capacity), amountOut_(capacity), newReserveIn_(capacity),
+          newReserveOut_(capacity), effectivePrice_(capacity), slippage_(capacity), error_(capacity) {}
+
+size_t PoolBatchPricer::price(const PoolRegistry& reg, const PoolId* ids, const Direction* dirs,
+                              const double* amountIn, size_t n, const SwapBatchOutput& out) {
+    require(n <= capacity(), "batch larger than the pricer's capacity");
+    ScopedStage timer(Stage::Math, n);
+
+    // Counting sort by kind: bucket k is staging slots [begin[k], begin[k + 1]).
+    size_t begin[kPoolKinds + 1] = {};
+    for (size_t i = 0; i < n; ++i) {
+        require(ids[i] < reg.size(), "unknown pool id");
+        ++begin[(size_t)reg.kind(ids[i]) + 1];
+    }
+    for (size_t k = 0; k < kPoolKinds; ++k) {
+        lastCount_[k] = begin[k + 1];
+        begin[k + 1] += begin[k];
+    }
+
+    size_t next[kPoolKinds];
+    for (size_t k = 0; k < kPoolKinds; ++k) next[k] = begin[k];
+    for (size_t i = 0; i < n; ++i) {
+        const PoolId id = ids[i];
+        const PoolKind kind = reg.kind(id);
+        const Pool& p = reg.pool(id);
+        const bool aToB = dirs[i] == Direction::A2B;
+        const size_t j = next[(size_t)kind]++;
+        lane_[j] = (uint32_t)i;
+        reserveIn_[j] = aToB ? p.reserveA : p.reserveB;
+        reserveOut_[j] = aToB ? p.reserveB : p.reserveA;
+        fee_[j] = p.fee;
+        amountIn_[j] = amountIn[i];
+        if (kind == PoolKind::Stable) {
+            paramIn_[j] = reg.curveParam(id);
+        } else if (kind == PoolKind::Weighted) {
+            const double weightA = reg.curveParam(id);
+            paramIn_[j] = aToB ? weightA : 1.0 - weightA;
+            paramOut_[j] = aToB ? 1.0 - weightA : weightA;
+        }
+    }
+
+    size_t bad = 0;
+    for (size_t k = 0; k < kPoolKinds; ++k) {
+        const size_t b = begin[k], count = begin[k + 1] - b;
+        if (count == 0) continue;
+        const SwapBatchInput in{reserveIn_.data() + b, reserveOut_.data() + b, fee_.data() + b,
+                                amountIn_.data() + b, count};
+        const SwapBatchOutput bucket{amountOut_.data() + b, newReserveIn_.data() + b, newReserveOut_.data() + b,
+                                     effectivePrice_.data() + b, slippage_.data() + b, error_.data() + b};
+        switch ((PoolKind)k) {
+            case PoolKind::Stable:
+                bad += simulateStableSwapBatch(in, paramIn_.data() + b, bucket);
+                break;
+            case PoolKind::Weighted:
+                bad += simulateWeightedSwapBatch(in, paramIn_.data() + b, paramOut_.data() + b, bucket);
+                break;
+            default:
+                bad += simulateSwapBatch(in, bucket);
+                break;
+        }
+    }
+
+    for (size_t j = 0; j < n; ++j) {
+        const size_t i = lane_[j];
+        out.amountOut[i] = amountOut_[j];
+        out.newReserveIn[i] = newReserveIn_[j];
+        out.newReserveOut[i] = newReserveOut_[j];
+        out.effectivePrice[i] = effectivePrice_[j];
+        out.slippagePercent[i] = slippage_[j];
+        out.error[i] = error_[j];
+    }
+    return bad;
+}
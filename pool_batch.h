@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pool_registry.h"
+#include "swap_batch.h"
+
+// Prices swaps against registry pools of mixed kinds without a per-swap
+// branch or virtual call on the kind. Lanes are counting-sorted by kind
+// (read from the registry's kind column) into type-sorted SoA buckets, one
+// contiguous range of the staging columns per kind, gathering each pool
+// line once straight into its bucket slot. Each bucket goes through its
+// kind's batch kernel in a single call (simulateSwapBatch, simulateStableSwapBatch,
+// simulateWeightedSwapBatch); results are scattered back in lane order.
+// Each kernel is monomorphic and SIMD-dispatched, so results are the same
+// as quoteSwap lane by lane.
+//
+// Every lane is priced against the registry's current reserves: callers
+// that replay sequential swaps must not put two swaps on one pool in the
+// same call (see the replay batcher).
+class PoolBatchPricer {
+public:
+    // Lanes per price() call; staging columns are allocated once here.
+    explicit PoolBatchPricer(size_t capacity);
+
+    // Same error-mask semantics as simulateSwapBatch. Lane i's output
+    // slots are out.*[i]; returns the number of lanes with a non-zero mask.
+    size_t price(const PoolRegistry& reg, const PoolId* ids, const Direction* dirs, const double* amountIn,
+                 size_t n, const SwapBatchOutput& out);
+
+    size_t capacity() const { return lane_.size(); }
+
+    // Lanes priced per kind by the last price() call.
+    size_t lastCount(PoolKind kind) const { return lastCount_[(size_t)kind]; }
+
+private:
+    std::vector<uint32_t> lane_;                           // sorted slot -> input lane
+    std::vector<double> reserveIn_, reserveOut_, fee_, amountIn_;
+    std::vector<double> paramIn_, paramOut_;               // amp, or weightIn / weightOut
+    std::vector<double> amountOut_, newReserveIn_, newReserveOut_, effectivePrice_, slippage_;
+    std::vector<uint8_t> error_;
+    size_t lastCount_[kPoolKinds] = {};
+};
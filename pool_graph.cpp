@@ -0,0 +1,62 @@
+#include "pool_graph.h"
+
+static void setEdge(PoolGraph::Edge& e, const PoolRegistry& reg, PoolId id, Direction dir) {
+    const Pool& p = reg.pool(id);
+    const bool aToB = (dir == Direction::A2B);
+    e.reserveIn = aToB ? p.reserveA : p.reserveB;
+    e.reserveOut = aToB ? p.reserveB : p.reserveA;
+    e.fee = p.fee;
+    e.tokenOut = aToB ? p.tokenB : p.tokenA;
+    e.kind = reg.kind(id);
+    e.curveParam = 0.0;
+    if (e.kind == PoolKind::Stable) {
+        e.curveParam = reg.curveParam(id);
+    } else if (e.kind == PoolKind::Weighted) {
+        // Only the weight ratio enters getAmountOutWeighted; (ratio, 1)
+        // gives the same bits as the two weights quoteSwap passes.
+        const double weightA = reg.curveParam(id), weightB = 1.0 - weightA;
+        e.curveParam = aToB ? weightA / weightB : weightB / weightA;
+    }
+}
+
+double PoolGraph::curveAmountOut(const Edge& e, double x) {
+    if (!(x > 0.0)) return 0.0;
+    const double out = (e.kind == PoolKind::Stable)
+                       ? getAmountOutStable(x, e.reserveIn, e.reserveOut, e.fee, e.curveParam)
+                       : getAmountOutWeighted(x, e.reserveIn, e.reserveOut, e.fee, e.curveParam, 1.0);
+    return out < e.reserveOut ? out : 0.0;
+}
+
+void PoolGraph::build(const PoolRegistry& reg) {
+    const size_t tokens = reg.tokenCount();
+    const size_t pools = reg.size();
+
+    // Counting sort of the 2 * pools edges by input token.
+    edgeBegin.assign(tokens + 1, 0);
+    for (size_t i = 0; i < pools; ++i) {
+        const Pool& p = reg.pool((PoolId)i);
+        ++edgeBegin[p.tokenA + 1];
+        ++edgeBegin[p.tokenB + 1];
+    }
+    for (size_t t = 0; t < tokens; ++t) edgeBegin[t + 1] += edgeBegin[t];
+
+    std::vector<uint32_t> fill(edgeBegin.begin(), edgeBegin.end() - 1);
+    edges.resize(2 * pools);
+    poolEdge.resize(2 * pools);
+    for (size_t i = 0; i < pools; ++i) {
+        const Pool& p = reg.pool((PoolId)i);
+        const uint32_t ab = fill[p.tokenA]++;
+        const uint32_t ba = fill[p.tokenB]++;
+        edges[ab].pool = edges[ba].pool = (PoolId)i;
+        setEdge(edges[ab], reg, (PoolId)i, Direction::A2B);
+        setEdge(edges[ba], reg, (PoolId)i, Direction::B2A);
+        poolEdge[2 * i] = ab;
+        poolEdge[2 * i + 1] = ba;
+    }
+}
+
+void PoolGraph::update(const PoolRegistry& reg, PoolId id) {
+    require(id < reg.size() && 2 * (size_t)id < poolEdge.size(), "unknown pool id (rebuild the graph?)");
+    setEdge(edges[poolEdge[2 * id]], reg, id, Direction::A2B);
+    setEdge(edges[poolEdge[2 * id + 1]], reg, id, Direction::B2A);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pool_registry.h"
+
+// Directed token graph over a PoolRegistry: every pool is two edges
+// (A->B and B->A) stored in CSR order by input token, each carrying what
+// its pool's getAmountOut needs in that direction. For x*y=k:
+//   out = x * gamma*reserveOut / (reserveIn + gamma*x),  gamma = 1 - fee
+// Stable and weighted edges are priced on their own curve, with the same
+// results as PoolRegistry::quoteSwap.
+// Shared by Router and ArbitrageDetector.
+struct PoolGraph {
+    struct Edge {
+        double reserveIn;
+        double reserveOut;
+        double fee;
+        double curveParam;   // Stable: amplification; Weighted: weightIn / weightOut; 0 for x*y=k
+        TokenId tokenOut;
+        PoolId pool;
+        PoolKind kind;
+    };
+
+    std::vector<uint32_t> edgeBegin;   // tokenCount + 1 offsets into edges
+    std::vector<Edge> edges;
+    std::vector<uint32_t> poolEdge;    // 2 per pool: A->B edge, B->A edge
+
+    // Re-reads topology and reserves of every pool.
+    void build(const PoolRegistry& reg);
+
+    // Re-reads one pool's reserves.
+    void update(const PoolRegistry& reg, PoolId id);
+
+    size_t tokenCount() const { return edgeBegin.size() - 1; }
+
+    // The same pool traversed the other way.
+    uint32_t reverse(uint32_t k) const {
+        const PoolId p = edges[k].pool;
+        return poolEdge[2 * p] == k ? poolEdge[2 * p + 1] : poolEdge[2 * p];
+    }
+
+    TokenId source(uint32_t k) const { return edges[reverse(k)].tokenOut; }
+
+    static double gamma(const Edge& e) { return 1.0 - e.fee; }
+    static double gammaReserveOut(const Edge& e) { return gamma(e) * e.reserveOut; }
+
+    // Same value as the pool's getAmountOut (0 for x <= 0, and for a stable
+    // or weighted trade that would drain the pool).
+    static double amountOut(const Edge& e, double x) {
+        if (e.kind != PoolKind::ConstantProduct) return curveAmountOut(e, x);
+        const double g = gamma(e);
+        return x * (g * e.reserveOut) / (e.reserveIn + g * x);
+    }
+
+    // Output per unit input for an infinitesimal x*y=k trade.
+    static double spotRate(const Edge& e) { return gammaReserveOut(e) / e.reserveIn; }
+
+private:
+    static double curveAmountOut(const Edge& e, double x);
+};
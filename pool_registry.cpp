@@ -0,0 +1,169 @@
+#include "pool_registry.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "stage_stats.h"
+
+static const uint64_t kEmptyKey = ~0ull;
+
+// Unordered pair -> 64-bit key (smaller token id in the high half).
+static uint64_t pairKey(TokenId a, TokenId b) {
+    const uint64_t lo = a < b ? a : b;
+    const uint64_t hi = a < b ? b : a;
+    return (lo << 32) | hi;
+}
+
+static size_t pairHash(uint64_t key, size_t mask) {
+    // Fibonacci hashing: multiply spreads the bits, top bits are the best mixed.
+    return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+TokenId PoolRegistry::internToken(const std::string& symbol) {
+    auto it = tokenIds_.find(symbol);
+    if (it != tokenIds_.end()) return it->second;
+    const TokenId id = (TokenId)tokenNames_.size();
+    tokenNames_.push_back(symbol);
+    tokenIds_.emplace(symbol, id);
+    return id;
+}
+
+TokenId PoolRegistry::findToken(const std::string& symbol) const {
+    auto it = tokenIds_.find(symbol);
+    return it == tokenIds_.end() ? kNoToken : it->second;
+}
+
+const char* poolKindName(PoolKind kind) {
+    switch (kind) {
+        case PoolKind::Stable: return "stable";
+        case PoolKind::Weighted: return "weighted";
+        default: return "constant-product";
+    }
+}
+
+PoolId PoolRegistry::addPool(TokenId tokenA, TokenId tokenB, double reserveA, double reserveB, double fee) {
+    return addPool(tokenA, tokenB, reserveA, reserveB, fee, PoolKind::ConstantProduct, 0.0);
+}
+
+PoolId PoolRegistry::addPool(TokenId tokenA, TokenId tokenB, double reserveA, double reserveB, double fee,
+                             PoolKind kind, double curveParam) {
+    require(tokenA != tokenB, "pool tokens must differ");
+    require(reserveA > 0.0 && reserveB > 0.0, "reserveA and reserveB must be > 0");
+    require(fee >= 0.0 && fee < 1.0, "fee must be in [0, 1)");
+    require(pools_.size() < kNoPool, "too many pools");
+    if (kind == PoolKind::Stable) require(curveParam >= 1.0, "amp must be >= 1");
+    if (kind == PoolKind::Weighted) require(curveParam > 0.0 && curveParam < 1.0, "weightA must be in (0, 1)");
+    if (kind == PoolKind::ConstantProduct) curveParam = 0.0;
+
+    const PoolId id = (PoolId)pools_.size();
+    Pool p;
+    p.reserveA = reserveA;
+    p.reserveB = reserveB;
+    p.fee = fee;
+    p.tokenA = tokenA;
+    p.tokenB = tokenB;
+    p.totalShares = std::sqrt(reserveA * reserveB);
+    pools_.push_back(p);
+    kinds_.push_back(kind);
+    curveParams_.push_back(curveParam);
+    byKind_[(size_t)kind].push_back(id);
+
+    if ((pairCount_ + 1) * 2 > pairKeys_.size()) rehash(pairKeys_.empty() ? 16 : pairKeys_.size() * 2);
+    insertPairSlot(pairKey(tokenA, tokenB), id);
+    return id;
+}
+
+void PoolRegistry::insertPairSlot(uint64_t key, PoolId id) {
+    const size_t mask = pairKeys_.size() - 1;
+    for (size_t i = pairHash(key, mask);; i = (i + 1) & mask) {
+        if (pairKeys_[i] == kEmptyKey) {
+            pairKeys_[i] = key;
+            pairPools_[i] = id;
+            pairTail_[i] = id;
+            ++pairCount_;
+            return;
+        }
+        if (pairKeys_[i] == key) {
+            // Pair already listed: append to its chain.
+            pools_[pairTail_[i]].nextSamePair = id;
+            pairTail_[i] = id;
+            return;
+        }
+    }
+}
+
+void PoolRegistry::rehash(size_t capacity) {
+    std::vector<uint64_t> oldKeys(capacity, kEmptyKey);
+    std::vector<PoolId> oldPools(capacity, kNoPool);
+    std::vector<PoolId> oldTail(capacity, kNoPool);
+    pairKeys_.swap(oldKeys);
+    pairPools_.swap(oldPools);
+    pairTail_.swap(oldTail);
+
+    const size_t mask = capacity - 1;
+    for (size_t j = 0; j < oldKeys.size(); ++j) {
+        if (oldKeys[j] == kEmptyKey) continue;
+        size_t i = pairHash(oldKeys[j], mask);
+        while (pairKeys_[i] != kEmptyKey) i = (i + 1) & mask;
+        pairKeys_[i] = oldKeys[j];
+        pairPools_[i] = oldPools[j];
+        pairTail_[i] = oldTail[j];
+    }
+}
+
+PoolId PoolRegistry::findPool(TokenId a, TokenId b) const {
+    if (pairKeys_.empty()) return kNoPool;
+    const uint64_t key = pairKey(a, b);
+    const size_t mask = pairKeys_.size() - 1;
+    for (size_t i = pairHash(key, mask);; i = (i + 1) & mask) {
+        if (pairKeys_[i] == key) return pairPools_[i];
+        if (pairKeys_[i] == kEmptyKey) return kNoPool;
+    }
+}
+
+double PoolRegistry::mintShares(PoolId id, double amountA, double amountB, double& usedA, double& usedB) {
+    require(id < pools_.size(), "unknown pool id");
+    Pool& p = pools_[id];
+    const double fraction = std::min(amountA / p.reserveA, amountB / p.reserveB);
+    require(fraction > 0.0 && std::isfinite(fraction), "liquidity amounts must be > 0");
+    usedA = fraction * p.reserveA;
+    usedB = fraction * p.reserveB;
+    const double shares = fraction * p.totalShares;
+    p.reserveA += usedA;
+    p.reserveB += usedB;
+    p.totalShares += shares;
+    return shares;
+}
+
+void PoolRegistry::burnShares(PoolId id, double shares, double& amountA, double& amountB) {
+    require(id < pools_.size(), "unknown pool id");
+    Pool& p = pools_[id];
+    require(shares > 0.0 && shares < p.totalShares, "shares to burn must be in (0, totalShares)");
+    const double fraction = shares / p.totalShares;
+    amountA = fraction * p.reserveA;
+    amountB = fraction * p.reserveB;
+    p.reserveA -= amountA;
+    p.reserveB -= amountB;
+    p.totalShares -= shares;
+}
+
+Direction PoolRegistry::directionFor(PoolId id, TokenId tokenIn) const {
+    require(id < pools_.size(), "unknown pool id");
+    const Pool& p = pools_[id];
+    require(tokenIn == p.tokenA || tokenIn == p.tokenB, "token is not in this pool");
+    return tokenIn == p.tokenA ? Direction::A2B : Direction::B2A;
+}
+
+void PoolRegistry::applySwaps(const PoolId* ids, const Direction* dirs, const double* amountIn, size_t n,
+                              SwapResult* results) {
+    // Far enough ahead to cover DRAM latency, near enough to stay in L1.
+    const size_t kPrefetchDistance = 8;
+    ScopedStage timer(Stage::Math, n);
+    addStat(StatCounter::SwapsQuoted, n);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (i + kPrefetchDistance < n) prefetch(ids[i + kPrefetchDistance]);
+        const SwapResult r = applySwap(ids[i], dirs[i], amountIn[i]);
+        if (results) results[i] = r;
+    }
+}
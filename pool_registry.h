@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aligned_allocator.h"
+#include "amm.h"
+#include "stableswap.h"
+#include "weighted.h"
+
+using PoolId = uint32_t;
+using TokenId = uint32_t;
+
+const PoolId kNoPool = 0xffffffffu;
+const TokenId kNoToken = 0xffffffffu;
+
+// Swap curve of a registry pool. Each kind has its own batch kernel, and
+// batches are priced one kind at a time (see pool_batch.h), so no inner
+// loop branches on the kind. Concentrated-liquidity pools are not
+// registry pools: their state is a tick map, not two reserves
+// (see concentrated.h).
+enum class PoolKind : uint8_t {
+    ConstantProduct,   // x*y=k; no curve parameter
+    Stable,            // StableSwap; curve parameter = amplification A >= 1
+    Weighted,          // Balancer; curve parameter = weight of tokenA in (0, 1)
+};
+
+const size_t kPoolKinds = 3;
+
+const char* poolKindName(PoolKind kind);
+
+// One pool = one cache line: a swap on a random pool touches exactly
+// one line of pool state (AoS on purpose; SoA would cost a miss per field).
+struct alignas(64) Pool {
+    double reserveA{};
+    double reserveB{};
+    double fee{};
+    TokenId tokenA{};
+    TokenId tokenB{};
+    PoolId nextSamePair = kNoPool;   // next pool listing the same token pair
+
+    // LP side. Shares start at sqrt(reserveA * reserveB) (the liquidity the
+    // pool was created with). Every swap adds amountIn * fee / totalShares
+    // to the growth of its input token (StableSwap pools charge the fee on
+    // the output, so it goes to the output token), and an LP's fee income
+    // since any point is shares * (growth now - growth then).
+    double totalShares{};
+    double feeGrowthA{};
+    double feeGrowthB{};
+};
+
+static_assert(sizeof(Pool) == 64, "Pool must stay one cache line");
+
+// Owns the state of many pools, indexed by dense PoolId. The kind and
+// curve parameter of each pool live in side columns, so Pool stays one
+// cache line for every kind and a batch can be sorted by kind without
+// touching the pool lines.
+class PoolRegistry {
+public:
+    // Token symbols are interned once at the ingest boundary.
+    TokenId internToken(const std::string& symbol);
+    // kNoToken if the symbol was never interned.
+    TokenId findToken(const std::string& symbol) const;
+    const std::string& tokenName(TokenId id) const { return tokenNames_[id]; }
+    size_t tokenCount() const { return tokenNames_.size(); }
+
+    // Adds a pool and returns its id (ids are assigned 0, 1, 2, ...).
+    PoolId addPool(TokenId tokenA, TokenId tokenB, double reserveA, double reserveB, double fee);
+    PoolId addPool(TokenId tokenA, TokenId tokenB, double reserveA, double reserveB, double fee,
+                   PoolKind kind, double curveParam);
+
+    size_t size() const { return pools_.size(); }
+    const Pool& pool(PoolId id) const { return pools_[id]; }
+
+    PoolKind kind(PoolId id) const { return kinds_[id]; }
+
+    // Amplification (Stable) or weight of tokenA (Weighted); 0 for x*y=k.
+    double curveParam(PoolId id) const { return curveParams_[id]; }
+
+    // Ids of every pool of a kind, ascending.
+    const std::vector<PoolId>& poolsOfKind(PoolKind kind) const { return byKind_[(size_t)kind]; }
+
+    // O(1) lookup by unordered token pair; kNoPool if no pool lists it.
+    // Further pools for the same pair are chained via Pool::nextSamePair.
+    PoolId findPool(TokenId a, TokenId b) const;
+
+    // A2B if tokenIn is the pool's tokenA, B2A if it is tokenB.
+    Direction directionFor(PoolId id, TokenId tokenIn) const;
+
+    // Prices a swap on the pool's own curve without applying it.
+    template <Direction D>
+    SwapResult quoteSwap(PoolId id, double amountIn) const {
+        require(id < pools_.size(), "unknown pool id");
+        const Pool& p = pools_[id];
+        switch (kinds_[id]) {
+            case PoolKind::Stable:
+                return simulateStableSwap<D>(p.reserveA, p.reserveB, p.fee, curveParams_[id], amountIn);
+            case PoolKind::Weighted:
+                return simulateWeightedSwap<D>(p.reserveA, p.reserveB, p.fee, curveParams_[id],
+                                               1.0 - curveParams_[id], amountIn);
+            default:
+                return simulateSwap<D>(p.reserveA, p.reserveB, p.fee, amountIn);
+        }
+    }
+
+    SwapResult quoteSwap(PoolId id, Direction dir, double amountIn) const {
+        return dir == Direction::A2B ? quoteSwap<Direction::A2B>(id, amountIn)
+                                     : quoteSwap<Direction::B2A>(id, amountIn);
+    }
+
+    // Prices the swap with quoteSwap and stores the new reserves.
+    // On error (require) the pool is left unchanged.
+    template <Direction D>
+    SwapResult applySwap(PoolId id, double amountIn) {
+        const SwapResult r = quoteSwap<D>(id, amountIn);
+        commitSwap(id, D, amountIn, r.newReserveA, r.newReserveB);
+        return r;
+    }
+
+    SwapResult applySwap(PoolId id, Direction dir, double amountIn) {
+        return dir == Direction::A2B ? applySwap<Direction::A2B>(id, amountIn)
+                                     : applySwap<Direction::B2A>(id, amountIn);
+    }
+
+    // Stores the result of a swap priced elsewhere (e.g. by the batch
+    // engine) and accrues its fee to the LPs.
+    void commitSwap(PoolId id, Direction dir, double amountIn, double newReserveA, double newReserveB) {
+        Pool& p = pools_[id];
+        const bool aToB = dir == Direction::A2B;
+        if (kinds_[id] == PoolKind::Stable) {
+            // amountOut is (1 - fee) of the curve's output; the rest stayed in the pool.
+            const double amountOut = aToB ? p.reserveB - newReserveB : p.reserveA - newReserveA;
+            const double feeGrowth = amountOut * p.fee / (1.0 - p.fee) / p.totalShares;
+            (aToB ? p.feeGrowthB : p.feeGrowthA) += feeGrowth;
+        } else {
+            const double feeGrowth = amountIn * p.fee / p.totalShares;
+            (aToB ? p.feeGrowthA : p.feeGrowthB) += feeGrowth;
+        }
+        p.reserveA = newReserveA;
+        p.reserveB = newReserveB;
+    }
+
+    // Overwrites a pool's reserves (no fee accrual; shares are unchanged).
+    void setReserves(PoolId id, double reserveA, double reserveB) {
+        Pool& p = pools_[id];
+        p.reserveA = reserveA;
+        p.reserveB = reserveB;
+    }
+
+    // Adds liquidity at the pool's current ratio, like UniswapV2Router's
+    // addLiquidity: deposits the largest amounts <= (amountA, amountB) in
+    // that ratio (written to usedA/usedB) and returns the shares minted.
+    double mintShares(PoolId id, double amountA, double amountB, double& usedA, double& usedB);
+
+    // Burns shares (fewer than totalShares) for the same fraction of both
+    // reserves, written to amountA/amountB.
+    void burnShares(PoolId id, double shares, double& amountA, double& amountB);
+
+    // Applies a sequence of swaps in order, prefetching pools a few swaps
+    // ahead so random pool ids don't stall on memory one at a time.
+    // results may be null. Throws on the first bad swap; earlier swaps stay applied.
+    void applySwaps(const PoolId* ids, const Direction* dirs, const double* amountIn, size_t n,
+                    SwapResult* results);
+
+    // Hint that pool id will be touched soon.
+    void prefetch(PoolId id) const {
+#if defined(__GNUC__)
+        if (id < pools_.size()) __builtin_prefetch(&pools_[id], 1);
+#else
+        (void)id;
+#endif
+    }
+
+private:
+    void rehash(size_t capacity);
+    void insertPairSlot(uint64_t key, PoolId id);
+
+    std::vector<Pool, AlignedAllocator<Pool, 64>> pools_;
+    std::vector<PoolKind> kinds_;        // per pool
+    std::vector<double> curveParams_;    // per pool
+    std::vector<PoolId> byKind_[kPoolKinds];
+
+    // Open-addressing hash of pair key -> first pool id (linear probing,
+    // power-of-two capacity, load factor <= 1/2).
+    std::vector<uint64_t> pairKeys_;
+    std::vector<PoolId> pairPools_;
+    std::vector<PoolId> pairTail_;     // last pool in each pair's chain
+    size_t pairCount_ = 0;
+
+    std::vector<std::string> tokenNames_;
+    std::unordered_map<std::string, TokenId> tokenIds_;
+};
@@ -0,0 +1,258 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "line_reader.h"
+#include "pool_batch.h"
+#include "result_sink.h"
+#include "stage_stats.h"
+#include "swap_batch.h"
+#include "tradelog.h"
+
+namespace {
+
+// Max swaps priced per PoolBatchPricer call.
+const size_t kBatchSize = 1024;
+
+// Stages swaps and prices them with PoolBatchPricer (one batch kernel
+// call per pool kind).
+// Swaps are sequential, so a batch only holds swaps on distinct pools:
+// staging a second swap on a pool already in the batch flushes first, and
+// the second swap then sees the reserves left by the first.
+class SwapBatcher {
+public:
+    SwapBatcher(PoolRegistry& reg, ResultSink* sink, LatencyHistogram* latency)
+            : reg_(reg), sink_(sink), latency_(latency), stamp_(reg.size(), 0), pricer_(kBatchSize),
+              ids_(kBatchSize), dirs_(kBatchSize), recordNos_(kBatchSize), amountIn_(kBatchSize),
+              amountOut_(kBatchSize), newReserveIn_(kBatchSize), newReserveOut_(kBatchSize),
+              effectivePrice_(kBatchSize), slippage_(kBatchSize), error_(kBatchSize) {}
+
+    // recordNo is only used in error messages ("line N" / "record N").
+    void stage(PoolId id, Direction dir, double amountIn, uint64_t recordNo) {
+        if (stamp_[id] == epoch_ || pending_ == kBatchSize) flush();
+        stamp_[id] = epoch_;
+        reg_.prefetch(id);   // the pricer's gather will need this line
+        ids_[pending_] = id;
+        dirs_[pending_] = dir;
+        amountIn_[pending_] = amountIn;
+        recordNos_[pending_] = recordNo;
+        ++pending_;
+    }
+
+    // Prices and applies staged swaps. Throws on the first rejected swap;
+    // swaps staged before it stay applied.
+    void flush() {
+        const size_t n = pending_;
+        const SwapBatchOutput out{amountOut_.data(), newReserveIn_.data(), newReserveOut_.data(),
+                                  effectivePrice_.data(), slippage_.data(), error_.data()};
+        const uint64_t priceStart = latency_ ? readTsc() : 0;
+        const size_t bad = pricer_.price(reg_, ids_.data(), dirs_.data(), amountIn_.data(), n, out);
+        if (latency_ && n != 0) {
+            // One sample per priced swap: its share of the batch's pricing time.
+            latency_->record((readTsc() - priceStart + n / 2) / n, n);
+        }
+
+        // Swaps before the first rejected one are committed and written.
+        size_t good = n;
+        {
+            ScopedStage timer(Stage::StateUpdate);
+            for (size_t i = 0; i < n; ++i) {
+                if (bad != 0 && error_[i] != 0) {
+                    good = i;
+                    break;
+                }
+                reg_.commitSwap(ids_[i], dirs_[i], amountIn_[i], newReserveA(i), newReserveB(i));
+            }
+            timer.addItems(good);
+        }
+        if (sink_) {
+            ScopedStage timer(Stage::Output, good);
+            for (size_t i = 0; i < good; ++i) {
+                const SwapResult r{amountOut_[i], newReserveA(i), newReserveB(i), effectivePrice_[i], slippage_[i]};
+                sink_->row(recordNos_[i], dirs_[i], amountIn_[i], r);
+            }
+        }
+
+        applied_ += good;
+        pending_ = 0;
+        nextEpoch();
+        if (good < n) {
+            throw std::runtime_error(std::string(recordLabel_) + " " + std::to_string(recordNos_[good]) +
+                                     ": " + swapErrorMessage(error_[good]));
+        }
+    }
+
+    // For an error raised while staging (bad line, unknown pool): applies
+    // the swaps staged before it, so they stay applied as with a rejected
+    // swap. A rejection among them is the earlier error and replaces the
+    // one being handled.
+    void flushBeforeError() {
+        if (pending_ != 0) flush();
+    }
+
+    uint64_t applied() const { return applied_; }
+    void setRecordLabel(const char* label) { recordLabel_ = label; }
+
+private:
+    double newReserveA(size_t i) const {
+        return dirs_[i] == Direction::A2B ? newReserveIn_[i] : newReserveOut_[i];
+    }
+    double newReserveB(size_t i) const {
+        return dirs_[i] == Direction::A2B ? newReserveOut_[i] : newReserveIn_[i];
+    }
+
+    void nextEpoch() {
+        if (++epoch_ == 0) {   // wrapped: old stamps could collide, reset them
+            std::fill(stamp_.begin(), stamp_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    PoolRegistry& reg_;
+    ResultSink* sink_;
+    LatencyHistogram* latency_;
+    std::vector<uint32_t> stamp_;   // per pool: epoch of the batch it is in
+    uint32_t epoch_ = 1;
+    PoolBatchPricer pricer_;
+    size_t pending_ = 0;
+    uint64_t applied_ = 0;
+    const char* recordLabel_ = "line";
+
+    std::vector<PoolId> ids_;
+    std::vector<Direction> dirs_;
+    std::vector<uint64_t> recordNos_;
+    std::vector<double> amountIn_;
+    std::vector<double> amountOut_, newReserveIn_, newReserveOut_, effectivePrice_, slippage_;
+    std::vector<uint8_t> error_;
+};
+
+} // namespace
+
+void loadPools(PoolRegistry& reg, const std::string& path) {
+    std::FILE* f = openInput(path);
+    FileCloser closer{f};
+    ScopedStage timer(Stage::Parse);
+
+    timer.addItems(forEachLine(f, [&](LineCursor& c, uint64_t lineNo) {
+        if (c.atEnd()) return;
+        std::string tokenA, tokenB, kindName;
+        double reserveA = 0.0, reserveB = 0.0, fee = 0.0, curveParam = 0.0;
+        if (!c.parseName(tokenA) || !c.parseName(tokenB) || !c.parseDouble(reserveA) ||
+            !c.parseDouble(reserveB) || !c.parseDouble(fee) ||
+            (!c.atEnd() && (!c.parseName(kindName) || !c.parseDouble(curveParam))) || !c.atEnd()) {
+            lineError(lineNo, "expected tokenA,tokenB,reserveA,reserveB,fee[,stable|weighted,param]");
+        }
+        PoolKind kind = PoolKind::ConstantProduct;
+        if (!kindName.empty()) {
+            size_t k = 1;   // x*y=k is the default, not a suffix
+            while (k < kPoolKinds && kindName != poolKindName((PoolKind)k)) ++k;
+            if (k == kPoolKinds) {
+                lineError(lineNo, "unknown pool kind '" + kindName + "' (expected " +
+                                  poolKindName(PoolKind::Stable) + " or " + poolKindName(PoolKind::Weighted) + ")");
+            }
+            kind = (PoolKind)k;
+        }
+        try {
+            reg.addPool(reg.internToken(tokenA), reg.internToken(tokenB), reserveA, reserveB, fee, kind, curveParam);
+        } catch (const std::exception& e) {
+            lineError(lineNo, e.what());
+        }
+    }));
+}
+
+ReplayStats replayTradeLog(PoolRegistry& reg, std::FILE* in, ResultSink* sink, LatencyHistogram* latency) {
+    SwapBatcher batcher(reg, sink, latency);
+    ReplayStats stats;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    ScopedStage timer(Stage::Parse);
+    try {
+        stats.lines = forEachLine(in, [&](LineCursor& c, uint64_t lineNo) {
+            uint64_t id = 0, timestamp = 0;
+            Direction dir = Direction::A2B;
+            double amountIn = 0.0;
+            if (!parseTradeLine(c, lineNo, id, dir, amountIn, timestamp)) return;
+            if (id >= reg.size()) lineError(lineNo, "unknown pool id " + std::to_string(id));
+            batcher.stage((PoolId)id, dir, amountIn, lineNo);
+        });
+    } catch (...) {
+        batcher.flushBeforeError();
+        throw;
+    }
+    timer.addItems(stats.lines);
+    batcher.flush();
+    stats.swaps = batcher.applied();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
+
+ReplayStats replayTradeLog(PoolRegistry& reg, const TradeLogView& log, ResultSink* sink,
+                           LatencyHistogram* latency) {
+    SwapBatcher batcher(reg, sink, latency);
+    batcher.setRecordLabel("record");
+    ReplayStats stats;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    uint64_t recordNo = 0;
+    ScopedStage timer(Stage::Parse, log.size());
+    try {
+        for (const TradeRecord& r : log) {
+            ++recordNo;
+            if (r.poolId >= reg.size()) {
+                throw std::runtime_error("record " + std::to_string(recordNo) + ": unknown pool id " +
+                                         std::to_string(r.poolId));
+            }
+            if (r.direction > 1) throw std::runtime_error("record " + std::to_string(recordNo) + ": bad direction");
+            batcher.stage(r.poolId, r.direction == 0 ? Direction::A2B : Direction::B2A, r.amountIn, recordNo);
+        }
+    } catch (...) {
+        batcher.flushBeforeError();
+        throw;
+    }
+    batcher.flush();
+    stats.lines = recordNo;
+    stats.swaps = batcher.applied();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
+
+ReplayStats replaySwaps(PoolRegistry& reg, const PoolId* ids, const Direction* dirs, const double* amountIn,
+                        size_t n, ResultSink* sink, LatencyHistogram* latency) {
+    SwapBatcher batcher(reg, sink, latency);
+    batcher.setRecordLabel("swap");
+    ReplayStats stats;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    try {
+        for (size_t i = 0; i < n; ++i) {
+            if (ids[i] >= reg.size()) {
+                throw std::runtime_error("swap " + std::to_string(i + 1) + ": unknown pool id " +
+                                         std::to_string(ids[i]));
+            }
+            batcher.stage(ids[i], dirs[i], amountIn[i], i + 1);
+        }
+    } catch (...) {
+        batcher.flushBeforeError();
+        throw;
+    }
+    batcher.flush();
+    stats.lines = n;
+    stats.swaps = batcher.applied();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
+
+ReplayStats replayTradeLog(PoolRegistry& reg, const std::string& path, ResultSink* sink,
+                           LatencyHistogram* latency) {
+    if (isBinaryTradeLog(path)) {
+        const TradeLogView log(path);
+        return replayTradeLog(reg, log, sink, latency);
+    }
+    std::FILE* f = openInput(path);
+    FileCloser closer{f};
+    return replayTradeLog(reg, f, sink, latency);
+}
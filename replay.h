@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "pool_registry.h"
+
+class LatencyHistogram;
+class ResultSink;
+class TradeLogView;
+
+// Summary of one replay run.
+struct ReplayStats {
+    uint64_t lines = 0;     // lines read, including blank/comment lines
+    uint64_t swaps = 0;     // swaps applied
+    double seconds = 0.0;   // wall time spent in the replay loop
+};
+
+// Pools file: one pool per line, ids assigned in file order (0, 1, ...):
+//   tokenA,tokenB,reserveA,reserveB,fee[,kind,param]
+// kind is "stable" (param = amplification) or "weighted" (param = weight
+// of tokenA); without it the pool is constant-product.
+// Fields may be separated by commas and/or whitespace; '#' starts a comment.
+void loadPools(PoolRegistry& reg, const std::string& path);
+
+// Streams a text trade log through the registry, carrying reserves forward:
+//   poolId,direction,amountIn[,timestamp]      e.g. "3,A2B,125.5"
+// Same separators/comments as the pools file. Input is read in fixed-size
+// blocks, so memory use does not depend on the log size.
+// Swaps are priced in batches with PoolBatchPricer, one batch kernel call
+// per pool kind; a batch never holds two swaps on the same pool, so
+// results equal one-by-one PoolRegistry::applySwap.
+// Throws with the line number on a malformed line or a rejected swap;
+// swaps before it stay applied.
+// If sink is set, every applied swap is written to it, labelled by line number.
+// If latency is set, each priced swap's quote latency is recorded into it:
+// the TSC ticks PoolBatchPricer::price took for its batch, divided by the
+// swaps in that batch. Parsing, waiting for the batch to fill, commit and
+// output are not included.
+ReplayStats replayTradeLog(PoolRegistry& reg, std::FILE* in, ResultSink* sink = nullptr,
+                           LatencyHistogram* latency = nullptr);
+
+// Same for a memory-mapped binary trade log (see tradelog.h); records are
+// read straight from the mapping. Errors name the record number (from 1).
+ReplayStats replayTradeLog(PoolRegistry& reg, const TradeLogView& log, ResultSink* sink = nullptr,
+                           LatencyHistogram* latency = nullptr);
+
+// Same for swaps already in memory. Errors name the swap number (from 1).
+ReplayStats replaySwaps(PoolRegistry& reg, const PoolId* ids, const Direction* dirs, const double* amountIn,
+                        size_t n, ResultSink* sink = nullptr, LatencyHistogram* latency = nullptr);
+
+// Replays path: binary if it starts with the trade-log magic, text
+// otherwise ("-" means stdin).
+ReplayStats replayTradeLog(PoolRegistry& reg, const std::string& path, ResultSink* sink = nullptr,
+                           LatencyHistogram* latency = nullptr);
@@ -0,0 +1,223 @@
+#include "result_sink.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#include "stage_stats.h"
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#define AMM_WRITE _write
+#define AMM_CLOSE _close
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#define AMM_WRITE ::write
+#define AMM_CLOSE ::close
+#endif
+
+namespace {
+
+// Longest text any single row can produce (label is capped separately).
+const size_t kMaxRowText = 512;
+const size_t kMaxLabel = 128;
+
+char* putText(char* p, std::string_view s) {
+    std::memcpy(p, s.data(), s.size());
+    return p + s.size();
+}
+
+// Shortest text that parses back to the same double.
+char* putShortest(char* p, double v) {
+#if defined(__cpp_lib_to_chars)
+    return std::to_chars(p, p + 32, v).ptr;
+#else
+    return p + std::snprintf(p, 32, "%.17g", v);
+#endif
+}
+
+// Fixed notation with `precision` decimals (same digits as printf "%.*f").
+// Values too large for a sane fixed field fall back to shortest form.
+char* putFixed(char* p, double v, int precision) {
+    const size_t kMaxFixed = 48;
+#if defined(__cpp_lib_to_chars)
+    const std::to_chars_result r = std::to_chars(p, p + kMaxFixed, v, std::chars_format::fixed, precision);
+    if (r.ec == std::errc()) return r.ptr;
+#else
+    const int n = std::snprintf(p, kMaxFixed, "%.*f", precision, v);
+    if (n > 0 && (size_t)n < kMaxFixed) return p + n;
+#endif
+    return putShortest(p, v);
+}
+
+char* putUint(char* p, uint64_t v) {
+    return std::to_chars(p, p + 20, v).ptr;
+}
+
+// Writes [begin, end) right-aligned in a field of `width`, like std::setw + std::right.
+char* alignRight(char* fieldStart, char* end, size_t width) {
+    const size_t len = (size_t)(end - fieldStart);
+    if (len >= width) return end;
+    const size_t pad = width - len;
+    std::memmove(fieldStart + pad, fieldStart, len);
+    std::memset(fieldStart, ' ', pad);
+    return fieldStart + width;
+}
+
+char* padLeftAligned(char* fieldStart, char* end, size_t width) {
+    const size_t len = (size_t)(end - fieldStart);
+    if (len >= width) return end;
+    std::memset(end, ' ', width - len);
+    return fieldStart + width;
+}
+
+// Minimal JSON string escaping (labels are short identifiers or numbers).
+char* putJsonString(char* p, std::string_view s) {
+    *p++ = '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') *p++ = '\\';
+        if ((unsigned char)c < 0x20) c = ' ';
+        *p++ = c;
+    }
+    *p++ = '"';
+    return p;
+}
+
+} // namespace
+
+OutputFormat parseOutputFormat(const std::string& name) {
+    if (name == "table") return OutputFormat::Table;
+    if (name == "csv") return OutputFormat::Csv;
+    if (name == "jsonl") return OutputFormat::Jsonl;
+    if (name == "binary") return OutputFormat::Binary;
+    throw std::runtime_error("format must be table, csv, jsonl or binary");
+}
+
+ResultSink::ResultSink(const std::string& path, OutputFormat format, size_t bufferSize)
+        : format_(format), buf_(bufferSize < 4 * kMaxRowText ? 4 * kMaxRowText : bufferSize) {
+    if (path.empty() || path == "-") {
+        fd_ = 1;
+#if defined(_WIN32)
+        _setmode(fd_, _O_BINARY);
+#endif
+        return;
+    }
+#if defined(_WIN32)
+    fd_ = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    require(fd_ >= 0, "cannot create " + path);
+    ownsFd_ = true;
+}
+
+ResultSink::~ResultSink() {
+    try {
+        flush();
+    } catch (...) {
+    }
+    if (ownsFd_) AMM_CLOSE(fd_);
+}
+
+void ResultSink::flush() {
+    ScopedStage timer(Stage::Output);
+    addStat(StatCounter::BytesWritten, used_);
+    size_t off = 0;
+    while (off < used_) {
+        const auto n = AMM_WRITE(fd_, buf_.data() + off, (unsigned)(used_ - off));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            used_ = 0;
+            throw std::runtime_error("write error on result output");
+        }
+        off += (size_t)n;
+    }
+    used_ = 0;
+}
+
+char* ResultSink::reserve(size_t n) {
+    if (buf_.size() - used_ < n) flush();
+    return buf_.data() + used_;
+}
+
+void ResultSink::header() {
+    char* p = reserve(kMaxRowText);
+    char* f;
+    switch (format_) {
+        case OutputFormat::Table:
+            // Same columns as the original iostream table.
+            f = p; p = padLeftAligned(f, putText(f, "Scenario"), 10);
+            f = p; p = padLeftAligned(f, putText(f, "Dir"), 6);
+            f = p; p = alignRight(f, putText(f, "amountIn"), 12);
+            f = p; p = alignRight(f, putText(f, "amountOut"), 14);
+            f = p; p = alignRight(f, putText(f, "newResA"), 14);
+            f = p; p = alignRight(f, putText(f, "newResB"), 14);
+            f = p; p = alignRight(f, putText(f, "effPrice"), 16);
+            f = p; p = alignRight(f, putText(f, "slip(%)"), 14);
+            *p++ = '\n';
+            std::memset(p, '-', 100);
+            p += 100;
+            *p++ = '\n';
+            break;
+        case OutputFormat::Csv:
+            p = putText(p, "label,direction,amountIn,amountOut,newReserveA,newReserveB,effectivePrice,slippagePercent\n");
+            break;
+        default:
+            break;
+    }
+    commit(p);
+}
+
+void ResultSink::row(std::string_view label, Direction dir, double amountIn, const SwapResult& r) {
+    if (label.size() > kMaxLabel) label = label.substr(0, kMaxLabel);
+    char* p = reserve(kMaxRowText + 2 * kMaxLabel);
+    char* f;
+    switch (format_) {
+        case OutputFormat::Table:
+            f = p; p = padLeftAligned(f, putText(f, label), 10);
+            f = p; p = padLeftAligned(f, putText(f, directionName(dir)), 6);
+            f = p; p = alignRight(f, putFixed(f, amountIn, 6), 12);
+            f = p; p = alignRight(f, putFixed(f, r.amountOut, 6), 14);
+            f = p; p = alignRight(f, putFixed(f, r.newReserveA, 6), 14);
+            f = p; p = alignRight(f, putFixed(f, r.newReserveB, 6), 14);
+            f = p; p = alignRight(f, putFixed(f, r.effectivePrice, 8), 16);
+            f = p; p = alignRight(f, putFixed(f, r.slippagePercent, 6), 14);
+            *p++ = '\n';
+            break;
+        case OutputFormat::Csv:
+            p = putText(p, label); *p++ = ',';
+            p = putText(p, directionName(dir)); *p++ = ',';
+            p = putShortest(p, amountIn); *p++ = ',';
+            p = putShortest(p, r.amountOut); *p++ = ',';
+            p = putShortest(p, r.newReserveA); *p++ = ',';
+            p = putShortest(p, r.newReserveB); *p++ = ',';
+            p = putShortest(p, r.effectivePrice); *p++ = ',';
+            p = putShortest(p, r.slippagePercent); *p++ = '\n';
+            break;
+        case OutputFormat::Jsonl:
+            p = putText(p, "{\"label\":"); p = putJsonString(p, label);
+            p = putText(p, ",\"direction\":\""); p = putText(p, directionName(dir));
+            p = putText(p, "\",\"amountIn\":"); p = putShortest(p, amountIn);
+            p = putText(p, ",\"amountOut\":"); p = putShortest(p, r.amountOut);
+            p = putText(p, ",\"newReserveA\":"); p = putShortest(p, r.newReserveA);
+            p = putText(p, ",\"newReserveB\":"); p = putShortest(p, r.newReserveB);
+            p = putText(p, ",\"effectivePrice\":"); p = putShortest(p, r.effectivePrice);
+            p = putText(p, ",\"slippagePercent\":"); p = putShortest(p, r.slippagePercent);
+            p = putText(p, "}\n");
+            break;
+        case OutputFormat::Binary:
+            std::memcpy(p, &r, sizeof(r));
+            p += sizeof(r);
+            break;
+    }
+    commit(p);
+}
+
+void ResultSink::row(uint64_t label, Direction dir, double amountIn, const SwapResult& r) {
+    char buf[24];
+    char* end = putUint(buf, label);
+    row(std::string_view(buf, (size_t)(end - buf)), dir, amountIn, r);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "amm.h"
+
+enum class OutputFormat {
+    Table,    // fixed-width columns, same layout as the demo table
+    Csv,      // header line + one row per swap, shortest round-trip numbers
+    Jsonl,    // one JSON object per line
+    Binary,   // raw SwapResult structs, native layout, no header
+};
+
+// "table", "csv", "jsonl" or "binary" (throws otherwise).
+OutputFormat parseOutputFormat(const std::string& name);
+
+// Formats swap results into a large reusable buffer and hands it to the
+// OS with one write() per flush, instead of a stream insertion per field.
+class ResultSink {
+public:
+    // Writes to path, or to stdout for "" / "-".
+    ResultSink(const std::string& path, OutputFormat format, size_t bufferSize = 1 << 20);
+    ~ResultSink();   // flushes; errors are swallowed here, call flush() to see them
+    ResultSink(const ResultSink&) = delete;
+    ResultSink& operator=(const ResultSink&) = delete;
+
+    OutputFormat format() const { return format_; }
+
+    // Column header (table, CSV); no-op for JSONL and binary.
+    void header();
+
+    void row(std::string_view label, Direction dir, double amountIn, const SwapResult& r);
+
+    // Same, labelled by a record/line number without building a string.
+    void row(uint64_t label, Direction dir, double amountIn, const SwapResult& r);
+
+    // Writes out everything buffered so far.
+    void flush();
+
+private:
+    // Grows the write position by up to n bytes, flushing first if needed.
+    char* reserve(size_t n);
+    void commit(char* end) { used_ = (size_t)(end - buf_.data()); }
+
+    OutputFormat format_;
+    std::vector<char> buf_;
+    size_t used_ = 0;
+    int fd_ = -1;
+    bool ownsFd_ = false;
+};
@@ -0,0 +1,230 @@
+#include "rng.h"
+
+#include <algorithm>
+
+#include "amount_out_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RNG_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Draws per transform pass; the word/uniform buffers live on the stack.
+const size_t kChunk = 512;
+
+void philoxBlocksScalar(uint32_t k0, uint32_t k1, uint32_t s0, uint32_t s1, uint64_t first,
+                        uint32_t* out, size_t begin, size_t blocks) {
+    for (size_t b = begin; b < blocks; ++b) {
+        const uint64_t c = first + b;
+        const Philox4x32 r = Philox4x32::block((uint32_t)c, (uint32_t)(c >> 32), s0, s1, k0, k1);
+        std::copy(r.v, r.v + 4, out + 4 * b);
+    }
+}
+
+#ifdef RNG_X86_DISPATCH
+
+// One block per 64-bit lane, each word kept in the low half: vpmuludq then
+// gives the full 32x32 -> 64 product of a round directly.
+__attribute__((target("avx2")))
+void philoxBlocksAvx2(uint32_t k0, uint32_t k1, uint32_t s0, uint32_t s1, uint64_t first,
+                      uint32_t* out, size_t blocks) {
+    const __m256i m0 = _mm256_set1_epi64x(0xD2511F53), m1 = _mm256_set1_epi64x(0xCD9E8D57);
+    const __m256i low = _mm256_set1_epi64x(0xffffffff);
+    const __m256i lane = _mm256_set_epi64x(3, 2, 1, 0);
+    size_t b = 0;
+    for (; b + 4 <= blocks; b += 4) {
+        const __m256i ctr = _mm256_add_epi64(_mm256_set1_epi64x((long long)(first + b)), lane);
+        __m256i c0 = _mm256_and_si256(ctr, low), c1 = _mm256_srli_epi64(ctr, 32);
+        __m256i c2 = _mm256_set1_epi64x(s0), c3 = _mm256_set1_epi64x(s1);
+        uint32_t ka = k0, kb = k1;
+        for (int round = 0; round < 10; ++round) {
+            const __m256i p0 = _mm256_mul_epu32(c0, m0);
+            const __m256i p1 = _mm256_mul_epu32(c2, m1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), _mm256_set1_epi64x(ka));
+            c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), _mm256_set1_epi64x(kb));
+            c1 = _mm256_and_si256(p1, low);
+            c3 = _mm256_and_si256(p0, low);
+            ka += 0x9E3779B9u;
+            kb += 0xBB67AE85u;
+        }
+        // Lane j -> words (v0 | v1 << 32, v2 | v3 << 32), then blocks back in order.
+        const __m256i w01 = _mm256_or_si256(c0, _mm256_slli_epi64(c1, 32));
+        const __m256i w23 = _mm256_or_si256(c2, _mm256_slli_epi64(c3, 32));
+        const __m256i even = _mm256_unpacklo_epi64(w01, w23);   // blocks 0, 2
+        const __m256i odd = _mm256_unpackhi_epi64(w01, w23);    // blocks 1, 3
+        _mm256_storeu_si256((__m256i*)(out + 4 * b), _mm256_permute2x128_si256(even, odd, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + 4 * b + 8), _mm256_permute2x128_si256(even, odd, 0x31));
+    }
+    philoxBlocksScalar(k0, k1, s0, s1, first, out, b, blocks);
+}
+
+__attribute__((target("avx512f")))
+void philoxBlocksAvx512(uint32_t k0, uint32_t k1, uint32_t s0, uint32_t s1, uint64_t first,
+                        uint32_t* out, size_t blocks) {
+    const __m512i m0 = _mm512_set1_epi64(0xD2511F53), m1 = _mm512_set1_epi64(0xCD9E8D57);
+    const __m512i low = _mm512_set1_epi64(0xffffffff);
+    const __m512i lane = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512i firstHalf = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+    const __m512i secondHalf = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+    size_t b = 0;
+    for (; b + 8 <= blocks; b += 8) {
+        const __m512i ctr = _mm512_add_epi64(_mm512_set1_epi64((long long)(first + b)), lane);
+        __m512i c0 = _mm512_and_si512(ctr, low), c1 = _mm512_srli_epi64(ctr, 32);
+        __m512i c2 = _mm512_set1_epi64(s0), c3 = _mm512_set1_epi64(s1);
+        uint32_t ka = k0, kb = k1;
+        for (int round = 0; round < 10; ++round) {
+            const __m512i p0 = _mm512_mul_epu32(c0, m0);
+            const __m512i p1 = _mm512_mul_epu32(c2, m1);
+            c0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p1, 32), c1), _mm512_set1_epi64(ka));
+            c2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p0, 32), c3), _mm512_set1_epi64(kb));
+            c1 = _mm512_and_si512(p1, low);
+            c3 = _mm512_and_si512(p0, low);
+            ka += 0x9E3779B9u;
+            kb += 0xBB67AE85u;
+        }
+        const __m512i w01 = _mm512_or_si512(c0, _mm512_slli_epi64(c1, 32));
+        const __m512i w23 = _mm512_or_si512(c2, _mm512_slli_epi64(c3, 32));
+        _mm512_storeu_si512(out + 4 * b, _mm512_permutex2var_epi64(w01, firstHalf, w23));
+        _mm512_storeu_si512(out + 4 * b + 16, _mm512_permutex2var_epi64(w01, secondHalf, w23));
+    }
+    philoxBlocksScalar(k0, k1, s0, s1, first, out, b, blocks);
+}
+
+#endif // RNG_X86_DISPATCH
+
+// log(k!) without lgamma, which writes the global signgam (a data race
+// when paths run on several threads). Stirling's series is good to ~1e-12
+// from k = 16; below that a table.
+double logFactorial(uint32_t k) {
+    static const double table[16] = {
+        0.0, 0.0, 0.69314718055994531, 1.791759469228055, 3.1780538303479458,
+        4.7874917427820458, 6.5792512120101012, 8.5251613610654147, 10.604602902745251,
+        12.801827480081469, 15.104412573075516, 17.502307845873887, 19.987214495661885,
+        22.552163853123425, 25.19122118273868, 27.89927138384089};
+    if (k < 16) return table[k];
+    const double n = (double)k, inv = 1.0 / n, inv2 = inv * inv;
+    return n * std::log(n) - n + 0.5 * std::log(6.283185307179586 * n) +
+           inv * (1.0 / 12.0 - inv2 * (1.0 / 360.0 - inv2 * (1.0 / 1260.0)));
+}
+
+} // namespace
+
+void philoxBlocks(uint64_t seed, uint64_t stream, uint64_t firstBlock, uint32_t* out, size_t blocks) {
+    const uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    const uint32_t s0 = (uint32_t)stream, s1 = (uint32_t)(stream >> 32);
+    switch (activeSimdLevel()) {
+#ifdef RNG_X86_DISPATCH
+        case SimdLevel::Avx512:
+            philoxBlocksAvx512(k0, k1, s0, s1, firstBlock, out, blocks);
+            return;
+        case SimdLevel::Avx2:
+            philoxBlocksAvx2(k0, k1, s0, s1, firstBlock, out, blocks);
+            return;
+#endif
+        default:
+            philoxBlocksScalar(k0, k1, s0, s1, firstBlock, out, 0, blocks);
+            return;
+    }
+}
+
+uint32_t PhiloxStream::nextPoisson(double lambda) {
+    if (!(lambda > 0.0)) return 0;
+
+    if (lambda < 10.0) {
+        const double u = nextDouble();
+        double p = std::exp(-lambda), cdf = p;
+        uint32_t k = 0;
+        while (u >= cdf) {
+            ++k;
+            p *= lambda / (double)k;
+            const double next = cdf + p;
+            if (next == cdf) break;   // tail below rounding
+            cdf = next;
+        }
+        return k;
+    }
+
+    // W. Hormann, "The transformed rejection method for generating Poisson
+    // random variables" (1993), algorithm PTRS.
+    const double slam = std::sqrt(lambda), logLambda = std::log(lambda);
+    const double b = 0.931 + 2.53 * slam;
+    const double a = -0.059 + 0.02483 * b;
+    const double invAlpha = 1.1239 + 1.1328 / (b - 3.4);
+    const double vr = 0.9277 - 3.6224 / (b - 2.0);
+    for (;;) {
+        const double u = nextDouble() - 0.5;
+        const double v = nextDouble();
+        const double us = 0.5 - std::fabs(u);
+        const double k = std::floor((2.0 * a / us + b) * u + lambda + 0.43);
+        if (us >= 0.07 && v <= vr) return (uint32_t)k;
+        if (k < 0.0 || (us < 0.013 && v > us)) continue;
+        if (std::log(v) + std::log(invAlpha) - std::log(a / (us * us) + b) <=
+            -lambda + k * logLambda - logFactorial((uint32_t)k)) {
+            return (uint32_t)k;
+        }
+    }
+}
+
+void PhiloxStream::fillU32(uint32_t* out, size_t n) {
+    size_t i = 0;
+    while (i < n && used_ != 4) out[i++] = buf_.v[used_++];
+    const size_t blocks = (n - i) / 4;
+    if (blocks > 0) {
+        philoxBlocks(seed_, stream_, block_, out + i, blocks);
+        block_ += blocks;
+        i += 4 * blocks;
+    }
+    while (i < n) out[i++] = nextU32();
+}
+
+void PhiloxStream::fillUniform(double* out, size_t n) {
+    uint32_t words[2 * kChunk];
+    for (size_t i = 0; i < n; i += kChunk) {
+        const size_t m = std::min(kChunk, n - i);
+        fillU32(words, 2 * m);
+        for (size_t j = 0; j < m; ++j) out[i + j] = toDouble(words[2 * j], words[2 * j + 1]);
+    }
+}
+
+void PhiloxStream::fillNormal(double* out, size_t n) {
+    size_t i = 0;
+    if (n > 0 && hasSpare_) {
+        out[i++] = spare_;
+        hasSpare_ = false;
+    }
+    double u[kChunk];
+    while (n - i >= 2) {
+        const size_t pairs = std::min((n - i) / 2, kChunk / 2);
+        fillUniform(u, 2 * pairs);
+        for (size_t j = 0; j < pairs; ++j) {
+            out[i + 2 * j] = boxMuller(u[2 * j], u[2 * j + 1], out[i + 2 * j + 1]);
+        }
+        i += 2 * pairs;
+    }
+    if (i < n) out[i] = nextNormal();
+}
+
+void PhiloxStream::fillLogNormal(double* out, size_t n, double mu, double sigma) {
+    fillNormal(out, n);
+    for (size_t i = 0; i < n; ++i) out[i] = std::exp(mu + sigma * out[i]);
+}
+
+void PhiloxStream::fillBernoulli(uint8_t* out, size_t n, double p) {
+    double u[kChunk];
+    for (size_t i = 0; i < n; i += kChunk) {
+        const size_t m = std::min(kChunk, n - i);
+        fillUniform(u, m);
+        for (size_t j = 0; j < m; ++j) out[i + j] = u[j] < p ? 1 : 0;
+    }
+}
+
+void PhiloxStream::fillExponential(double* out, size_t n, double rate) {
+    fillUniform(out, n);
+    for (size_t i = 0; i < n; ++i) out[i] = -std::log(1.0 - out[i]) / rate;
+}
+
+void PhiloxStream::fillPoisson(uint32_t* out, size_t n, double lambda) {
+    for (size_t i = 0; i < n; ++i) out[i] = nextPoisson(lambda);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+// 1, 2, 3", SC'11): a keyed bijection of a 128-bit counter. Output i of a
+// stream is a pure function of (key, counter), so any path can be generated
+// on any thread, in any order, with the same result.
+struct Philox4x32 {
+    uint32_t v[4];
+
+    static Philox4x32 block(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t k0, uint32_t k1) {
+        for (int round = 0; round < 10; ++round) {
+            const uint64_t p0 = (uint64_t)0xD2511F53u * c0;
+            const uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+            const uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+            const uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+            c1 = (uint32_t)p1;
+            c3 = (uint32_t)p0;
+            c0 = n0;
+            c2 = n2;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        return Philox4x32{{c0, c1, c2, c3}};
+    }
+};
+
+// Blocks [firstBlock, firstBlock + blocks) of stream `stream` under key
+// `seed`, 4 words per block in counter order. Vectorized across blocks at
+// activeSimdLevel() (8 blocks per AVX-512 step, 4 per AVX2); every level
+// writes the same words.
+void philoxBlocks(uint64_t seed, uint64_t stream, uint64_t firstBlock, uint32_t* out, size_t blocks);
+
+// Sequential draws from stream `stream` of key `seed`: block n is
+// Philox(counter = {n, stream}, key = seed). Streams never overlap, so
+// (seed, path id) gives every simulation path its own sequence.
+//
+// The fill* calls produce exactly what the same number of next* calls
+// would (and leave the stream in the same state), just faster: words come
+// from philoxBlocks and the transforms run over arrays.
+class PhiloxStream {
+public:
+    PhiloxStream(uint64_t seed, uint64_t stream) : seed_(seed), stream_(stream) {}
+
+    uint32_t nextU32() {
+        if (used_ == 4) refill();
+        return buf_.v[used_++];
+    }
+
+    // Uniform in [0, 1) with 53 random bits.
+    double nextDouble() {
+        const uint32_t hi = nextU32();
+        return toDouble(hi, nextU32());
+    }
+
+    // Standard normal (Box-Muller; the second value is kept for the next call).
+    double nextNormal() {
+        if (hasSpare_) {
+            hasSpare_ = false;
+            return spare_;
+        }
+        const double u1 = nextDouble();
+        const double u2 = nextDouble();
+        double z1;
+        const double z0 = boxMuller(u1, u2, z1);
+        spare_ = z1;
+        hasSpare_ = true;
+        return z0;
+    }
+
+    // exp(mu + sigma * N(0, 1)): median exp(mu).
+    double nextLogNormal(double mu, double sigma) { return std::exp(mu + sigma * nextNormal()); }
+
+    // true with probability p.
+    bool nextBernoulli(double p) { return nextDouble() < p; }
+
+    // Waiting time of a Poisson process with the given rate.
+    double nextExponential(double rate) { return -std::log(1.0 - nextDouble()) / rate; }
+
+    // Events in a unit interval at the given rate: inversion below rate 10
+    // (one uniform per draw), Hormann's PTRS rejection above.
+    uint32_t nextPoisson(double lambda);
+
+    void fillU32(uint32_t* out, size_t n);
+    void fillUniform(double* out, size_t n);
+    void fillNormal(double* out, size_t n);
+    void fillLogNormal(double* out, size_t n, double mu, double sigma);
+    void fillBernoulli(uint8_t* out, size_t n, double p);
+    void fillExponential(double* out, size_t n, double rate);
+    void fillPoisson(uint32_t* out, size_t n, double lambda);   // scalar loop (rejection)
+
+    static double toDouble(uint32_t hi, uint32_t lo) {
+        return (double)(((uint64_t)(hi >> 5) << 26) | (lo >> 6)) * (1.0 / 9007199254740992.0);
+    }
+
+    // u1, u2 uniform in [0, 1); returns one normal and writes the other.
+    static double boxMuller(double u1, double u2, double& second) {
+        const double r = std::sqrt(-2.0 * std::log(1.0 - u1));   // 1 - u1 in (0, 1]
+        const double t = 6.283185307179586 * u2;
+        second = r * std::sin(t);
+        return r * std::cos(t);
+    }
+
+private:
+    void refill() {
+        buf_ = Philox4x32::block((uint32_t)block_, (uint32_t)(block_ >> 32), (uint32_t)stream_,
+                                 (uint32_t)(stream_ >> 32), (uint32_t)seed_, (uint32_t)(seed_ >> 32));
+        ++block_;
+        used_ = 0;
+    }
+
+    uint64_t seed_, stream_;
+    uint64_t block_ = 0;
+    Philox4x32 buf_{};
+    unsigned used_ = 4;
+    double spare_ = 0.0;
+    bool hasSpare_ = false;
+};
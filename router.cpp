@@ -0,0 +1,292 @@
+#include "router.h"
+
+#include <algorithm>
+
+#include "latency_histogram.h"
+
+Router::Router(const PoolRegistry& reg) : reg_(reg) {
+    rebuild();
+}
+
+void Router::rebuild() {
+    graph_.build(reg_);
+    const size_t tokens = graph_.tokenCount();
+    const size_t pools = reg_.size();
+
+    // The label layout depends on the token count: drop all labels.
+    stamp_.clear();
+    amount_.clear();
+    viaEdge_.clear();
+    prevToken_.clear();
+    labelHops_ = 0;
+    epoch_ = 0;
+
+    nearTarget_.assign(tokens, 0);
+    banned_.assign(pools, 0);
+    banEpoch_ = 0;
+}
+
+void Router::updatePool(PoolId id) {
+    graph_.update(reg_, id);
+}
+
+bool Router::usesPool(unsigned hop, TokenId at, PoolId pool) const {
+    const size_t tokens = graph_.tokenCount();
+    for (unsigned h = hop; h > 0; --h) {
+        const size_t slot = h * tokens + at;
+        if (graph_.edges[viaEdge_[slot]].pool == pool) return true;
+        at = prevToken_[slot];
+    }
+    return false;
+}
+
+bool Router::search(TokenId tokenIn, TokenId tokenOut, double amountIn, unsigned maxHops,
+                    std::vector<uint32_t>& path) {
+    const size_t tokens = graph_.tokenCount();
+    if (maxHops > labelHops_) {
+        const size_t slots = (maxHops + 1) * tokens;
+        stamp_.assign(slots, 0);
+        amount_.resize(slots);
+        viaEdge_.resize(slots);
+        prevToken_.resize(slots);
+        labelHops_ = maxHops;
+        std::fill(nearTarget_.begin(), nearTarget_.end(), 0);
+        epoch_ = 0;
+    }
+    if (++epoch_ == 0) {
+        std::fill(stamp_.begin(), stamp_.end(), 0);
+        std::fill(nearTarget_.begin(), nearTarget_.end(), 0);
+        epoch_ = 1;
+    }
+
+    stamp_[tokenIn] = epoch_;
+    amount_[tokenIn] = amountIn;
+    prevToken_[tokenIn] = kNoToken;
+    frontier_.assign(1, tokenIn);
+
+    // Tokens one swap away from tokenOut: the only useful labels one hop
+    // before the hop limit.
+    for (uint32_t k = graph_.edgeBegin[tokenOut]; k < graph_.edgeBegin[tokenOut + 1]; ++k) {
+        nearTarget_[graph_.edges[k].tokenOut] = epoch_;
+    }
+
+    double best = 0.0;
+    unsigned bestHop = 0;
+    for (unsigned h = 1; h < maxHops && !frontier_.empty(); ++h) {
+        next_.clear();
+        const bool lastBeforeLimit = (h + 1 == maxHops);
+        const size_t prevBase = (h - 1) * tokens;
+        const size_t base = h * tokens;
+        for (const TokenId u : frontier_) {
+            const double x = amount_[prevBase + u];
+            for (uint32_t k = graph_.edgeBegin[u]; k < graph_.edgeBegin[u + 1]; ++k) {
+                const PoolGraph::Edge& e = graph_.edges[k];
+                const TokenId v = e.tokenOut;
+                if (v == tokenIn || banned_[e.pool] == banEpoch_) continue;
+                if (lastBeforeLimit && v != tokenOut && nearTarget_[v] != epoch_) continue;
+
+                const double out = PoolGraph::amountOut(e, x);
+                const size_t slot = base + v;
+                const bool live = (stamp_[slot] == epoch_);
+                if (live && out <= amount_[slot]) continue;   // dominated
+                if (h > 1 && usesPool(h - 1, u, e.pool)) continue;
+
+                if (!live) {
+                    stamp_[slot] = epoch_;
+                    if (v != tokenOut) next_.push_back(v);   // routes end at tokenOut
+                }
+                amount_[slot] = out;
+                viaEdge_[slot] = k;
+                prevToken_[slot] = u;
+            }
+        }
+
+        const size_t target = base + tokenOut;
+        if (stamp_[target] == epoch_ && amount_[target] > best) {
+            best = amount_[target];
+            bestHop = h;
+        }
+        frontier_.swap(next_);
+    }
+
+    // Last hop: only edges into tokenOut matter, so walk tokenOut's own
+    // edge list backwards instead of every edge of the frontier.
+    if (!frontier_.empty()) {
+        const unsigned h = maxHops;
+        const size_t prevBase = (h - 1) * tokens;
+        const size_t target = h * tokens + tokenOut;
+        for (uint32_t k = graph_.edgeBegin[tokenOut]; k < graph_.edgeBegin[tokenOut + 1]; ++k) {
+            const TokenId u = graph_.edges[k].tokenOut;
+            const PoolId pool = graph_.edges[k].pool;
+            if (stamp_[prevBase + u] != epoch_ || banned_[pool] == banEpoch_) continue;
+            if (h > 1 && usesPool(h - 1, u, pool)) continue;
+
+            const uint32_t in = graph_.reverse(k);
+            const double out = PoolGraph::amountOut(graph_.edges[in], amount_[prevBase + u]);
+            if (out > best) {
+                best = out;
+                bestHop = h;
+                stamp_[target] = epoch_;
+                amount_[target] = out;
+                viaEdge_[target] = in;
+                prevToken_[target] = u;
+            }
+        }
+    }
+    if (bestHop == 0) return false;
+
+    path.resize(bestHop);
+    TokenId t = tokenOut;
+    for (unsigned h = bestHop; h > 0; --h) {
+        const size_t slot = h * tokens + t;
+        path[h - 1] = viaEdge_[slot];
+        t = prevToken_[slot];
+    }
+    return true;
+}
+
+double Router::pathOut(const std::vector<uint32_t>& path, double amountIn) const {
+    double x = amountIn;
+    for (const uint32_t k : path) x = PoolGraph::amountOut(graph_.edges[k], x);
+    return x;
+}
+
+Route Router::priceEdges(const std::vector<uint32_t>& path, TokenId tokenIn, double amountIn) const {
+    std::vector<PoolId> pools;
+    pools.reserve(path.size());
+    for (const uint32_t k : path) pools.push_back(graph_.edges[k].pool);
+    return quotePath(pools, tokenIn, amountIn);
+}
+
+Route quotePath(const PoolRegistry& reg, const std::vector<PoolId>& pools, TokenId tokenIn, double amountIn) {
+    Route route;
+    route.amountIn = amountIn;
+    double x = amountIn;
+    TokenId t = tokenIn;
+    for (const PoolId id : pools) {
+        const Direction dir = reg.directionFor(id, t);
+        const Pool& p = reg.pool(id);
+
+        RouteHop hop;
+        hop.pool = id;
+        hop.tokenIn = t;
+        hop.tokenOut = (dir == Direction::A2B) ? p.tokenB : p.tokenA;
+        hop.direction = dir;
+        hop.amountIn = x;
+        hop.result = reg.quoteSwap(id, dir, x);
+        route.hops.push_back(hop);
+
+        x = hop.result.amountOut;
+        t = hop.tokenOut;
+    }
+    route.amountOut = x;
+    return route;
+}
+
+static void checkQuery(const PoolRegistry& reg, TokenId tokenIn, TokenId tokenOut, double amountIn,
+                       unsigned maxHops) {
+    require(tokenIn < reg.tokenCount() && tokenOut < reg.tokenCount(), "unknown token");
+    require(tokenIn != tokenOut, "tokenIn and tokenOut must differ");
+    require(amountIn > 0.0, "amountIn must be > 0");
+    require(maxHops >= 1, "maxHops must be >= 1");
+}
+
+Route Router::bestRoute(TokenId tokenIn, TokenId tokenOut, double amountIn, unsigned maxHops) {
+    const ScopedLatency timer(latency_);
+    checkQuery(reg_, tokenIn, tokenOut, amountIn, maxHops);
+    require(graph_.edgeBegin.size() == reg_.tokenCount() + 1, "registry changed: rebuild the router");
+
+    // A fresh ban epoch excludes nothing.
+    if (++banEpoch_ == 0) {
+        std::fill(banned_.begin(), banned_.end(), 0);
+        banEpoch_ = 1;
+    }
+
+    std::vector<uint32_t> path;
+    if (!search(tokenIn, tokenOut, amountIn, maxHops, path)) {
+        Route none;
+        none.amountIn = amountIn;
+        return none;
+    }
+    return priceEdges(path, tokenIn, amountIn);
+}
+
+SplitRoute Router::bestSplit(TokenId tokenIn, TokenId tokenOut, double amountIn, unsigned maxHops,
+                             unsigned maxRoutes, unsigned parts) {
+    const ScopedLatency timer(latency_);
+    checkQuery(reg_, tokenIn, tokenOut, amountIn, maxHops);
+    require(graph_.edgeBegin.size() == reg_.tokenCount() + 1, "registry changed: rebuild the router");
+    require(maxRoutes >= 1 && parts >= 1, "maxRoutes and parts must be >= 1");
+
+    SplitRoute split;
+    split.amountIn = amountIn;
+
+    if (++banEpoch_ == 0) {
+        std::fill(banned_.begin(), banned_.end(), 0);
+        banEpoch_ = 1;
+    }
+
+    std::vector<std::vector<uint32_t>> candidates;
+    std::vector<uint32_t> path;
+    while (candidates.size() < maxRoutes && search(tokenIn, tokenOut, amountIn, maxHops, path)) {
+        for (const uint32_t k : path) banned_[graph_.edges[k].pool] = banEpoch_;
+        candidates.push_back(path);
+    }
+    if (candidates.empty()) return split;
+
+    // Route outputs are concave in their input and the routes share no
+    // pool, so handing each slice to the best marginal route is greedy-optimal
+    // up to the slice size.
+    const size_t n = candidates.size();
+    const double slice = amountIn / parts;
+    std::vector<unsigned> count(n, 0);
+    std::vector<double> out(n, 0.0), gain(n);
+    for (size_t j = 0; j < n; ++j) gain[j] = pathOut(candidates[j], slice);
+    for (unsigned i = 0; i < parts; ++i) {
+        const size_t j = (size_t)(std::max_element(gain.begin(), gain.end()) - gain.begin());
+        ++count[j];
+        out[j] += gain[j];
+        gain[j] = pathOut(candidates[j], slice * (count[j] + 1)) - out[j];
+    }
+
+    for (size_t j = 0; j < n; ++j) {
+        if (count[j] == 0) continue;
+        const double share = (count[j] == parts) ? amountIn : amountIn * count[j] / parts;
+        split.routes.push_back(priceEdges(candidates[j], tokenIn, share));
+        split.amountOut += split.routes.back().amountOut;
+    }
+    return split;
+}
+
+RouteBook::WatchId RouteBook::watch(const std::vector<PoolId>& pools, TokenId tokenIn, double amountIn) {
+    Watched w;
+    w.pools = pools;
+    w.tokenIn = tokenIn;
+    w.amountIn = amountIn;
+    w.quote = quotePath(reg_, pools, tokenIn, amountIn);   // throws on a broken path
+
+    const WatchId id = deps_.add(pools);
+    if (id >= watched_.size()) watched_.resize((size_t)id + 1);
+    watched_[id] = std::move(w);
+    return id;
+}
+
+void RouteBook::unwatch(WatchId id) {
+    deps_.remove(id);
+    watched_[id] = Watched();
+}
+
+const Route& RouteBook::quote(WatchId id) const {
+    require(id < watched_.size() && !watched_[id].pools.empty(), "unknown watched route");
+    return watched_[id].quote;
+}
+
+size_t RouteBook::poolsChanged(const std::vector<PoolId>& changed) {
+    for (const PoolId id : changed) deps_.touch(id);
+    const std::vector<WatchId>& dirty = deps_.takeDirty();
+    for (const WatchId id : dirty) {
+        Watched& w = watched_[id];
+        w.quote = quotePath(reg_, w.pools, w.tokenIn, w.amountIn);
+    }
+    return dirty.size();
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dependency_index.h"
+#include "pool_graph.h"
+#include "pool_registry.h"
+
+class LatencyHistogram;
+
+// One swap of a route, priced against the registry's current reserves.
+struct RouteHop {
+    PoolId pool = kNoPool;
+    TokenId tokenIn = kNoToken;
+    TokenId tokenOut = kNoToken;
+    Direction direction = Direction::A2B;
+    double amountIn = 0.0;
+    SwapResult result{};
+};
+
+// A chain of swaps; empty hops means no route was found.
+struct Route {
+    std::vector<RouteHop> hops;
+    double amountIn = 0.0;
+    double amountOut = 0.0;
+};
+
+// amountIn spread over pool-disjoint routes.
+struct SplitRoute {
+    std::vector<Route> routes;
+    double amountIn = 0.0;
+    double amountOut = 0.0;
+};
+
+// Prices a given chain of pools starting from tokenIn with simulateSwap.
+Route quotePath(const PoolRegistry& reg, const std::vector<PoolId>& pools, TokenId tokenIn, double amountIn);
+
+// Best-route quoting over the PoolGraph of a registry (see pool_graph.h).
+//
+// The search is hop-layered: for every hop count h and token it keeps only
+// the largest amount reachable (getAmountOut is increasing in x, so any
+// smaller amount at the same (h, token) is dominated). A path never uses a
+// pool twice, so the stored reserves stay valid along it; it may pass
+// through a token twice via different pools, but never through tokenIn
+// and it stops at tokenOut. The per-(h, token) pruning makes this a
+// heuristic when the kept label already used the pool an extension needs;
+// it then settles for the next-best route. The hop before the limit only
+// keeps tokens with a pool to tokenOut, and the final hop scans tokenOut's
+// edges instead of the whole frontier. Returned hops are re-priced with
+// simulateSwap.
+//
+// Quoting reuses internal scratch space: one Router per thread.
+class Router {
+public:
+    explicit Router(const PoolRegistry& reg);
+
+    // Re-reads the graph after pools were added to the registry.
+    void rebuild();
+
+    // Re-reads one pool's reserves (e.g. after applySwap / setReserves).
+    void updatePool(PoolId id);
+
+    // Best route of 1..maxHops swaps; empty if tokenOut is unreachable.
+    Route bestRoute(TokenId tokenIn, TokenId tokenOut, double amountIn, unsigned maxHops = 3);
+
+    // Best split of amountIn over up to maxRoutes pool-disjoint routes.
+    // Candidates are found one at a time with earlier routes' pools
+    // excluded; amountIn is then handed out in `parts` equal slices, each
+    // to the route with the largest marginal output.
+    SplitRoute bestSplit(TokenId tokenIn, TokenId tokenOut, double amountIn, unsigned maxHops = 3,
+                         unsigned maxRoutes = 4, unsigned parts = 32);
+
+    // Records the duration of every later bestRoute/bestSplit call into h
+    // (nullptr stops recording). The histogram must outlive the router's use.
+    void setLatencyHistogram(LatencyHistogram* h) { latency_ = h; }
+
+    // Prices a given chain of pools starting from tokenIn.
+    Route quotePath(const std::vector<PoolId>& pools, TokenId tokenIn, double amountIn) const {
+        return ::quotePath(reg_, pools, tokenIn, amountIn);
+    }
+
+private:
+    // Fast-path search on the edge terms; fills path with edge indices.
+    bool search(TokenId tokenIn, TokenId tokenOut, double amountIn, unsigned maxHops,
+                std::vector<uint32_t>& path);
+    bool usesPool(unsigned hop, TokenId at, PoolId pool) const;
+    double pathOut(const std::vector<uint32_t>& path, double amountIn) const;
+    Route priceEdges(const std::vector<uint32_t>& path, TokenId tokenIn, double amountIn) const;
+
+    const PoolRegistry& reg_;
+
+    PoolGraph graph_;
+
+    // Per-query labels, (hop, token) -> slot hop*tokenCount + token. A slot
+    // is live only if its stamp equals epoch_, so nothing is cleared per query.
+    std::vector<uint32_t> stamp_;
+    std::vector<double> amount_;
+    std::vector<uint32_t> viaEdge_;
+    std::vector<TokenId> prevToken_;
+    uint32_t epoch_ = 0;
+    unsigned labelHops_ = 0;
+    std::vector<uint32_t> nearTarget_;   // token has an edge to tokenOut (stamp == epoch_)
+
+    // Pools excluded from the current search (stamp == banEpoch_).
+    std::vector<uint32_t> banned_;
+    uint32_t banEpoch_ = 0;
+
+    std::vector<TokenId> frontier_, next_;
+
+    LatencyHistogram* latency_ = nullptr;
+};
+
+// Fixed routes kept quoted while reserves move. Each watched route is
+// registered in a DependencyIndex, so poolsChanged() re-quotes only the
+// routes that go through a changed pool.
+class RouteBook {
+public:
+    using WatchId = DependencyIndex::DepId;
+
+    explicit RouteBook(const PoolRegistry& reg) : reg_(reg) {}
+
+    // Starts tracking the quote of amountIn along pools; returns its id.
+    WatchId watch(const std::vector<PoolId>& pools, TokenId tokenIn, double amountIn);
+    void unwatch(WatchId id);
+
+    const Route& quote(WatchId id) const;
+
+    // Call after the reserves of `changed` moved (e.g. with the pools of a
+    // replayed batch). Returns the number of routes re-quoted.
+    size_t poolsChanged(const std::vector<PoolId>& changed);
+
+    size_t size() const { return deps_.size(); }
+    const DependencyIndex::Stats& stats() const { return deps_.stats(); }
+
+private:
+    struct Watched {
+        std::vector<PoolId> pools;
+        TokenId tokenIn = kNoToken;
+        double amountIn = 0.0;
+        Route quote;
+    };
+
+    const PoolRegistry& reg_;
+    std::vector<Watched> watched_;   // indexed by WatchId
+    DependencyIndex deps_;
+};
@@ -0,0 +1,364 @@
+#include "stableswap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "amount_out_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STABLE_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Newton stops once a step moves D by at most this much (relative); near
+// the root, steps alternate within an ulp or two.
+const double kTolerance = 1e-15;
+
+void checkPool(const double* balances, size_t n, double amp) {
+    require(n >= 2, "a StableSwap pool needs at least 2 coins");
+    require(amp >= 1.0, "amp must be >= 1");
+    for (size_t k = 0; k < n; ++k) require(balances[k] > 0.0, "reserves must be > 0");
+}
+
+// The y > 0 root of y^2 + bd*y - c = 0, without cancellation for either sign of bd.
+inline double positiveRoot(double bd, double c) {
+    const double disc = std::sqrt(bd * bd + 4.0 * c);
+    return bd >= 0.0 ? (2.0 * c) / (bd + disc) : (disc - bd) * 0.5;
+}
+
+// y0 - y1 for the roots of y^2 + bd*y - c = 0 before (x0) and after
+// (x1 = x0 + amountIn) the input. bd grows by amountIn and c = K / x, so
+//   y0 - y1 = amountIn * (c1/x0 + y1) / (y1 + c0/y0)
+// with every term positive. Subtracting the roots (or balanceOut - y1)
+// instead loses the output of small trades to cancellation.
+inline double outputOf(double amountIn, double x0, double c0, double y0, double c1, double y1) {
+    return amountIn * (c1 / x0 + y1) / (y1 + c0 / y0);
+}
+
+// Two-coin kernels with ann = A * 2^2. The batch kernels below perform the
+// same IEEE operations in the same order.
+
+inline double invariant2(double x, double y, double ann) {
+    const double s = x + y;
+    double d = std::min(std::cbrt(ann * s * (4.0 * x) * y), s);
+    for (int step = 0; step < kStableSwapMaxSteps; ++step) {
+        const double dp = d * d / (x * 2.0) * d / (y * 2.0);
+        const double next = (ann * s + dp * 2.0) * d / ((ann - 1.0) * d + 3.0 * dp);
+        const bool done = std::fabs(next - d) <= d * kTolerance;
+        d = next;
+        if (done) break;
+    }
+    return d;
+}
+
+inline double amountOut2(double amountIn, double reserveIn, double reserveOut, double fee, double ann,
+                         double* spot) {
+    const double d = invariant2(reserveIn, reserveOut, ann);
+    if (spot) {
+        const double k = d * d / (reserveIn * 2.0) * d / (reserveOut * 2.0);
+        *spot = (ann + k / reserveIn) / (ann + k / reserveOut);
+    }
+    const double x1 = reserveIn + amountIn;
+    double c0 = d * d / (reserveIn * 2.0);
+    c0 = c0 * d / (ann * 2.0);
+    double c1 = d * d / (x1 * 2.0);
+    c1 = c1 * d / (ann * 2.0);
+    const double y0 = positiveRoot(reserveIn + d / ann - d, c0);
+    const double y1 = positiveRoot(x1 + d / ann - d, c1);
+    return outputOf(amountIn, reserveIn, c0, y0, c1, y1) * (1.0 - fee);
+}
+
+void stableLoopScalar(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                      const double* fee, const double* amp, double* amountOut, double* spot,
+                      size_t begin, size_t n) {
+    for (size_t i = begin; i < n; ++i) {
+        amountOut[i] = amountOut2(amountIn[i], reserveIn[i], reserveOut[i], fee[i], amp[i] * 4.0,
+                                  spot ? spot + i : nullptr);
+    }
+}
+
+#ifdef STABLE_X86_DISPATCH
+
+__attribute__((target("avx2")))
+inline __m256d positiveRootAvx2(__m256d bd, __m256d c) {
+    const __m256d disc = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(bd, bd), _mm256_mul_pd(_mm256_set1_pd(4.0), c)));
+    const __m256d pos = _mm256_div_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), c), _mm256_add_pd(bd, disc));
+    const __m256d neg = _mm256_mul_pd(_mm256_sub_pd(disc, bd), _mm256_set1_pd(0.5));
+    return _mm256_blendv_pd(neg, pos, _mm256_cmp_pd(bd, _mm256_setzero_pd(), _CMP_GE_OQ));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d positiveRootAvx512(__m512d bd, __m512d c) {
+    const __m512d disc = _mm512_sqrt_pd(_mm512_add_pd(_mm512_mul_pd(bd, bd), _mm512_mul_pd(_mm512_set1_pd(4.0), c)));
+    const __m512d pos = _mm512_div_pd(_mm512_mul_pd(_mm512_set1_pd(2.0), c), _mm512_add_pd(bd, disc));
+    const __m512d neg = _mm512_mul_pd(_mm512_sub_pd(disc, bd), _mm512_set1_pd(0.5));
+    return _mm512_mask_mov_pd(neg, _mm512_cmp_pd_mask(bd, _mm512_setzero_pd(), _CMP_GE_OQ), pos);
+}
+
+// cbrt has no vector instruction, so the starting point is taken per lane.
+__attribute__((target("avx2")))
+void stableLoopAvx2(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                    const double* fee, const double* amp, double* amountOut, double* spot, size_t n) {
+    const __m256d one = _mm256_set1_pd(1.0), two = _mm256_set1_pd(2.0), three = _mm256_set1_pd(3.0);
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d tol = _mm256_set1_pd(kTolerance), sign = _mm256_set1_pd(-0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d in = _mm256_loadu_pd(amountIn + i);
+        const __m256d rIn = _mm256_loadu_pd(reserveIn + i);
+        const __m256d rOut = _mm256_loadu_pd(reserveOut + i);
+        const __m256d f = _mm256_loadu_pd(fee + i);
+        const __m256d ann = _mm256_mul_pd(_mm256_loadu_pd(amp + i), four);
+        const __m256d s = _mm256_add_pd(rIn, rOut);
+
+        alignas(32) double g[4];
+        _mm256_store_pd(g, _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(ann, s), _mm256_mul_pd(four, rIn)), rOut));
+        for (double& v : g) v = std::cbrt(v);
+        __m256d d = _mm256_min_pd(_mm256_load_pd(g), s);
+
+        __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        for (int step = 0; step < kStableSwapMaxSteps && _mm256_movemask_pd(active) != 0; ++step) {
+            __m256d dp = _mm256_div_pd(_mm256_mul_pd(d, d), _mm256_mul_pd(rIn, two));
+            dp = _mm256_div_pd(_mm256_mul_pd(dp, d), _mm256_mul_pd(rOut, two));
+            const __m256d num = _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(ann, s), _mm256_mul_pd(dp, two)), d);
+            const __m256d den = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(ann, one), d), _mm256_mul_pd(three, dp));
+            const __m256d next = _mm256_div_pd(num, den);
+            const __m256d done = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(next, d)),
+                                               _mm256_mul_pd(d, tol), _CMP_LE_OQ);
+            d = _mm256_blendv_pd(d, next, active);
+            active = _mm256_andnot_pd(done, active);
+        }
+
+        if (spot) {
+            __m256d k = _mm256_div_pd(_mm256_mul_pd(d, d), _mm256_mul_pd(rIn, two));
+            k = _mm256_div_pd(_mm256_mul_pd(k, d), _mm256_mul_pd(rOut, two));
+            _mm256_storeu_pd(spot + i, _mm256_div_pd(_mm256_add_pd(ann, _mm256_div_pd(k, rIn)),
+                                                     _mm256_add_pd(ann, _mm256_div_pd(k, rOut))));
+        }
+
+        const __m256d x1 = _mm256_add_pd(rIn, in);
+        const __m256d dOverAnn = _mm256_div_pd(d, ann);
+        __m256d c0 = _mm256_div_pd(_mm256_mul_pd(d, d), _mm256_mul_pd(rIn, two));
+        c0 = _mm256_div_pd(_mm256_mul_pd(c0, d), _mm256_mul_pd(ann, two));
+        __m256d c1 = _mm256_div_pd(_mm256_mul_pd(d, d), _mm256_mul_pd(x1, two));
+        c1 = _mm256_div_pd(_mm256_mul_pd(c1, d), _mm256_mul_pd(ann, two));
+        const __m256d y0 = positiveRootAvx2(_mm256_sub_pd(_mm256_add_pd(rIn, dOverAnn), d), c0);
+        const __m256d y1 = positiveRootAvx2(_mm256_sub_pd(_mm256_add_pd(x1, dOverAnn), d), c1);
+        const __m256d dy = _mm256_div_pd(_mm256_mul_pd(in, _mm256_add_pd(_mm256_div_pd(c1, rIn), y1)),
+                                         _mm256_add_pd(y1, _mm256_div_pd(c0, y0)));
+        _mm256_storeu_pd(amountOut + i, _mm256_mul_pd(dy, _mm256_sub_pd(one, f)));
+    }
+    stableLoopScalar(amountIn, reserveIn, reserveOut, fee, amp, amountOut, spot, i, n);
+}
+
+__attribute__((target("avx512f")))
+void stableLoopAvx512(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                      const double* fee, const double* amp, double* amountOut, double* spot, size_t n) {
+    const __m512d one = _mm512_set1_pd(1.0), two = _mm512_set1_pd(2.0), three = _mm512_set1_pd(3.0);
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d tol = _mm512_set1_pd(kTolerance);
+    for (size_t i = 0; i < n; i += 8) {
+        // The tail is a masked block; its dead lanes never leave the registers.
+        const __mmask8 m = (n - i >= 8) ? (__mmask8)0xff : (__mmask8)((1u << (n - i)) - 1u);
+        const __m512d in = _mm512_maskz_loadu_pd(m, amountIn + i);
+        const __m512d rIn = _mm512_maskz_loadu_pd(m, reserveIn + i);
+        const __m512d rOut = _mm512_maskz_loadu_pd(m, reserveOut + i);
+        const __m512d f = _mm512_maskz_loadu_pd(m, fee + i);
+        const __m512d ann = _mm512_mul_pd(_mm512_maskz_loadu_pd(m, amp + i), four);
+        const __m512d s = _mm512_add_pd(rIn, rOut);
+
+        alignas(64) double g[8];
+        _mm512_store_pd(g, _mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(ann, s), _mm512_mul_pd(four, rIn)), rOut));
+        for (double& v : g) v = std::cbrt(v);
+        __m512d d = _mm512_min_pd(_mm512_load_pd(g), s);
+
+        __mmask8 active = m;
+        for (int step = 0; step < kStableSwapMaxSteps && active != 0; ++step) {
+            __m512d dp = _mm512_div_pd(_mm512_mul_pd(d, d), _mm512_mul_pd(rIn, two));
+            dp = _mm512_div_pd(_mm512_mul_pd(dp, d), _mm512_mul_pd(rOut, two));
+            const __m512d num = _mm512_mul_pd(_mm512_add_pd(_mm512_mul_pd(ann, s), _mm512_mul_pd(dp, two)), d);
+            const __m512d den = _mm512_add_pd(_mm512_mul_pd(_mm512_sub_pd(ann, one), d), _mm512_mul_pd(three, dp));
+            const __m512d next = _mm512_div_pd(num, den);
+            const __mmask8 done = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(next, d)),
+                                                     _mm512_mul_pd(d, tol), _CMP_LE_OQ);
+            d = _mm512_mask_mov_pd(d, active, next);
+            active = (__mmask8)(active & ~done);
+        }
+
+        if (spot) {
+            __m512d k = _mm512_div_pd(_mm512_mul_pd(d, d), _mm512_mul_pd(rIn, two));
+            k = _mm512_div_pd(_mm512_mul_pd(k, d), _mm512_mul_pd(rOut, two));
+            _mm512_mask_storeu_pd(spot + i, m, _mm512_div_pd(_mm512_add_pd(ann, _mm512_div_pd(k, rIn)),
+                                                             _mm512_add_pd(ann, _mm512_div_pd(k, rOut))));
+        }
+
+        const __m512d x1 = _mm512_add_pd(rIn, in);
+        const __m512d dOverAnn = _mm512_div_pd(d, ann);
+        __m512d c0 = _mm512_div_pd(_mm512_mul_pd(d, d), _mm512_mul_pd(rIn, two));
+        c0 = _mm512_div_pd(_mm512_mul_pd(c0, d), _mm512_mul_pd(ann, two));
+        __m512d c1 = _mm512_div_pd(_mm512_mul_pd(d, d), _mm512_mul_pd(x1, two));
+        c1 = _mm512_div_pd(_mm512_mul_pd(c1, d), _mm512_mul_pd(ann, two));
+        const __m512d y0 = positiveRootAvx512(_mm512_sub_pd(_mm512_add_pd(rIn, dOverAnn), d), c0);
+        const __m512d y1 = positiveRootAvx512(_mm512_sub_pd(_mm512_add_pd(x1, dOverAnn), d), c1);
+        const __m512d dy = _mm512_div_pd(_mm512_mul_pd(in, _mm512_add_pd(_mm512_div_pd(c1, rIn), y1)),
+                                         _mm512_add_pd(y1, _mm512_div_pd(c0, y0)));
+        _mm512_mask_storeu_pd(amountOut + i, m, _mm512_mul_pd(dy, _mm512_sub_pd(one, f)));
+    }
+}
+
+#endif // STABLE_X86_DISPATCH
+
+void stableBatch(const double* amountIn, const double* reserveIn, const double* reserveOut, const double* fee,
+                 const double* amp, double* amountOut, double* spot, size_t n) {
+    switch (activeSimdLevel()) {
+#ifdef STABLE_X86_DISPATCH
+        case SimdLevel::Avx512:
+            stableLoopAvx512(amountIn, reserveIn, reserveOut, fee, amp, amountOut, spot, n);
+            return;
+        case SimdLevel::Avx2:
+            stableLoopAvx2(amountIn, reserveIn, reserveOut, fee, amp, amountOut, spot, n);
+            return;
+#endif
+        default:
+            stableLoopScalar(amountIn, reserveIn, reserveOut, fee, amp, amountOut, spot, 0, n);
+            return;
+    }
+}
+
+// Balance of coin j at invariant d, with coin `swapped` set to x and the
+// rest taken from balances.
+double balanceAt(const double* balances, size_t n, double ann, size_t j, size_t swapped, double x, double d,
+                 double* cOut = nullptr) {
+    const double nd = (double)n;
+    double c = d, s = 0.0;
+    for (size_t k = 0; k < n; ++k) {
+        if (k == j) continue;
+        const double xk = (k == swapped) ? x : balances[k];
+        s += xk;
+        c = c * d / (xk * nd);
+    }
+    c = c * d / (ann * nd);
+    if (cOut) *cOut = c;
+    return positiveRoot(s + d / ann - d, c);
+}
+
+double annOf(size_t n, double amp) {
+    const double nd = (double)n;
+    return amp * std::pow(nd, nd);
+}
+
+} // namespace
+
+double stableSwapInvariant(const double* balances, size_t n, double amp) {
+    checkPool(balances, n, amp);
+    if (n == 2) return invariant2(balances[0], balances[1], amp * 4.0);
+
+    const double nd = (double)n;
+    const double ann = annOf(n, amp);
+    double s = 0.0, logProd = 0.0;
+    for (size_t k = 0; k < n; ++k) {
+        s += balances[k];
+        logProd += std::log(balances[k]);
+    }
+    // In log space: prod(x) alone overflows long before D does.
+    double d = std::min(std::exp((std::log(ann * s) + nd * std::log(nd) + logProd) / (nd + 1.0)), s);
+    for (int step = 0; step < kStableSwapMaxSteps; ++step) {
+        double dp = d;
+        for (size_t k = 0; k < n; ++k) dp = dp * d / (balances[k] * nd);
+        const double next = (ann * s + dp * nd) * d / ((ann - 1.0) * d + (nd + 1.0) * dp);
+        const bool done = std::fabs(next - d) <= d * kTolerance;
+        d = next;
+        if (done) break;
+    }
+    return d;
+}
+
+double stableSwapBalance(const double* balances, size_t n, double amp, size_t j, double D) {
+    require(n >= 2 && j < n, "coin index out of range");
+    require(amp >= 1.0, "amp must be >= 1");
+    return balanceAt(balances, n, annOf(n, amp), j, j, 0.0, D);
+}
+
+double getAmountOutStable(const double* balances, size_t n, double amp, double fee, size_t i, size_t j,
+                          double amountIn) {
+    require(i < n && j < n && i != j, "coin indices must be distinct and in range");
+    require(amountIn > 0.0, "amountIn must be > 0");
+    require(fee >= 0.0 && fee < 1.0, "fee must be in [0, 1)");
+    if (n == 2) return getAmountOutStable(amountIn, balances[i], balances[j], fee, amp);
+
+    const double d = stableSwapInvariant(balances, n, amp);
+    const double ann = annOf(n, amp);
+    double c0 = 0.0, c1 = 0.0;
+    const double y0 = balanceAt(balances, n, ann, j, i, balances[i], d, &c0);
+    const double y1 = balanceAt(balances, n, ann, j, i, balances[i] + amountIn, d, &c1);
+    return outputOf(amountIn, balances[i], c0, y0, c1, y1) * (1.0 - fee);
+}
+
+double getAmountOutStable(double amountIn, double reserveIn, double reserveOut, double fee, double amp) {
+    require(amountIn > 0.0, "amountIn must be > 0");
+    require(reserveIn > 0.0 && reserveOut > 0.0, "reserves must be > 0");
+    require(fee >= 0.0 && fee < 1.0, "fee must be in [0, 1)");
+    require(amp >= 1.0, "amp must be >= 1");
+    return amountOut2(amountIn, reserveIn, reserveOut, fee, amp * 4.0, nullptr);
+}
+
+double stableSwapSpotPrice(const double* balances, size_t n, double amp, size_t i, size_t j) {
+    require(i < n && j < n && i != j, "coin indices must be distinct and in range");
+    if (n == 2) return stableSwapSpotPrice(balances[i], balances[j], amp);
+
+    const double d = stableSwapInvariant(balances, n, amp);
+    const double nd = (double)n;
+    const double ann = annOf(n, amp);
+    double k = d;
+    for (size_t m = 0; m < n; ++m) k = k * d / (balances[m] * nd);
+    return (ann + k / balances[i]) / (ann + k / balances[j]);
+}
+
+double stableSwapSpotPrice(double reserveIn, double reserveOut, double amp) {
+    require(reserveIn > 0.0 && reserveOut > 0.0, "reserves must be > 0");
+    require(amp >= 1.0, "amp must be >= 1");
+    double spot = 0.0;
+    amountOut2(0.0, reserveIn, reserveOut, 0.0, amp * 4.0, &spot);
+    return spot;
+}
+
+void getAmountOutStableBatch(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                             const double* fee, const double* amp, double* amountOut, size_t n) {
+    stableBatch(amountIn, reserveIn, reserveOut, fee, amp, amountOut, nullptr, n);
+}
+
+size_t simulateStableSwapBatch(const SwapBatchInput& in, const double* amp, const SwapBatchOutput& out) {
+    validateSwapBatch(in, out.error);
+
+    // effectivePrice holds the spot price until the pricing pass below.
+    stableBatch(in.amountIn, in.reserveIn, in.reserveOut, in.fee, amp, out.amountOut, out.effectivePrice, in.count);
+
+    const double* reserveIn = in.reserveIn;
+    const double* reserveOut = in.reserveOut;
+    const double* amountIn = in.amountIn;
+    const size_t n = in.count;
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const double P0 = out.effectivePrice[i];
+        const double effectivePrice = out.amountOut[i] / amountIn[i];
+        out.newReserveIn[i] = reserveIn[i] + amountIn[i];
+        out.newReserveOut[i] = reserveOut[i] - out.amountOut[i];
+        out.effectivePrice[i] = effectivePrice;
+        out.slippagePercent[i] = (P0 - effectivePrice) / P0 * 100.0;
+
+        const uint8_t e = (uint8_t)(out.error[i] | (amp[i] >= 1.0 ? 0 : SwapBadAmp) |
+                                    ((out.amountOut[i] < reserveOut[i]) ? 0 : SwapDrainsPool));
+        out.error[i] = e;
+        if (e != 0) {
+            out.amountOut[i] = 0.0;
+            out.newReserveIn[i] = 0.0;
+            out.newReserveOut[i] = 0.0;
+            out.effectivePrice[i] = 0.0;
+            out.slippagePercent[i] = 0.0;
+            ++bad;
+        }
+    }
+    return bad;
+}
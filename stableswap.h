@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+
+#include "amm.h"
+#include "swap_batch.h"
+
+// Curve StableSwap invariant for n coins with amplification A (the
+// whitepaper's A; a Curve contract's A() is A * n^(n-1)):
+//
+//   A n^n sum(x) + D = A n^n D + D^(n+1) / (n^n prod(x))
+//
+// Near balance the curve is almost the line sum(x) = D, so stablecoin
+// swaps see far less slippage than x*y=k; far from balance it bends into
+// a constant product. A must be >= 1.
+//
+// D is found with Newton's method started from min(sum(x),
+// (A n^n sum(x) n^n prod(x))^(1/(n+1))). Both are upper bounds of D, so
+// the iteration falls monotonically and stops after at most
+// kStableSwapMaxSteps steps (7 are enough for imbalances up to 1e20 and
+// A up to 1e6). With the other balances fixed, the invariant is a
+// quadratic in the remaining balance, which is solved in closed form.
+//
+// As in Curve, the fee is taken from the output:
+//   amountOut = (balanceOut - y(balanceIn + amountIn)) * (1 - fee)
+const int kStableSwapMaxSteps = 16;
+
+// D for n >= 2 balances, all > 0.
+double stableSwapInvariant(const double* balances, size_t n, double amp);
+
+// The balance of coin j that keeps the invariant at D, given the other
+// balances (balances[j] itself is ignored).
+double stableSwapBalance(const double* balances, size_t n, double amp, size_t j, double D);
+
+// Exact-input swap of coin i for coin j in an n-coin pool.
+double getAmountOutStable(const double* balances, size_t n, double amp, double fee, size_t i, size_t j,
+                          double amountIn);
+
+// Two-coin pool, same arguments as getAmountOut plus the amplification.
+double getAmountOutStable(double amountIn, double reserveIn, double reserveOut, double fee, double amp);
+
+// Marginal price of coin i in coin j before fees (out per in):
+//   (A n^n + k/x_i) / (A n^n + k/x_j),   k = D^(n+1) / (n^n prod(x))
+double stableSwapSpotPrice(const double* balances, size_t n, double amp, size_t i, size_t j);
+double stableSwapSpotPrice(double reserveIn, double reserveOut, double amp);
+
+// Same results and slippage definition as simulateSwap, on the StableSwap
+// curve. P0 is the marginal price above rather than reserveOut / reserveIn.
+template <Direction D>
+SwapResult simulateStableSwap(double reserveA, double reserveB, double fee, double amp, double amountIn) {
+    require(reserveA > 0.0 && reserveB > 0.0, "reserveA and reserveB must be > 0");
+
+    const bool aToB = (D == Direction::A2B);
+    const double reserveIn = aToB ? reserveA : reserveB;
+    const double reserveOut = aToB ? reserveB : reserveA;
+
+    const double P0 = stableSwapSpotPrice(reserveIn, reserveOut, amp);
+    const double out = getAmountOutStable(amountIn, reserveIn, reserveOut, fee, amp);
+    require(out < reserveOut, "amountOut would drain the pool (invalid trade)");
+
+    SwapResult r{};
+    r.amountOut = out;
+    r.newReserveA = aToB ? reserveA + amountIn : reserveA - out;
+    r.newReserveB = aToB ? reserveB - out : reserveB + amountIn;
+    r.effectivePrice = out / amountIn;
+    r.slippagePercent = (P0 - r.effectivePrice) / P0 * 100.0;
+    return r;
+}
+
+inline SwapResult simulateStableSwap(double reserveA, double reserveB, double fee, double amp,
+                                     Direction dir, double amountIn) {
+    return dir == Direction::A2B
+           ? simulateStableSwap<Direction::A2B>(reserveA, reserveB, fee, amp, amountIn)
+           : simulateStableSwap<Direction::B2A>(reserveA, reserveB, fee, amp, amountIn);
+}
+
+// Vectorized two-coin getAmountOutStable, dispatched on activeSimdLevel()
+// like getAmountOutBatch. Each lane runs its own Newton iteration and drops
+// out when it converges; all levels return bit-identical results to the
+// scalar function. No validation (see simulateStableSwapBatch).
+void getAmountOutStableBatch(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                             const double* fee, const double* amp, double* amountOut, size_t n);
+
+// simulateSwapBatch on the StableSwap curve, with one amplification per
+// lane. Lanes with amp < 1 are flagged SwapBadAmp.
+size_t simulateStableSwapBatch(const SwapBatchInput& in, const double* amp, const SwapBatchOutput& out);
@@ -0,0 +1,173 @@
+#include "stage_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "tsc.h"
+
+const char* stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Parse: return "parse";
+        case Stage::Validate: return "validate";
+        case Stage::Math: return "math";
+        case Stage::StateUpdate: return "state update";
+        default: return "output";
+    }
+}
+
+static const char* counterName(int c) {
+    switch ((StatCounter)c) {
+        case StatCounter::SwapsQuoted: return "swaps quoted";
+        case StatCounter::LinesRead: return "lines read";
+        default: return "bytes written";
+    }
+}
+
+#if CRYPT_STATS
+
+bool gStatsEnabled = false;
+
+void setStatsEnabled(bool on) { gStatsEnabled = on; }
+
+namespace {
+
+// One thread's totals. Only the owning thread writes; relaxed load+store
+// (not an atomic add) keeps that a plain add while letting snapshots read
+// live threads without a data race.
+struct ThreadStats {
+    std::atomic<uint64_t> samples[kStageCount] = {};
+    std::atomic<uint64_t> ticks[kStageCount] = {};
+    std::atomic<uint64_t> items[kStageCount] = {};
+    std::atomic<uint64_t> counters[kStatCounterCount] = {};
+    int current = -1;    // innermost open stage, -1 if none
+    uint64_t mark = 0;   // TSC when `current` was last charged
+};
+
+void bump(std::atomic<uint64_t>& v, uint64_t n) {
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void addInto(StageStatsSnapshot& s, const ThreadStats& t) {
+    for (int i = 0; i < kStageCount; ++i) {
+        s.samples[i] += t.samples[i].load(std::memory_order_relaxed);
+        s.ticks[i] += t.ticks[i].load(std::memory_order_relaxed);
+        s.items[i] += t.items[i].load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < kStatCounterCount; ++i) s.counters[i] += t.counters[i].load(std::memory_order_relaxed);
+}
+
+struct StatsRegistry {
+    std::mutex mutex;
+    std::vector<const ThreadStats*> live;
+    StageStatsSnapshot retired;
+};
+
+StatsRegistry& statsRegistry() {
+    static StatsRegistry* r = new StatsRegistry();   // never destroyed: threads may exit after main
+    return *r;
+}
+
+// Registers the thread's block on construction, merges it on thread exit.
+struct ThreadStatsHandle {
+    ThreadStats stats;
+
+    ThreadStatsHandle() {
+        StatsRegistry& r = statsRegistry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.push_back(&stats);
+    }
+    ~ThreadStatsHandle() {
+        StatsRegistry& r = statsRegistry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        addInto(r.retired, stats);
+        r.live.erase(std::find(r.live.begin(), r.live.end(), &stats));
+    }
+};
+
+thread_local ThreadStats* tlsStats = nullptr;
+
+ThreadStats& threadStats() {
+    if (!tlsStats) {
+        static thread_local ThreadStatsHandle handle;
+        tlsStats = &handle.stats;
+    }
+    return *tlsStats;
+}
+
+} // namespace
+
+int enterStage(Stage stage) {
+    ThreadStats& t = threadStats();
+    const uint64_t now = readTsc();
+    if (t.current >= 0) bump(t.ticks[t.current], now - t.mark);
+    t.mark = now;
+    const int enclosing = t.current;
+    t.current = (int)stage;
+    return enclosing;
+}
+
+void leaveStage(Stage stage, int enclosing, uint64_t items) {
+    ThreadStats& t = threadStats();
+    const uint64_t now = readTsc();
+    const int s = (int)stage;
+    bump(t.ticks[s], now - t.mark);
+    bump(t.samples[s], 1);
+    bump(t.items[s], items);
+    t.mark = now;
+    t.current = enclosing;
+}
+
+void addStatSlow(StatCounter counter, uint64_t n) {
+    bump(threadStats().counters[(int)counter], n);
+}
+
+StageStatsSnapshot stageStatsSnapshot() {
+    StatsRegistry& r = statsRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    StageStatsSnapshot s = r.retired;
+    for (const ThreadStats* t : r.live) addInto(s, *t);
+    return s;
+}
+
+#else
+
+StageStatsSnapshot stageStatsSnapshot() { return StageStatsSnapshot(); }
+
+#endif // CRYPT_STATS
+
+void printStageStats(std::FILE* out, double wallSeconds) {
+    if (!CRYPT_STATS) {
+        std::fprintf(out, "stats: not compiled in (configure with -DCRYPT_STATS=ON)\n");
+        return;
+    }
+    const StageStatsSnapshot s = stageStatsSnapshot();
+    const double hz = tscHz();
+
+    std::fprintf(out, "\nstats: wall %.3f s (time is per thread, so shares can exceed 100%% with threads)\n",
+                 wallSeconds);
+    std::fprintf(out, "%-14s %10s %12s %11s %7s %10s %12s\n",
+                 "stage", "samples", "items", "time ms", "share", "ns/item", "items/s");
+    for (int i = 0; i < kStageCount; ++i) {
+        if (s.samples[i] == 0) continue;
+        const double sec = (double)s.ticks[i] / hz;
+        std::fprintf(out, "%-14s %10llu %12llu %11.3f %6.1f%%", stageName((Stage)i),
+                     (unsigned long long)s.samples[i], (unsigned long long)s.items[i], sec * 1e3,
+                     wallSeconds > 0.0 ? 100.0 * sec / wallSeconds : 0.0);
+        if (s.items[i] > 0 && sec > 0.0) {
+            std::fprintf(out, " %10.1f %12.4g\n", sec * 1e9 / (double)s.items[i], (double)s.items[i] / sec);
+        } else {
+            std::fprintf(out, " %10s %12s\n", "-", "-");
+        }
+    }
+    for (int i = 0; i < kStatCounterCount; ++i) {
+        std::fprintf(out, "%s%s %llu", i == 0 ? "counters: " : ", ", counterName(i),
+                     (unsigned long long)s.counters[i]);
+    }
+    std::fprintf(out, "\n");
+    if (wallSeconds > 0.0 && s.counters[(int)StatCounter::SwapsQuoted] > 0) {
+        std::fprintf(out, "throughput: %.4g swaps/s over the whole run\n",
+                     (double)s.counters[(int)StatCounter::SwapsQuoted] / wallSeconds);
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// Where the time goes: per-stage TSC timers and event counters for --stats.
+//
+// Compiled in unless CRYPT_STATS is 0 (cmake -DCRYPT_STATS=OFF), in which
+// case every hook below is an empty inline function. Compiled in but not
+// enabled, a hook costs one load and a predicted branch.
+//
+// Each thread accumulates into its own block (no shared cache lines, no
+// locks after its first sample); a thread's block is merged into the
+// totals when the thread exits, and stageStatsSnapshot() adds the blocks
+// of threads still running.
+#ifndef CRYPT_STATS
+#define CRYPT_STATS 1
+#endif
+
+enum class Stage {
+    Parse,         // reading and parsing input (CLI arguments, pools file, trade log)
+    Validate,      // input checks on swap batches
+    Math,          // pricing: batch kernels and the gather/scatter around them
+    StateUpdate,   // committing new reserves and fee growth to the registry
+    Output,        // formatting and writing results
+};
+const int kStageCount = 5;
+
+enum class StatCounter {
+    SwapsQuoted,   // swaps priced: batch lanes, applySwaps, the single-swap CLI
+    LinesRead,     // text lines read (pools files and trade logs)
+    BytesWritten,  // result bytes handed to the OS by ResultSink
+};
+const int kStatCounterCount = 3;
+
+const char* stageName(Stage stage);
+
+#if CRYPT_STATS
+
+extern bool gStatsEnabled;
+
+inline bool statsEnabled() { return gStatsEnabled; }
+
+// Set before any thread that records stats is started.
+void setStatsEnabled(bool on);
+
+// Out-of-line halves of ScopedStage and addStat, so the thread-local
+// lookup stays in stage_stats.cpp. enterStage returns the enclosing stage.
+int enterStage(Stage stage);
+void leaveStage(Stage stage, int enclosing, uint64_t items);
+void addStatSlow(StatCounter counter, uint64_t n);
+
+inline void addStat(StatCounter counter, uint64_t n = 1) {
+    if (statsEnabled()) addStatSlow(counter, n);
+}
+
+// Times its scope as one sample of `stage`. Time is exclusive: while a
+// nested ScopedStage runs, it is charged to the nested stage only. Each
+// sample reads the TSC twice; time per-batch rather than per-item scopes
+// where a sample would cost as much as the work.
+class ScopedStage {
+public:
+    explicit ScopedStage(Stage stage, uint64_t items = 0) : stage_(stage), items_(items) {
+        if (statsEnabled()) enclosing_ = enterStage(stage);
+    }
+    ~ScopedStage() {
+        if (enclosing_ != kInactive) leaveStage(stage_, enclosing_, items_);
+    }
+    ScopedStage(const ScopedStage&) = delete;
+    ScopedStage& operator=(const ScopedStage&) = delete;
+
+    // Items processed, for the per-item rate, when only known at the end.
+    void addItems(uint64_t n) { items_ += n; }
+
+private:
+    static const int kInactive = -2;
+    Stage stage_;
+    uint64_t items_;
+    int enclosing_ = kInactive;
+};
+
+#else
+
+inline bool statsEnabled() { return false; }
+inline void setStatsEnabled(bool) {}
+inline void addStat(StatCounter, uint64_t = 1) {}
+
+class ScopedStage {
+public:
+    explicit ScopedStage(Stage, uint64_t = 0) {}
+    void addItems(uint64_t) {}
+};
+
+#endif // CRYPT_STATS
+
+struct StageStatsSnapshot {
+    uint64_t samples[kStageCount] = {};
+    uint64_t ticks[kStageCount] = {};    // TSC ticks (see tsc.h)
+    uint64_t items[kStageCount] = {};
+    uint64_t counters[kStatCounterCount] = {};
+};
+
+// Totals over exited threads plus the live ones.
+StageStatsSnapshot stageStatsSnapshot();
+
+// Per-stage table (samples, items, time, share of wallSeconds, ns/item,
+// items/s) and the counters.
+void printStageStats(std::FILE* out, double wallSeconds);
@@ -0,0 +1,91 @@
+#include "swap_batch.h"
+
+#include "amount_out_simd.h"
+#include "stage_stats.h"
+
+// Pointers and count are copied to locals: error[] is uint8_t and may alias
+// anything, which would otherwise force the compiler to reload them per lane.
+
+size_t validateSwapBatch(const SwapBatchInput& in, uint8_t* error) {
+    const double* reserveIn = in.reserveIn;
+    const double* reserveOut = in.reserveOut;
+    const double* fee = in.fee;
+    const double* amountIn = in.amountIn;
+    const size_t n = in.count;
+    ScopedStage timer(Stage::Validate, n);
+    addStat(StatCounter::SwapsQuoted, n);
+
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+        // Non-short-circuit & / | so the loop body has no branches.
+        const bool okAmount = amountIn[i] > 0.0;
+        const bool okReserves = (reserveIn[i] > 0.0) & (reserveOut[i] > 0.0);
+        const bool okFee = (fee[i] >= 0.0) & (fee[i] < 1.0);
+
+        const uint8_t e = (uint8_t)((okAmount ? 0 : SwapBadAmountIn) |
+                                    (okReserves ? 0 : SwapBadReserves) |
+                                    (okFee ? 0 : SwapBadFee));
+        error[i] = e;
+        bad += (e != 0);
+    }
+    return bad;
+}
+
+// Math pass: pure double arithmetic over every lane so it vectorizes;
+// bad lanes may produce inf/nan here and are cleared in the mask pass.
+// __restrict: output columns never overlap the inputs or each other.
+static void priceLanes(const double* __restrict reserveInArr, const double* __restrict reserveOutArr,
+                       const double* __restrict amountInArr, const double* __restrict amountOutArr,
+                       double* __restrict newReserveInArr, double* __restrict newReserveOutArr,
+                       double* __restrict effectivePriceArr, double* __restrict slippageArr, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const double reserveIn = reserveInArr[i];
+        const double reserveOut = reserveOutArr[i];
+        const double amountIn = amountInArr[i];
+        const double amountOut = amountOutArr[i];
+
+        const double P0 = reserveOut / reserveIn;
+        const double effectivePrice = amountOut / amountIn;
+
+        newReserveInArr[i] = reserveIn + amountIn;
+        newReserveOutArr[i] = reserveOut - amountOut;
+        effectivePriceArr[i] = effectivePrice;
+        slippageArr[i] = (P0 - effectivePrice) / P0 * 100.0;
+    }
+}
+
+size_t simulateSwapBatch(const SwapBatchInput& in, const SwapBatchOutput& out) {
+    validateSwapBatch(in, out.error);
+    getAmountOutBatch(in.amountIn, in.reserveIn, in.reserveOut, in.fee, out.amountOut, in.count);
+    priceLanes(in.reserveIn, in.reserveOut, in.amountIn, out.amountOut,
+               out.newReserveIn, out.newReserveOut, out.effectivePrice, out.slippagePercent, in.count);
+
+    const double* reserveOut = in.reserveOut;
+    const size_t n = in.count;
+
+    // Mask pass: add the drain check and zero out every failed lane.
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t e = (uint8_t)(out.error[i] | ((out.amountOut[i] < reserveOut[i]) ? 0 : SwapDrainsPool));
+        out.error[i] = e;
+        if (e != 0) {
+            out.amountOut[i] = 0.0;
+            out.newReserveIn[i] = 0.0;
+            out.newReserveOut[i] = 0.0;
+            out.effectivePrice[i] = 0.0;
+            out.slippagePercent[i] = 0.0;
+            ++bad;
+        }
+    }
+    return bad;
+}
+
+std::string swapErrorMessage(uint8_t error) {
+    if (error & SwapBadAmountIn) return "amountIn must be > 0";
+    if (error & SwapBadReserves) return "reserves must be > 0";
+    if (error & SwapBadFee) return "fee must be in [0, 1)";
+    if (error & SwapBadAmp) return "amp must be >= 1";
+    if (error & SwapBadWeight) return "weights must be > 0";
+    if (error & SwapDrainsPool) return "amountOut would drain the pool (invalid trade)";
+    return "ok";
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Per-lane validation flags (bitmask, 0 means the lane is valid).
+// Same checks as require() in getAmountOut/simulateSwap, but reported
+// instead of thrown so one bad lane doesn't abort the whole batch.
+enum SwapError : uint8_t {
+    SwapOk          = 0,
+    SwapBadAmountIn = 1 << 0,  // amountIn must be > 0
+    SwapBadReserves = 1 << 1,  // reserves must be > 0
+    SwapBadFee      = 1 << 2,  // fee must be in [0, 1)
+    SwapDrainsPool  = 1 << 3,  // amountOut would drain the pool
+    SwapBadAmp      = 1 << 4,  // StableSwap amplification must be >= 1
+    SwapBadWeight   = 1 << 5,  // weighted-pool weights must be > 0
+};
+
+// Structure-of-arrays input: lane i is one swap priced against its own pool.
+// Direction is already resolved: reserveIn is the side the trader pays into.
+struct SwapBatchInput {
+    const double* reserveIn{};
+    const double* reserveOut{};
+    const double* fee{};
+    const double* amountIn{};
+    size_t count{};
+};
+
+// Structure-of-arrays output, one slot per input lane.
+// Invalid lanes have all numeric fields set to 0 and a non-zero error mask.
+// Output columns must not overlap the input columns or each other.
+struct SwapBatchOutput {
+    double* amountOut{};
+    double* newReserveIn{};
+    double* newReserveOut{};
+    double* effectivePrice{};   // amountOut / amountIn (out per in)
+    double* slippagePercent{};
+    uint8_t* error{};           // SwapError bits per lane
+};
+
+// Validation pass only: fills error[i] with the input checks
+// (SwapDrainsPool is decided by the math pass). Returns number of bad lanes.
+size_t validateSwapBatch(const SwapBatchInput& in, uint8_t* error);
+
+// Prices every lane of the batch. Never throws on bad input data;
+// returns the number of lanes with a non-zero error mask.
+size_t simulateSwapBatch(const SwapBatchInput& in, const SwapBatchOutput& out);
+
+// Human-readable text for an error mask (first set flag wins).
+std::string swapErrorMessage(uint8_t error);
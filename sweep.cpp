@@ -0,0 +1,293 @@
+#include "sweep.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "parallel_for.h"
+#include "parse_number.h"
+#include "stableswap.h"
+#include "swap_batch.h"
+#include "weighted.h"
+
+namespace {
+
+// Grid points per task: big enough to amortize scheduling, small enough to
+// keep every core busy on small grids and the per-chunk buffers in L2.
+const size_t kChunkPoints = 4096;
+
+struct ChunkStats {
+    uint64_t failed = 0;
+    uint64_t valid = 0;
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+};
+
+// Output file written at explicit offsets, so chunks can land in any order.
+class ColumnFile {
+public:
+    explicit ColumnFile(const std::string& path) {
+#if defined(_WIN32)
+        h_ = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        require(h_ != INVALID_HANDLE_VALUE, "cannot create " + path);
+#else
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        require(fd_ >= 0, "cannot create " + path);
+#endif
+    }
+
+    ~ColumnFile() {
+#if defined(_WIN32)
+        CloseHandle(h_);
+#else
+        ::close(fd_);
+#endif
+    }
+
+    ColumnFile(const ColumnFile&) = delete;
+    ColumnFile& operator=(const ColumnFile&) = delete;
+
+    // Thread-safe: positioned writes do not share a file offset.
+    void writeAt(const void* data, size_t size, uint64_t offset) {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+#if defined(_WIN32)
+            OVERLAPPED ov{};
+            ov.Offset = (DWORD)offset;
+            ov.OffsetHigh = (DWORD)(offset >> 32);
+            DWORD written = 0;
+            const DWORD chunk = size > (1u << 30) ? (1u << 30) : (DWORD)size;
+            require(WriteFile(h_, p, chunk, &written, &ov) && written > 0, "write error on sweep output");
+            const size_t n = written;
+#else
+            const ssize_t w = ::pwrite(fd_, p, size, (off_t)offset);
+            require(w > 0, "write error on sweep output");
+            const size_t n = (size_t)w;
+#endif
+            p += n;
+            size -= n;
+            offset += n;
+        }
+    }
+
+private:
+#if defined(_WIN32)
+    HANDLE h_;
+#else
+    int fd_;
+#endif
+};
+
+SweepAxisRecord toRecord(const SweepAxis& a) {
+    return SweepAxisRecord{a.from, a.to, (uint64_t)a.count, a.logSpaced ? 1u : 0u};
+}
+
+std::vector<double> axisValues(const SweepAxis& a) {
+    std::vector<double> v(a.count);
+    for (size_t i = 0; i < a.count; ++i) v[i] = a.at(i);
+    return v;
+}
+
+} // namespace
+
+double SweepAxis::at(size_t i) const {
+    if (count <= 1) return from;
+    // Pin the last point so "to" is hit exactly.
+    if (i + 1 == count) return to;
+    const double t = (double)i / (double)(count - 1);
+    return logSpaced ? from * std::pow(to / from, t) : from + (to - from) * t;
+}
+
+SweepAxis parseSweepAxis(const std::string& text, const std::string& name) {
+    require(!text.empty(), "Missing value for " + name);
+
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;) {
+        const size_t colon = text.find(':', start);
+        parts.push_back(text.substr(start, colon - start));
+        if (colon == std::string::npos) break;
+        start = colon + 1;
+    }
+
+    const auto number = [&](const std::string& s) {
+        double v = 0.0;
+        require(parseDoubleFull(s.data(), s.data() + s.size(), v), "Invalid range for " + name + ": " + text);
+        return v;
+    };
+
+    SweepAxis a;
+    if (parts.size() == 1) {
+        a.from = a.to = number(parts[0]);
+        return a;
+    }
+    require(parts.size() == 3 || (parts.size() == 4 && (parts[3] == "log" || parts[3] == "lin")),
+            "Invalid range for " + name + " (want from:to:count[:log]): " + text);
+    a.from = number(parts[0]);
+    a.to = number(parts[1]);
+    const double count = number(parts[2]);
+    require(count >= 1.0 && count == std::floor(count) && count < 4294967296.0,
+            "Invalid point count for " + name + ": " + parts[2]);
+    a.count = (size_t)count;
+    a.logSpaced = parts.size() == 4 && parts[3] == "log";
+    if (a.logSpaced) require(a.from > 0.0 && a.to > 0.0, "log range for " + name + " must be > 0");
+    return a;
+}
+
+SweepStats runSweep(const SweepSpec& spec, unsigned threads, const std::string& outputPath) {
+    const uint64_t points = spec.points();
+    require(points > 0, "empty sweep grid");
+    const uint64_t chunks = (points + kChunkPoints - 1) / kChunkPoints;
+    require(chunks <= 0xffffffffu, "sweep grid too large");
+
+    // Axis values are computed once, so every point reads the same doubles.
+    const std::vector<double> reserveA = axisValues(spec.reserveA);
+    const std::vector<double> reserveB = axisValues(spec.reserveB);
+    const std::vector<double> fee = axisValues(spec.fee);
+    const std::vector<double> amountIn = axisValues(spec.amountIn);
+    const bool aToB = spec.direction == Direction::A2B;
+    const bool stable = spec.hasAmp;
+    require(!stable || spec.amp >= 1.0, "amp must be >= 1");
+    const bool weighted = spec.hasWeightA;
+    require(!weighted || (spec.weightA > 0.0 && spec.weightA < 1.0), "weightA must be in (0, 1)");
+    require(!(stable && weighted), "amp and weightA are mutually exclusive");
+
+    std::unique_ptr<ColumnFile> file;
+    if (!outputPath.empty()) {
+        file.reset(new ColumnFile(outputPath));
+        SweepFileHeader h{};
+        std::memcpy(h.magic, "AMMSWEEP", 8);
+        h.version = 3;
+        h.columns = 2;
+        h.points = points;
+        h.direction = aToB ? 0 : 1;
+        h.axes[0] = toRecord(spec.reserveA);
+        h.axes[1] = toRecord(spec.reserveB);
+        h.axes[2] = toRecord(spec.fee);
+        h.axes[3] = toRecord(spec.amountIn);
+        h.amp = stable ? spec.amp : 0.0;
+        h.weightA = weighted ? spec.weightA : 0.0;
+        file->writeAt(&h, sizeof(h), 0);
+    }
+
+    // Same clamping as parallelFor, so stats report the threads that ran.
+    if (threads == 0) threads = defaultThreadCount();
+    threads = (unsigned)std::min<uint64_t>(threads, chunks);
+    std::vector<ChunkStats> chunkStats((size_t)chunks);
+
+    // Per-worker scratch, reused across chunks.
+    struct Scratch {
+        std::vector<double> rIn, rOut, f, amp, wIn, wOut, in, out, newIn, newOut, price, slip;
+        std::vector<uint8_t> err;
+    };
+    std::vector<Scratch> scratch(threads);
+    for (auto& s : scratch) {
+        for (auto* v : {&s.rIn, &s.rOut, &s.f, &s.in, &s.out, &s.newIn, &s.newOut, &s.price, &s.slip}) {
+            v->resize(kChunkPoints);
+        }
+        if (stable) s.amp.assign(kChunkPoints, spec.amp);
+        if (weighted) {
+            const double weightB = 1.0 - spec.weightA;
+            s.wIn.assign(kChunkPoints, aToB ? spec.weightA : weightB);
+            s.wOut.assign(kChunkPoints, aToB ? weightB : spec.weightA);
+        }
+        s.err.resize(kChunkPoints);
+    }
+
+    const uint64_t nB = spec.reserveB.count, nF = spec.fee.count, nIn = spec.amountIn.count;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    parallelFor((size_t)chunks, threads, [&](size_t chunk, unsigned worker) {
+        Scratch& s = scratch[worker];
+        const uint64_t first = (uint64_t)chunk * kChunkPoints;
+        const size_t n = (size_t)std::min<uint64_t>(kChunkPoints, points - first);
+
+        // Decode the first point once, then step the mixed-radix counter.
+        uint64_t rest = first;
+        uint64_t iIn = rest % nIn; rest /= nIn;
+        uint64_t iF = rest % nF; rest /= nF;
+        uint64_t iB = rest % nB; rest /= nB;
+        uint64_t iA = rest;
+        for (size_t k = 0; k < n; ++k) {
+            s.rIn[k] = aToB ? reserveA[iA] : reserveB[iB];
+            s.rOut[k] = aToB ? reserveB[iB] : reserveA[iA];
+            s.f[k] = fee[iF];
+            s.in[k] = amountIn[iIn];
+            if (++iIn == nIn) {
+                iIn = 0;
+                if (++iF == nF) {
+                    iF = 0;
+                    if (++iB == nB) { iB = 0; ++iA; }
+                }
+            }
+        }
+
+        const SwapBatchInput in{s.rIn.data(), s.rOut.data(), s.f.data(), s.in.data(), n};
+        const SwapBatchOutput out{s.out.data(), s.newIn.data(), s.newOut.data(), s.price.data(),
+                                  s.slip.data(), s.err.data()};
+        if (stable) {
+            simulateStableSwapBatch(in, s.amp.data(), out);
+        } else if (weighted) {
+            simulateWeightedSwapBatch(in, s.wIn.data(), s.wOut.data(), out);
+        } else {
+            simulateSwapBatch(in, out);
+        }
+
+        ChunkStats cs;
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        for (size_t k = 0; k < n; ++k) {
+            if (s.err[k] != 0) {
+                ++cs.failed;
+                s.out[k] = nan;
+                s.slip[k] = nan;
+                continue;
+            }
+            ++cs.valid;
+            cs.sum += s.slip[k];
+            cs.min = std::min(cs.min, s.slip[k]);
+            cs.max = std::max(cs.max, s.slip[k]);
+        }
+        chunkStats[chunk] = cs;
+
+        if (file) {
+            const uint64_t base = sizeof(SweepFileHeader);
+            file->writeAt(s.out.data(), n * sizeof(double), base + first * sizeof(double));
+            file->writeAt(s.slip.data(), n * sizeof(double), base + (points + first) * sizeof(double));
+        }
+    });
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // Combine in chunk order so the floating-point sum does not depend on scheduling.
+    SweepStats st;
+    st.points = points;
+    st.seconds = seconds;
+    st.threads = threads;
+    ChunkStats total;
+    for (const ChunkStats& cs : chunkStats) {
+        total.failed += cs.failed;
+        total.valid += cs.valid;
+        total.sum += cs.sum;
+        total.min = std::min(total.min, cs.min);
+        total.max = std::max(total.max, cs.max);
+    }
+    st.failed = total.failed;
+    if (total.valid > 0) {
+        st.minSlippage = total.min;
+        st.maxSlippage = total.max;
+        st.meanSlippage = total.sum / (double)total.valid;
+    }
+    return st;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "amm.h"
+
+// One axis of the sweep grid: `count` points from `from` to `to` inclusive,
+// evenly spaced (linear) or with a constant ratio (log).
+struct SweepAxis {
+    double from = 0.0;
+    double to = 0.0;
+    size_t count = 1;
+    bool logSpaced = false;
+
+    double at(size_t i) const;
+};
+
+// "value" (single point) or "from:to:count" or "from:to:count:log".
+SweepAxis parseSweepAxis(const std::string& text, const std::string& name);
+
+// Full Cartesian grid. Linear point index, amountIn varying fastest:
+//   index = ((iReserveA * nReserveB + iReserveB) * nFee + iFee) * nAmountIn + iAmountIn
+struct SweepSpec {
+    SweepAxis reserveA, reserveB, fee, amountIn;
+    Direction direction = Direction::A2B;
+    bool hasAmp = false;   // StableSwap curve (simulateStableSwapBatch); amp must be >= 1
+    double amp = 0.0;
+    bool hasWeightA = false;   // weighted pool, weights weightA : 1 - weightA; weightA in (0, 1)
+    double weightA = 0.0;
+
+    // Throws if the product of the axis counts does not fit in 64 bits.
+    uint64_t points() const {
+        const size_t counts[4] = {reserveA.count, reserveB.count, fee.count, amountIn.count};
+        uint64_t n = 1;
+        for (const size_t c : counts) {
+            require(c == 0 || n <= UINT64_MAX / c, "sweep grid size overflows 64 bits");
+            n *= c;
+        }
+        return n;
+    }
+};
+
+struct SweepStats {
+    uint64_t points = 0;
+    uint64_t failed = 0;           // invalid or pool-draining points (NaN in the output)
+    double minSlippage = 0.0;
+    double maxSlippage = 0.0;
+    double meanSlippage = 0.0;
+    double seconds = 0.0;
+    unsigned threads = 0;          // threads actually used (at most one per chunk)
+};
+
+// Evaluates every grid point with simulateSwapBatch (simulateStableSwapBatch
+// when spec.hasAmp, simulateWeightedSwapBatch when spec.hasWeightA; not
+// both), split into fixed-size chunks scheduled with parallelFor
+// (threads = 0 means all cores).
+// Results are identical for any thread count: each chunk's output depends
+// only on its index, and statistics are combined in chunk order.
+//
+// If outputPath is not empty, the surface is written there in a columnar
+// binary layout (little-endian):
+//   SweepFileHeader, then column amountOut[points], then column slippagePercent[points]
+// as float64 in point-index order.
+SweepStats runSweep(const SweepSpec& spec, unsigned threads, const std::string& outputPath);
+
+struct SweepAxisRecord {
+    double from;
+    double to;
+    uint64_t count;
+    uint64_t logSpaced;
+};
+
+struct SweepFileHeader {
+    char magic[8];              // "AMMSWEEP"
+    uint32_t version;           // 3 (2 had no weightA field, 1 no amp field)
+    uint32_t columns;           // 2: amountOut, slippagePercent
+    uint64_t points;
+    uint32_t direction;         // 0 = A2B, 1 = B2A
+    uint32_t reserved;
+    SweepAxisRecord axes[4];    // reserveA, reserveB, fee, amountIn
+    double amp;                 // 0 = constant product, else StableSwap amplification
+    double weightA;             // 0 = unweighted, else weight of token A (B has 1 - weightA)
+};
+
+static_assert(sizeof(SweepFileHeader) == 176, "SweepFileHeader layout");
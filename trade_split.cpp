@@ -0,0 +1,175 @@
+#include "trade_split.h"
+
+#include <cmath>
+
+#include "amount_out_simd.h"
+
+// Reductions keep kLanes independent partial sums so the loops vectorize
+// without -ffast-math; the sums are combined in a fixed order, so results
+// don't depend on the vector width.
+static const size_t kLanes = 8;
+
+static double combine(const double (&acc)[kLanes]) {
+    double s = 0.0;
+    for (size_t j = 0; j < kLanes; ++j) s += acc[j];
+    return s;
+}
+
+// Returns the number of invalid pools (same checks as getAmountOut).
+static size_t countInvalid(const double* reserveIn, const double* reserveOut, const double* fee, size_t n) {
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+        bad += !((reserveIn[i] > 0.0) & (reserveOut[i] > 0.0) & (fee[i] >= 0.0) & (fee[i] < 1.0));
+    }
+    return bad;
+}
+
+// weight[i] = sqrt(R*r/g), offset[i] = r/g (see solveTradeSplit).
+static void prepare(const double* __restrict reserveIn, const double* __restrict reserveOut,
+                    const double* __restrict fee, double* __restrict weight, double* __restrict offset,
+                    size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const double o = reserveIn[i] / (1.0 - fee[i]);
+        weight[i] = std::sqrt(reserveOut[i] * o);
+        offset[i] = o;
+    }
+}
+
+static double sum(const double* __restrict v, size_t n) {
+    double acc[kLanes] = {};
+    size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+        for (size_t j = 0; j < kLanes; ++j) acc[j] += v[i + j];
+    }
+    for (size_t j = 0; i < n; ++i, ++j) acc[j] += v[i];
+    return combine(acc);
+}
+
+// Copies the pools still active at mu (mu*weight > offset) to the front of
+// outWeight/outOffset (which may be the inputs) and returns their count.
+static size_t compactActive(const double* weight, const double* offset, size_t n, double mu,
+                            double* outWeight, double* outOffset) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const double w = weight[i], o = offset[i];
+        outWeight[k] = w;
+        outOffset[k] = o;
+        k += (mu * w > o);
+    }
+    return k;
+}
+
+// allocation[i] = max(0, mu*weight[i] - offset[i]); returns their sum.
+// allocation may alias weight (each lane reads its weight before writing).
+static double shares(const double* weight, const double* __restrict offset, size_t n, double mu,
+                     double* allocation) {
+    double acc[kLanes] = {};
+    size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+        for (size_t j = 0; j < kLanes; ++j) {
+            const double x = mu * weight[i + j] - offset[i + j];
+            allocation[i + j] = x > 0.0 ? x : 0.0;
+            acc[j] += allocation[i + j];
+        }
+    }
+    for (size_t j = 0; i < n; ++i, ++j) {
+        const double x = mu * weight[i] - offset[i];
+        allocation[i] = x > 0.0 ? x : 0.0;
+        acc[j] += allocation[i];
+    }
+    return combine(acc);
+}
+
+double solveTradeSplit(const SplitPoolsInput& pools, double amountIn, double* allocation) {
+    const size_t n = pools.count;
+    require(n > 0, "no pools to split across");
+    require(amountIn > 0.0, "amountIn must be > 0");
+
+    require(countInvalid(pools.reserveIn, pools.reserveOut, pools.fee, n) == 0,
+            "reserves must be > 0 and fee in [0, 1) for every pool");
+
+    std::vector<double> scratch(3 * n);
+    double* weight = allocation;   // reused as scratch until the final pass
+    double* offset = scratch.data();
+    prepare(pools.reserveIn, pools.reserveOut, pools.fee, weight, offset, n);
+
+    // Start with every pool active. A pool that drops out never comes back,
+    // so the active set is compacted each pass and the sums run over an
+    // ever smaller prefix.
+    double* activeWeight = scratch.data() + n;
+    double* activeOffset = scratch.data() + 2 * n;
+    double mu = (amountIn + sum(offset, n)) / sum(weight, n);
+    size_t active = compactActive(weight, offset, n, mu, activeWeight, activeOffset);
+    size_t last = n;
+    while (active != last && active > 0) {
+        mu = (amountIn + sum(activeOffset, active)) / sum(activeWeight, active);
+        last = active;
+        active = compactActive(activeWeight, activeOffset, active, mu, activeWeight, activeOffset);
+    }
+
+    if (active == 0) {
+        // amountIn is below one ulp of every offset, so no share survives
+        // rounding: it all goes to the pool with the best marginal price
+        // (largest weight/offset).
+        size_t best = 0;
+        for (size_t i = 1; i < n; ++i) {
+            if (weight[i] / offset[i] > weight[best] / offset[best]) best = i;
+        }
+        for (size_t i = 0; i < n; ++i) allocation[i] = 0.0;
+        allocation[best] = amountIn;
+    } else {
+        // Shares, then hand the rounding residue to the largest one so the
+        // shares sum to amountIn.
+        const double sumShares = shares(weight, offset, n, mu, allocation);
+        size_t largest = 0;
+        for (size_t i = 1; i < n; ++i) {
+            if (allocation[i] > allocation[largest]) largest = i;
+        }
+        allocation[largest] += amountIn - sumShares;
+    }
+
+    // Zero shares price to exactly 0, so the whole column can go through
+    // the dispatched SIMD kernel.
+    double* amountOut = scratch.data() + n;
+    getAmountOutBatch(allocation, pools.reserveIn, pools.reserveOut, pools.fee, amountOut, n);
+    return sum(amountOut, n);
+}
+
+TradeSplit splitTrade(const PoolRegistry& reg, TokenId tokenIn, TokenId tokenOut, double amountIn) {
+    TradeSplit split;
+    split.amountIn = amountIn;
+
+    std::vector<PoolId> ids;
+    std::vector<double> reserveIn, reserveOut, fee;
+    for (PoolId id = reg.findPool(tokenIn, tokenOut); id != kNoPool; id = reg.pool(id).nextSamePair) {
+        const Pool& p = reg.pool(id);
+        if (reg.kind(id) != PoolKind::ConstantProduct) continue;   // the split solver is x*y=k only
+        const bool aToB = (p.tokenA == tokenIn);
+        ids.push_back(id);
+        reserveIn.push_back(aToB ? p.reserveA : p.reserveB);
+        reserveOut.push_back(aToB ? p.reserveB : p.reserveA);
+        fee.push_back(p.fee);
+    }
+    require(!ids.empty(), "no constant-product pool lists this token pair");
+
+    std::vector<double> allocation(ids.size());
+    SplitPoolsInput in;
+    in.reserveIn = reserveIn.data();
+    in.reserveOut = reserveOut.data();
+    in.fee = fee.data();
+    in.count = ids.size();
+    solveTradeSplit(in, amountIn, allocation.data());
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (allocation[i] <= 0.0) continue;
+        const Pool& p = reg.pool(ids[i]);
+        PoolSplit s;
+        s.pool = ids[i];
+        s.direction = reg.directionFor(ids[i], tokenIn);
+        s.amountIn = allocation[i];
+        s.result = simulateSwap(p.reserveA, p.reserveB, p.fee, s.direction, allocation[i]);
+        split.amountOut += s.result.amountOut;
+        split.pools.push_back(s);
+    }
+    return split;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "pool_registry.h"
+
+// Parallel pools quoting the same pair, direction already resolved
+// (reserveIn is the side the trader pays into). Same columns as
+// SwapBatchInput without amountIn.
+struct SplitPoolsInput {
+    const double* reserveIn{};
+    const double* reserveOut{};
+    const double* fee{};
+    size_t count{};
+};
+
+// Output-maximizing split of amountIn over the pools. With g = 1 - fee,
+// each pool's marginal output is g*R*r / (r + g*x)^2, so at the optimum
+// every pool that gets a share has the same marginal 1/mu^2:
+//   x_i = max(0, mu*sqrt(R_i*r_i/g_i) - r_i/g_i)
+// mu follows from sum(x_i) = amountIn over the active set; pools whose spot
+// marginal is below the common one drop out and mu is recomputed until the
+// set is stable. The set only shrinks, so each pass works on a compacted,
+// smaller prefix; the arithmetic passes are vectorized.
+// Fills allocation[i] (>= 0, summing to amountIn) and returns the total
+// output. Throws on invalid pools, like getAmountOut.
+double solveTradeSplit(const SplitPoolsInput& pools, double amountIn, double* allocation);
+
+// One pool's share of a split trade.
+struct PoolSplit {
+    PoolId pool = kNoPool;
+    Direction direction = Direction::A2B;
+    double amountIn = 0.0;
+    SwapResult result{};
+};
+
+struct TradeSplit {
+    std::vector<PoolSplit> pools;   // only pools with a non-zero share
+    double amountIn = 0.0;
+    double amountOut = 0.0;
+};
+
+// Splits amountIn over every constant-product registry pool listing
+// (tokenIn, tokenOut) and prices each share with simulateSwap. Reserves
+// are not modified.
+TradeSplit splitTrade(const PoolRegistry& reg, TokenId tokenIn, TokenId tokenOut, double amountIn);
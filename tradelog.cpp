@@ -0,0 +1,144 @@
+#include "tradelog.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "line_reader.h"
+
+MappedFile::MappedFile(const std::string& path) {
+#if defined(_WIN32)
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    require(f != INVALID_HANDLE_VALUE, "cannot open " + path);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(f, &size)) {
+        CloseHandle(f);
+        throw std::runtime_error("cannot stat " + path);
+    }
+    file_ = f;
+    size_ = (size_t)size.QuadPart;
+    if (size_ == 0) return;
+    mapping_ = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    require(mapping_ != nullptr, "cannot map " + path);
+    data_ = (const unsigned char*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    require(data_ != nullptr, "cannot map " + path);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    require(fd >= 0, "cannot open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot stat " + path);
+    }
+    size_ = (size_t)st.st_size;
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("cannot map " + path);
+        }
+        // Records are consumed front to back: ask for aggressive read-ahead.
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = (const unsigned char*)p;
+    }
+    ::close(fd);   // the mapping keeps the file referenced
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if defined(_WIN32)
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+#else
+    if (data_) ::munmap((void*)data_, size_);
+#endif
+}
+
+TradeLogView::TradeLogView(const std::string& path) : file_(path) {
+    require(file_.size() >= sizeof(TradeLogHeader), path + ": too small for a trade log header");
+
+    TradeLogHeader h;
+    std::memcpy(&h, file_.data(), sizeof(h));
+    require(std::memcmp(h.magic, kTradeLogMagic, sizeof(h.magic)) == 0, path + ": not a binary trade log");
+    require(h.version == kTradeLogVersion, path + ": unsupported trade log version " + std::to_string(h.version));
+    require(h.recordSize == sizeof(TradeRecord), path + ": unexpected record size");
+    require(h.recordCount <= (file_.size() - sizeof(TradeLogHeader)) / sizeof(TradeRecord),
+            path + ": truncated (header says " + std::to_string(h.recordCount) + " records)");
+
+    records_ = reinterpret_cast<const TradeRecord*>(file_.data() + sizeof(TradeLogHeader));
+    count_ = (size_t)h.recordCount;
+}
+
+bool isBinaryTradeLog(const std::string& path) {
+    if (path == "-") return false;
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char magic[sizeof(kTradeLogMagic)];
+    const bool ok = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                    std::memcmp(magic, kTradeLogMagic, sizeof(magic)) == 0;
+    std::fclose(f);
+    return ok;
+}
+
+uint64_t convertTradeLog(const std::string& csvPath, const std::string& binPath) {
+    std::FILE* in = openInput(csvPath);
+    FileCloser inCloser{in};
+
+    std::FILE* out = std::fopen(binPath.c_str(), "wb");
+    require(out != nullptr, "cannot create " + binPath);
+    FileCloser outCloser{out};
+
+    // Header first with a zero count; patched once the count is known.
+    TradeLogHeader h{};
+    std::memcpy(h.magic, kTradeLogMagic, sizeof(h.magic));
+    h.version = kTradeLogVersion;
+    h.recordSize = sizeof(TradeRecord);
+    require(std::fwrite(&h, sizeof(h), 1, out) == 1, "write error on " + binPath);
+
+    // Records are staged and written in large chunks.
+    std::vector<TradeRecord> chunk;
+    chunk.reserve(1 << 16);
+    const auto flush = [&] {
+        if (!chunk.empty()) {
+            require(std::fwrite(chunk.data(), sizeof(TradeRecord), chunk.size(), out) == chunk.size(),
+                    "write error on " + binPath);
+        }
+        h.recordCount += chunk.size();
+        chunk.clear();
+    };
+
+    forEachLine(in, [&](LineCursor& c, uint64_t lineNo) {
+        uint64_t poolId = 0, timestamp = 0;
+        Direction dir = Direction::A2B;
+        double amountIn = 0.0;
+        if (!parseTradeLine(c, lineNo, poolId, dir, amountIn, timestamp)) return;
+        if (poolId > 0xffffffffu) lineError(lineNo, "pool id does not fit in 32 bits");
+
+        TradeRecord r{};
+        r.amountIn = amountIn;
+        r.timestamp = timestamp;
+        r.poolId = (uint32_t)poolId;
+        r.direction = dir == Direction::A2B ? 0 : 1;
+        chunk.push_back(r);
+        if (chunk.size() == chunk.capacity()) flush();
+    });
+    flush();
+
+    require(std::fseek(out, 0, SEEK_SET) == 0 && std::fwrite(&h, sizeof(h), 1, out) == 1,
+            "write error on " + binPath);
+    require(std::fflush(out) == 0, "write error on " + binPath);
+    return h.recordCount;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Binary trade log, version 1 (little-endian):
+//   TradeLogHeader (32 bytes), then recordCount packed TradeRecords (24 bytes each).
+// Records are 8-byte aligned in the file, so a mapping of the file can be
+// read as a TradeRecord array without copying.
+
+const char kTradeLogMagic[8] = {'A', 'M', 'M', 'T', 'L', 'O', 'G', '\0'};
+const uint32_t kTradeLogVersion = 1;
+
+struct TradeLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;     // sizeof(TradeRecord), lets readers reject other layouts
+    uint64_t recordCount;
+    uint64_t reserved;
+};
+
+struct TradeRecord {
+    double amountIn;
+    uint64_t timestamp;      // opaque to the simulator (e.g. unix ns or block number)
+    uint32_t poolId;
+    uint8_t direction;       // 0 = A2B, 1 = B2A
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(TradeLogHeader) == 32, "TradeLogHeader layout");
+static_assert(sizeof(TradeRecord) == 24, "TradeRecord layout");
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile).
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+// Zero-copy view of a mapped trade log; the header is validated on open.
+class TradeLogView {
+public:
+    explicit TradeLogView(const std::string& path);
+
+    size_t size() const { return count_; }
+    const TradeRecord* begin() const { return records_; }
+    const TradeRecord* end() const { return records_ + count_; }
+
+private:
+    MappedFile file_;
+    const TradeRecord* records_ = nullptr;
+    size_t count_ = 0;
+};
+
+// True if path exists and starts with kTradeLogMagic.
+bool isBinaryTradeLog(const std::string& path);
+
+// Converts a text trade log (poolId,direction,amountIn[,timestamp] lines,
+// "-" for stdin) into the binary format. Returns the number of records.
+uint64_t convertTradeLog(const std::string& csvPath, const std::string& binPath);
@@ -0,0 +1,39 @@
+#include "tsc.h"
+
+#include <chrono>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AMM_X86_TSC 1
+#include <x86intrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define AMM_X86_TSC 1
+#include <intrin.h>
+#endif
+
+uint64_t readTsc() {
+#ifdef AMM_X86_TSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static double measureTscHz() {
+#ifdef AMM_X86_TSC
+    using Clock = std::chrono::steady_clock;
+    const auto t0 = Clock::now();
+    const uint64_t c0 = readTsc();
+    auto t1 = t0;
+    while (t1 - t0 < std::chrono::milliseconds(20)) t1 = Clock::now();
+    const uint64_t c1 = readTsc();
+    return (double)(c1 - c0) / std::chrono::duration<double>(t1 - t0).count();
+#else
+    return 1e9;
+#endif
+}
+
+double tscHz() {
+    static const double hz = measureTscHz();
+    return hz;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// Time-stamp counter, for timing short code paths where a clock call would
+// cost more than the code being timed.
+//
+// On x86 this is rdtsc: a constant-rate counter (reference cycles at the
+// nominal clock), not core cycles, so it does not follow turbo or
+// throttling. Elsewhere it falls back to steady_clock nanoseconds.
+uint64_t readTsc();
+
+// Counter ticks per second, measured once against steady_clock (the first
+// call blocks for about 20 ms).
+double tscHz();
@@ -0,0 +1,336 @@
+#include "uint256.h"
+
+#include <cmath>
+#include <stdexcept>
+
+int Uint256::bitLength() const {
+    for (int i = 3; i >= 0; --i) {
+        uint64_t v = limb[i];
+        if (v == 0) continue;
+        int bits = 0;
+        while (v) { ++bits; v >>= 1; }
+        return i * 64 + bits;
+    }
+    return 0;
+}
+
+double Uint256::toDouble() const {
+    double r = 0.0;
+    for (int i = 3; i >= 0; --i) r = r * 18446744073709551616.0 + (double)limb[i];
+    return r;
+}
+
+Uint256 Uint256::fromDouble(double v) {
+    if (!(v >= 0.0 && v < 1.157920892373162e77)) throw std::runtime_error("value does not fit in 256 bits");
+    if (v < 1.0) return Uint256();
+    int exp = 0;
+    const double m = std::frexp(v, &exp);   // v = m * 2^exp, m in [0.5, 1)
+    const Uint256 mantissa((uint64_t)std::ldexp(m, 53));
+    return exp >= 53 ? shiftLeft(mantissa, (unsigned)(exp - 53)) : shiftRight(mantissa, (unsigned)(53 - exp));
+}
+
+Uint256 Uint256::fromDecimal(const std::string& s) {
+    if (s.empty()) throw std::runtime_error("empty integer");
+    Uint256 r;
+    bool overflow = false;
+    for (char c : s) {
+        if (c < '0' || c > '9') throw std::runtime_error("invalid integer: " + s);
+        r = addChecked(mulSmallChecked(r, 10, overflow), Uint256((uint64_t)(c - '0')), overflow);
+    }
+    if (overflow) throw std::runtime_error("integer does not fit in 256 bits: " + s);
+    return r;
+}
+
+std::string Uint256::toDecimal() const {
+    if (isZero()) return "0";
+
+    // Peel off 19 decimal digits at a time (10^19 is the largest power of ten in 64 bits).
+    const uint64_t chunk = 10000000000000000000ull;
+    std::string out;
+    Uint256 v = *this;
+    while (!v.isZero()) {
+        Uint256 rem;
+        v = divFloor(v, Uint256(chunk), &rem);
+        uint64_t part = rem.limb[0];
+        for (int i = 0; i < 19; ++i) {
+            out.push_back((char)('0' + part % 10));
+            part /= 10;
+            if (v.isZero() && part == 0) break;
+        }
+    }
+    return std::string(out.rbegin(), out.rend());
+}
+
+#if defined(__SIZEOF_INT128__)
+
+// (hi:lo) / d for hi < d, so the quotient fits in 64 bits.
+static inline uint64_t div128by64(uint64_t hi, uint64_t lo, uint64_t d, uint64_t& rem) {
+#if defined(__x86_64__)
+    uint64_t q;
+    __asm__("divq %4" : "=a"(q), "=d"(rem) : "a"(lo), "d"(hi), "rm"(d));
+    return q;
+#else
+    const unsigned __int128 n = ((unsigned __int128)hi << 64) | lo;
+    const uint64_t q = (uint64_t)(n / d);
+    rem = (uint64_t)(n - (unsigned __int128)q * d);
+    return q;
+#endif
+}
+
+// Knuth, TAOCP vol. 2, 4.3.1, algorithm D (layout follows Hacker's Delight divmnu)
+// on 64-bit limbs with 128-bit intermediates.
+// u has m <= 8 limbs, v has n <= 4 limbs with v[n-1] != 0 and m >= n.
+static void divLimbs(const uint64_t* u, int m, const uint64_t* v, int n, uint64_t* q, uint64_t* r) {
+    typedef unsigned __int128 u128;
+    typedef __int128 s128;
+    const u128 b = (u128)1 << 64;
+
+    if (n == 1) {
+        uint64_t k = 0;
+        for (int j = m - 1; j >= 0; --j) q[j] = div128by64(k, u[j], v[0], k);
+        r[0] = k;
+        return;
+    }
+
+    const int s = __builtin_clzll(v[n - 1]);
+    uint64_t vn[4];
+    uint64_t un[9];
+    for (int i = n - 1; i > 0; --i) {
+        vn[i] = (v[i] << s) | (uint64_t)(((u128)v[i - 1]) >> (64 - s));
+    }
+    vn[0] = v[0] << s;
+    un[m] = (uint64_t)(((u128)u[m - 1]) >> (64 - s));
+    for (int i = m - 1; i > 0; --i) {
+        un[i] = (u[i] << s) | (uint64_t)(((u128)u[i - 1]) >> (64 - s));
+    }
+    un[0] = u[0] << s;
+
+    for (int j = m - n; j >= 0; --j) {
+        // Estimate the quotient digit and correct it (at most twice).
+        // un[j+n] <= vn[n-1] always; equality means the estimate is b-1.
+        u128 qhat, rhat;
+        if (un[j + n] < vn[n - 1]) {
+            uint64_t rem;
+            qhat = div128by64(un[j + n], un[j + n - 1], vn[n - 1], rem);
+            rhat = rem;
+        } else {
+            qhat = b - 1;
+            rhat = (u128)un[j + n - 1] + vn[n - 1];
+        }
+        while (rhat < b && qhat * vn[n - 2] > ((rhat << 64) | un[j + n - 2])) {
+            --qhat;
+            rhat += vn[n - 1];
+        }
+
+        s128 t = 0;
+        u128 k = 0;
+        for (int i = 0; i < n; ++i) {
+            const u128 p = qhat * vn[i];
+            t = (s128)un[i + j] - (s128)k - (s128)(uint64_t)p;
+            un[i + j] = (uint64_t)t;
+            k = (p >> 64) - (u128)(t >> 64);
+        }
+        t = (s128)un[j + n] - (s128)k;
+        un[j + n] = (uint64_t)t;
+
+        q[j] = (uint64_t)qhat;
+        if (t < 0) {
+            // Estimate was one too large: add the divisor back.
+            --q[j];
+            k = 0;
+            for (int i = 0; i < n; ++i) {
+                const u128 sum = (u128)un[i + j] + vn[i] + k;
+                un[i + j] = (uint64_t)sum;
+                k = sum >> 64;
+            }
+            un[j + n] = (uint64_t)(un[j + n] + (uint64_t)k);
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        r[i] = (uint64_t)((((u128)un[i + 1] << 64) | un[i]) >> s);
+    }
+}
+
+#else
+
+static void toDigits(const Uint256& a, uint32_t d[8]) {
+    for (int i = 0; i < 4; ++i) {
+        d[2 * i] = (uint32_t)a.limb[i];
+        d[2 * i + 1] = (uint32_t)(a.limb[i] >> 32);
+    }
+}
+
+static Uint256 fromDigits(const uint32_t d[8]) {
+    Uint256 r;
+    for (int i = 0; i < 4; ++i) r.limb[i] = (uint64_t)d[2 * i] | ((uint64_t)d[2 * i + 1] << 32);
+    return r;
+}
+
+static int significantDigits(const uint32_t d[8]) {
+    int n = 8;
+    while (n > 0 && d[n - 1] == 0) --n;
+    return n;
+}
+
+static int leadingZeros32(uint32_t x) {
+    int n = 0;
+    while ((x & 0x80000000u) == 0) { ++n; x <<= 1; }
+    return n;
+}
+
+// Portable fallback: the same algorithm on 32-bit digits.
+// u has m <= 16 digits, v has n <= 8 digits with v[n-1] != 0 and m >= n.
+static void divDigits(const uint32_t* u, int m, const uint32_t* v, int n, uint32_t* q, uint32_t* r) {
+    const uint64_t b = 1ull << 32;
+
+    if (n == 1) {
+        uint64_t k = 0;
+        for (int j = m - 1; j >= 0; --j) {
+            const uint64_t cur = k * b + u[j];
+            q[j] = (uint32_t)(cur / v[0]);
+            k = cur - (uint64_t)q[j] * v[0];
+        }
+        r[0] = (uint32_t)k;
+        return;
+    }
+
+    // Normalize so the top divisor digit has its high bit set.
+    const int s = leadingZeros32(v[n - 1]);
+    uint32_t vn[8];
+    uint32_t un[17];
+    for (int i = n - 1; i > 0; --i) {
+        vn[i] = (uint32_t)(((uint64_t)v[i] << s) | ((uint64_t)v[i - 1] >> (32 - s)));
+    }
+    vn[0] = v[0] << s;
+    un[m] = (uint32_t)((uint64_t)u[m - 1] >> (32 - s));
+    for (int i = m - 1; i > 0; --i) {
+        un[i] = (uint32_t)(((uint64_t)u[i] << s) | ((uint64_t)u[i - 1] >> (32 - s)));
+    }
+    un[0] = u[0] << s;
+
+    for (int j = m - n; j >= 0; --j) {
+        // Estimate the quotient digit and correct it (at most twice).
+        const uint64_t top = (uint64_t)un[j + n] * b + un[j + n - 1];
+        uint64_t qhat = top / vn[n - 1];
+        uint64_t rhat = top - qhat * vn[n - 1];
+        while (qhat >= b || qhat * vn[n - 2] > b * rhat + un[j + n - 2]) {
+            --qhat;
+            rhat += vn[n - 1];
+            if (rhat >= b) break;
+        }
+
+        // Multiply and subtract.
+        int64_t t = 0;
+        uint64_t k = 0;
+        for (int i = 0; i < n; ++i) {
+            const uint64_t p = qhat * vn[i];
+            t = (int64_t)un[i + j] - (int64_t)k - (int64_t)(p & 0xffffffffu);
+            un[i + j] = (uint32_t)t;
+            k = (p >> 32) - (uint64_t)(t >> 32);
+        }
+        t = (int64_t)un[j + n] - (int64_t)k;
+        un[j + n] = (uint32_t)t;
+
+        q[j] = (uint32_t)qhat;
+        if (t < 0) {
+            // Estimate was one too large: add the divisor back.
+            --q[j];
+            k = 0;
+            for (int i = 0; i < n; ++i) {
+                const uint64_t sum = (uint64_t)un[i + j] + vn[i] + k;
+                un[i + j] = (uint32_t)sum;
+                k = sum >> 32;
+            }
+            un[j + n] = (uint32_t)(un[j + n] + k);
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        r[i] = (uint32_t)(((uint64_t)un[i] >> s) | ((uint64_t)un[i + 1] << (32 - s)));
+    }
+}
+
+#endif // __SIZEOF_INT128__
+
+Uint256 divFloor(const Uint256& n, const Uint256& d, Uint256* remainder) {
+    if (d.isZero()) throw std::runtime_error("division by zero");
+
+    if (n < d) {
+        if (remainder) *remainder = n;
+        return Uint256();
+    }
+
+#if defined(__SIZEOF_INT128__)
+    // Both operands fit in 128 bits: one native division.
+    if ((n.limb[2] | n.limb[3] | d.limb[2] | d.limb[3]) == 0) {
+        const unsigned __int128 a = ((unsigned __int128)n.limb[1] << 64) | n.limb[0];
+        const unsigned __int128 b = ((unsigned __int128)d.limb[1] << 64) | d.limb[0];
+        const unsigned __int128 q = a / b;
+        if (remainder) {
+            const unsigned __int128 r = a - q * b;
+            *remainder = Uint256((uint64_t)r);
+            remainder->limb[1] = (uint64_t)(r >> 64);
+        }
+        Uint256 out((uint64_t)q);
+        out.limb[1] = (uint64_t)(q >> 64);
+        return out;
+    }
+
+    int m = 4, k = 4;
+    while (n.limb[m - 1] == 0) --m;
+    while (d.limb[k - 1] == 0) --k;
+    Uint256 q, r;
+    divLimbs(n.limb, m, d.limb, k, q.limb, r.limb);
+    if (remainder) *remainder = r;
+    return q;
+#else
+    uint32_t u[8], v[8], q[8]{}, r[8]{};
+    toDigits(n, u);
+    toDigits(d, v);
+    divDigits(u, significantDigits(u), v, significantDigits(v), q, r);
+
+    if (remainder) *remainder = fromDigits(r);
+    return fromDigits(q);
+#endif
+}
+
+Uint256 mulDiv(const Uint256& a, const Uint256& b, const Uint256& d, bool roundUp, bool& overflow) {
+    if (d.isZero()) throw std::runtime_error("division by zero");
+
+    uint64_t p[8];
+    mulFull(a, b, p);
+    Uint256 q, r;
+    if ((p[4] | p[5] | p[6] | p[7]) == 0) {
+        const Uint256 lo = Uint256::fromLimbs(p);
+        q = divFloor(lo, d, &r);
+    } else {
+        // The quotient fits in 256 bits iff the high half is below d.
+        if (!(Uint256::fromLimbs(p + 4) < d)) {
+            overflow = true;
+            return Uint256();
+        }
+#if defined(__SIZEOF_INT128__)
+        int m = 8, k = 4;
+        while (p[m - 1] == 0) --m;
+        while (d.limb[k - 1] == 0) --k;
+        uint64_t qLimbs[8]{};
+        divLimbs(p, m, d.limb, k, qLimbs, r.limb);
+        q = Uint256::fromLimbs(qLimbs);
+#else
+        uint32_t u[16], v[8], qd[16]{}, rd[8]{};
+        for (int i = 0; i < 8; ++i) {
+            u[2 * i] = (uint32_t)p[i];
+            u[2 * i + 1] = (uint32_t)(p[i] >> 32);
+        }
+        toDigits(d, v);
+        int m = 16;
+        while (u[m - 1] == 0) --m;
+        divDigits(u, m, v, significantDigits(v), qd, rd);
+        q = fromDigits(qd);
+        r = fromDigits(rd);
+#endif
+    }
+    if (roundUp && !r.isZero()) q = addChecked(q, Uint256(1), overflow);
+    return q;
+}
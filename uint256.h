@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Fixed-width 256-bit unsigned integer (4 x 64-bit limbs, little-endian).
+// No heap allocation; the operations needed by the exact swap math are
+// inline so the hot path compiles to straight limb arithmetic.
+struct Uint256 {
+    uint64_t limb[4]{};   // limb[0] is least significant
+
+    Uint256() = default;
+    Uint256(uint64_t v) : limb{v, 0, 0, 0} {}
+
+    static Uint256 fromLimbs(const uint64_t* l) {
+        Uint256 r;
+        for (int i = 0; i < 4; ++i) r.limb[i] = l[i];
+        return r;
+    }
+
+    bool isZero() const { return (limb[0] | limb[1] | limb[2] | limb[3]) == 0; }
+
+    // Number of significant bits (0 for zero).
+    int bitLength() const;
+
+    // Nearest double (truncated to 53 bits, good enough for reporting).
+    double toDouble() const;
+
+    // Floor of a double in [0, 2^256); throws on anything else.
+    static Uint256 fromDouble(double v);
+
+    // Decimal text <-> value. fromDecimal throws on junk or overflow.
+    static Uint256 fromDecimal(const std::string& s);
+    std::string toDecimal() const;
+};
+
+inline bool operator==(const Uint256& a, const Uint256& b) {
+    return a.limb[0] == b.limb[0] && a.limb[1] == b.limb[1] &&
+           a.limb[2] == b.limb[2] && a.limb[3] == b.limb[3];
+}
+inline bool operator!=(const Uint256& a, const Uint256& b) { return !(a == b); }
+
+inline bool operator<(const Uint256& a, const Uint256& b) {
+    for (int i = 3; i >= 0; --i) {
+        if (a.limb[i] != b.limb[i]) return a.limb[i] < b.limb[i];
+    }
+    return false;
+}
+inline bool operator>(const Uint256& a, const Uint256& b) { return b < a; }
+inline bool operator<=(const Uint256& a, const Uint256& b) { return !(b < a); }
+inline bool operator>=(const Uint256& a, const Uint256& b) { return !(a < b); }
+
+// 64 x 64 -> 128 bit multiply, result as (hi, lo).
+inline uint64_t mulWide(uint64_t a, uint64_t b, uint64_t& hi) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 p = (unsigned __int128)a * b;
+    hi = (uint64_t)(p >> 64);
+    return (uint64_t)p;
+#else
+    const uint64_t aLo = a & 0xffffffffu, aHi = a >> 32;
+    const uint64_t bLo = b & 0xffffffffu, bHi = b >> 32;
+    const uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+    const uint64_t mid = (ll >> 32) + (lh & 0xffffffffu) + (hl & 0xffffffffu);
+    hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    return (mid << 32) | (ll & 0xffffffffu);
+#endif
+}
+
+// a + b; sets overflow if the sum does not fit in 256 bits.
+inline Uint256 addChecked(const Uint256& a, const Uint256& b, bool& overflow) {
+    Uint256 r;
+    uint64_t carry = 0;
+    for (int i = 0; i < 4; ++i) {
+        const uint64_t s = a.limb[i] + b.limb[i];
+        const uint64_t c1 = s < a.limb[i];
+        r.limb[i] = s + carry;
+        carry = c1 | (r.limb[i] < s);
+    }
+    overflow |= carry != 0;
+    return r;
+}
+
+// a - b; sets underflow if b > a.
+inline Uint256 subChecked(const Uint256& a, const Uint256& b, bool& underflow) {
+    Uint256 r;
+    uint64_t borrow = 0;
+    for (int i = 0; i < 4; ++i) {
+        const uint64_t d = a.limb[i] - b.limb[i];
+        const uint64_t b1 = a.limb[i] < b.limb[i];
+        r.limb[i] = d - borrow;
+        borrow = b1 | (d < borrow);
+    }
+    underflow |= borrow != 0;
+    return r;
+}
+
+// Full 512-bit product a * b into acc[0..7] (least significant first).
+inline void mulFull(const Uint256& a, const Uint256& b, uint64_t acc[8]) {
+    for (int i = 0; i < 8; ++i) acc[i] = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (a.limb[i] == 0) continue;
+        uint64_t carry = 0;
+        for (int j = 0; j < 4; ++j) {
+            uint64_t hi;
+            const uint64_t lo = mulWide(a.limb[i], b.limb[j], hi);
+            uint64_t t = acc[i + j] + lo;
+            hi += t < lo;
+            t += carry;
+            hi += t < carry;
+            acc[i + j] = t;
+            carry = hi;
+        }
+        acc[i + 4] = carry;
+    }
+}
+
+// a * b; sets overflow if the product does not fit in 256 bits.
+inline Uint256 mulChecked(const Uint256& a, const Uint256& b, bool& overflow) {
+    uint64_t acc[8];
+    mulFull(a, b, acc);
+    overflow |= (acc[4] | acc[5] | acc[6] | acc[7]) != 0;
+    return Uint256::fromLimbs(acc);
+}
+
+// a << s and a >> s for s < 256; bits shifted out are dropped.
+inline Uint256 shiftLeft(const Uint256& a, unsigned s) {
+    Uint256 r;
+    const unsigned limbs = s / 64, bits = s % 64;
+    for (int i = 3; i >= (int)limbs; --i) {
+        const unsigned src = (unsigned)i - limbs;
+        r.limb[i] = a.limb[src] << bits;
+        if (bits != 0 && src > 0) r.limb[i] |= a.limb[src - 1] >> (64 - bits);
+    }
+    return r;
+}
+
+inline Uint256 shiftRight(const Uint256& a, unsigned s) {
+    Uint256 r;
+    const unsigned limbs = s / 64, bits = s % 64;
+    for (unsigned i = 0; i + limbs < 4; ++i) {
+        const unsigned src = i + limbs;
+        r.limb[i] = a.limb[src] >> bits;
+        if (bits != 0 && src < 3) r.limb[i] |= a.limb[src + 1] << (64 - bits);
+    }
+    return r;
+}
+
+// a * m for a small multiplier (fee numerators/denominators).
+inline Uint256 mulSmallChecked(const Uint256& a, uint64_t m, bool& overflow) {
+    Uint256 r;
+    uint64_t carry = 0;
+    for (int i = 0; i < 4; ++i) {
+        uint64_t hi;
+        const uint64_t lo = mulWide(a.limb[i], m, hi);
+        r.limb[i] = lo + carry;
+        carry = hi + (r.limb[i] < lo);
+    }
+    overflow |= carry != 0;
+    return r;
+}
+
+// Floor division: one native 128-bit division when both operands fit,
+// otherwise Knuth algorithm D on 64-bit limbs (32-bit digits where the
+// compiler has no 128-bit integers). d must be non-zero (throws).
+Uint256 divFloor(const Uint256& n, const Uint256& d, Uint256* remainder = nullptr);
+
+// a * b / d with a 512-bit intermediate, rounded down or up (Uniswap v3
+// FullMath.mulDiv / mulDivRoundingUp). Sets overflow if the quotient does
+// not fit in 256 bits. d must be non-zero.
+Uint256 mulDiv(const Uint256& a, const Uint256& b, const Uint256& d, bool roundUp, bool& overflow);
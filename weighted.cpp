@@ -0,0 +1,86 @@
+#include "weighted.h"
+
+#include "fast_math.h"
+
+namespace {
+
+// Lanes per pass in getAmountOutWeightedBatch: three scratch columns of
+// this size stay in L1 between the passes.
+const size_t kChunk = 256;
+
+} // namespace
+
+double getAmountOutWeighted(double amountIn, double reserveIn, double reserveOut, double fee,
+                            double weightIn, double weightOut) {
+    require(amountIn > 0.0, "amountIn must be > 0");
+    require(reserveIn > 0.0 && reserveOut > 0.0, "reserves must be > 0");
+    require(fee >= 0.0 && fee < 1.0, "fee must be in [0, 1)");
+    require(weightIn > 0.0 && weightOut > 0.0, "weights must be > 0");
+
+    const double growth = amountIn * (1.0 - fee) / reserveIn;
+    const double exponent = -(weightIn / weightOut) * fastLog1p(growth);
+    return -reserveOut * fastExpm1(exponent);
+}
+
+double weightedSpotPrice(double reserveIn, double reserveOut, double weightIn, double weightOut) {
+    require(reserveIn > 0.0 && reserveOut > 0.0, "reserves must be > 0");
+    require(weightIn > 0.0 && weightOut > 0.0, "weights must be > 0");
+    return (reserveOut / weightOut) / (reserveIn / weightIn);
+}
+
+void getAmountOutWeightedBatch(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                               const double* fee, const double* weightIn, const double* weightOut,
+                               double* amountOut, size_t n) {
+    double scratch[kChunk];
+    for (size_t base = 0; base < n; base += kChunk) {
+        const size_t m = (n - base < kChunk) ? n - base : kChunk;
+        const double* a = amountIn + base;
+        const double* rIn = reserveIn + base;
+        const double* f = fee + base;
+        const double* wIn = weightIn + base;
+        const double* wOut = weightOut + base;
+        double* out = amountOut + base;
+
+        for (size_t i = 0; i < m; ++i) scratch[i] = a[i] * (1.0 - f[i]) / rIn[i];
+        fastLog1pBatch(scratch, scratch, m);
+        for (size_t i = 0; i < m; ++i) scratch[i] = -(wIn[i] / wOut[i]) * scratch[i];
+        fastExpm1Batch(scratch, scratch, m);
+        const double* rOut = reserveOut + base;
+        for (size_t i = 0; i < m; ++i) out[i] = -rOut[i] * scratch[i];
+    }
+}
+
+size_t simulateWeightedSwapBatch(const SwapBatchInput& in, const double* weightIn, const double* weightOut,
+                                 const SwapBatchOutput& out) {
+    validateSwapBatch(in, out.error);
+    getAmountOutWeightedBatch(in.amountIn, in.reserveIn, in.reserveOut, in.fee, weightIn, weightOut,
+                              out.amountOut, in.count);
+
+    const double* reserveIn = in.reserveIn;
+    const double* reserveOut = in.reserveOut;
+    const double* amountIn = in.amountIn;
+    const size_t n = in.count;
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const double P0 = (reserveOut[i] / weightOut[i]) / (reserveIn[i] / weightIn[i]);
+        const double effectivePrice = out.amountOut[i] / amountIn[i];
+        out.newReserveIn[i] = reserveIn[i] + amountIn[i];
+        out.newReserveOut[i] = reserveOut[i] - out.amountOut[i];
+        out.effectivePrice[i] = effectivePrice;
+        out.slippagePercent[i] = (P0 - effectivePrice) / P0 * 100.0;
+
+        const bool goodWeights = weightIn[i] > 0.0 && weightOut[i] > 0.0;
+        const uint8_t e = (uint8_t)(out.error[i] | (goodWeights ? 0 : SwapBadWeight) |
+                                    ((out.amountOut[i] < reserveOut[i]) ? 0 : SwapDrainsPool));
+        out.error[i] = e;
+        if (e != 0) {
+            out.amountOut[i] = 0.0;
+            out.newReserveIn[i] = 0.0;
+            out.newReserveOut[i] = 0.0;
+            out.effectivePrice[i] = 0.0;
+            out.slippagePercent[i] = 0.0;
+            ++bad;
+        }
+    }
+    return bad;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+
+#include "amm.h"
+#include "swap_batch.h"
+
+// Balancer weighted-product pool: prod(x_k ^ w_k) = const. Only the ratio
+// of the two weights matters for a swap, so weights need not sum to 1; an
+// 80/20 pool can be given as (0.8, 0.2) or (4, 1). Equal weights reduce to
+// the constant product.
+//
+// As in Balancer, the fee is taken from the input:
+//   amountOut = balanceOut * (1 - (balanceIn / (balanceIn + amountIn * (1 - fee)))^(wIn / wOut))
+// evaluated as -balanceOut * expm1(-(wIn / wOut) * log1p(amountIn * (1 - fee) / balanceIn)),
+// which keeps full relative precision for trades far smaller than the pool
+// (1 - r^e cancels to nothing there). Both functions come from fast_math.h,
+// so the scalar and batch paths agree bit for bit.
+double getAmountOutWeighted(double amountIn, double reserveIn, double reserveOut, double fee,
+                            double weightIn, double weightOut);
+
+// Marginal price before fees (out per in): (reserveOut / weightOut) / (reserveIn / weightIn).
+double weightedSpotPrice(double reserveIn, double reserveOut, double weightIn, double weightOut);
+
+// Same results and slippage definition as simulateSwap, on the weighted
+// curve. weightA and weightB belong to tokens A and B.
+template <Direction D>
+SwapResult simulateWeightedSwap(double reserveA, double reserveB, double fee, double weightA, double weightB,
+                                double amountIn) {
+    require(reserveA > 0.0 && reserveB > 0.0, "reserveA and reserveB must be > 0");
+
+    const bool aToB = (D == Direction::A2B);
+    const double reserveIn = aToB ? reserveA : reserveB;
+    const double reserveOut = aToB ? reserveB : reserveA;
+    const double weightIn = aToB ? weightA : weightB;
+    const double weightOut = aToB ? weightB : weightA;
+
+    const double P0 = weightedSpotPrice(reserveIn, reserveOut, weightIn, weightOut);
+    const double out = getAmountOutWeighted(amountIn, reserveIn, reserveOut, fee, weightIn, weightOut);
+    require(out < reserveOut, "amountOut would drain the pool (invalid trade)");
+
+    SwapResult r{};
+    r.amountOut = out;
+    r.newReserveA = aToB ? reserveA + amountIn : reserveA - out;
+    r.newReserveB = aToB ? reserveB - out : reserveB + amountIn;
+    r.effectivePrice = out / amountIn;
+    r.slippagePercent = (P0 - r.effectivePrice) / P0 * 100.0;
+    return r;
+}
+
+inline SwapResult simulateWeightedSwap(double reserveA, double reserveB, double fee, double weightA,
+                                       double weightB, Direction dir, double amountIn) {
+    return dir == Direction::A2B
+           ? simulateWeightedSwap<Direction::A2B>(reserveA, reserveB, fee, weightA, weightB, amountIn)
+           : simulateWeightedSwap<Direction::B2A>(reserveA, reserveB, fee, weightA, weightB, amountIn);
+}
+
+// Vectorized getAmountOutWeighted: the log1p and expm1 passes run through
+// fastLog1pBatch/fastExpm1Batch over cache-sized chunks, so the result is
+// bit-identical to the scalar function at every SIMD level.
+// No validation (see simulateWeightedSwapBatch).
+void getAmountOutWeightedBatch(const double* amountIn, const double* reserveIn, const double* reserveOut,
+                               const double* fee, const double* weightIn, const double* weightOut,
+                               double* amountOut, size_t n);
+
+// simulateSwapBatch on the weighted curve, with one weight pair per lane.
+// Lanes with a weight that is not > 0 are flagged SwapBadWeight.
+size_t simulateWeightedSwapBatch(const SwapBatchInput& in, const double* weightIn, const double* weightOut,
+                                 const SwapBatchOutput& out);